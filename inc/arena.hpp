@@ -0,0 +1,348 @@
+// This file is part of PRSice-2, copyright (C) 2016-2019
+// Shing Wan Choi, Paul F. O’Reilly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef PRSICE_INC_ARENA_HPP_
+#define PRSICE_INC_ARENA_HPP_
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define ARENA_CHUNK_SIZE 1048576
+#define STRING_INDEX_NONE ~uint32_t(0)
+#define STRING_INDEX_MIN_SLOT 16
+// maximum load factor of the StringIndex is 3/4
+#define STRING_INDEX_MAX_LOAD_NUM 3
+#define STRING_INDEX_MAX_LOAD_DEN 4
+
+/*!
+ * \brief Append only storage for strings. Strings are copied into large
+ *        chunks and are never moved, so the returned pointers stay valid for
+ *        the life time of the arena. Not thread safe
+ */
+class StringArena
+{
+public:
+    StringArena() {}
+    StringArena(const StringArena&) = delete;
+    StringArena& operator=(const StringArena&) = delete;
+    /*!
+     * \brief Copy a string into the arena
+     * \param str is the start of the string
+     * \param length is the length of the string
+     * \return pointer to the null terminated copy of the string
+     */
+    const char* store(const char* str, const size_t length)
+    {
+        if (length + 1 > m_remain) grow(length + 1);
+        char* res = m_cur;
+        std::memcpy(res, str, length);
+        res[length] = '\0';
+        m_cur += length + 1;
+        m_remain -= length + 1;
+        m_used += length + 1;
+        return res;
+    }
+    const char* store(const std::string& str)
+    {
+        return store(str.data(), str.size());
+    }
+    /*!
+     * \brief Return the number of bytes used by the stored strings
+     */
+    size_t used() const { return m_used; }
+    /*!
+     * \brief Return the number of bytes allocated by the arena
+     */
+    size_t capacity() const
+    {
+        return m_chunks.empty() ? 0 : m_used + m_remain + m_wasted;
+    }
+    /*!
+     * \brief Release all strings. Previously returned pointers are invalidated
+     */
+    void clear()
+    {
+        m_chunks.clear();
+        m_cur = nullptr;
+        m_remain = 0;
+        m_used = 0;
+        m_wasted = 0;
+    }
+
+private:
+    std::vector<std::unique_ptr<char[]>> m_chunks;
+    char* m_cur = nullptr;
+    size_t m_remain = 0;
+    size_t m_used = 0;
+    size_t m_wasted = 0;
+    void grow(const size_t required)
+    {
+        m_wasted += m_remain;
+        const size_t chunk_size = std::max<size_t>(ARENA_CHUNK_SIZE, required);
+        m_chunks.emplace_back(new char[chunk_size]);
+        m_cur = m_chunks.back().get();
+        m_remain = chunk_size;
+    }
+};
+
+/*!
+ * \brief Table of all distinct alleles. Each allele is represented by a small
+ *        integer code, where 0 is the empty (missing) allele. The code of the
+ *        complementary allele is pre-computed for the single base alleles.
+ *        Not thread safe
+ */
+class AlleleTable
+{
+public:
+    AlleleTable()
+    {
+        m_allele.push_back("");
+        m_complement.push_back(0);
+        m_index[""] = 0;
+    }
+    AlleleTable(const AlleleTable&) = delete;
+    AlleleTable& operator=(const AlleleTable&) = delete;
+    /*!
+     * \brief Return the code of the allele, adding it to the table if
+     *        required. Alleles are assumed to be capitalized
+     */
+    uint32_t encode(const std::string& allele)
+    {
+        auto&& idx = m_index.find(allele);
+        if (idx != m_index.end()) return idx->second;
+        const uint32_t code = static_cast<uint32_t>(m_allele.size());
+        m_allele.push_back(allele);
+        m_complement.push_back(code);
+        m_index[allele] = code;
+        const std::string complement = complement_allele(allele);
+        if (complement != allele)
+        {
+            const uint32_t complement_code = encode(complement);
+            m_complement[code] = complement_code;
+            m_complement[complement_code] = code;
+        }
+        return code;
+    }
+    /*!
+     * \brief Return the allele represented by the code. The reference stays
+     *        valid when new alleles are added
+     */
+    const std::string& allele(const uint32_t code) const
+    {
+        return m_allele[code];
+    }
+    /*!
+     * \brief Return the code of the complementary allele. Alleles that cannot
+     *        be flipped are their own complement
+     */
+    uint32_t complement(const uint32_t code) const
+    {
+        return m_complement[code];
+    }
+    size_t size() const { return m_allele.size(); }
+
+private:
+    std::deque<std::string> m_allele;
+    std::vector<uint32_t> m_complement;
+    std::unordered_map<std::string, uint32_t> m_index;
+    static std::string complement_allele(const std::string& allele)
+    {
+        if (allele == "A") return "T";
+        if (allele == "T") return "A";
+        if (allele == "G") return "C";
+        if (allele == "C")
+            return "G";
+        else
+            return allele; // Cannot flip, so will just return it as is
+    }
+};
+
+/*!
+ * \brief Flat hash table from string to index, using open addressing with
+ *        linear probing. The keys are copied into a StringArena so that each
+ *        slot only holds a pointer, the hash and the value, and lookups can
+ *        be done on a string view without constructing a std::string.
+ *        A key can be inserted without a value (STRING_INDEX_NONE) to record
+ *        that it has been seen. Not thread safe for insertion
+ */
+class StringIndex
+{
+public:
+    StringIndex() {}
+    StringIndex(const StringIndex&) = delete;
+    StringIndex& operator=(const StringIndex&) = delete;
+    /*!
+     * \brief Insert a key. Existing keys are not modified
+     * \param key is the start of the key
+     * \param length is the length of the key
+     * \param value is the index associated with the key
+     * \return false if the key already exists
+     */
+    bool insert(const char* key, const size_t length, const size_t value)
+    {
+        if ((m_size + 1) * STRING_INDEX_MAX_LOAD_DEN
+            > m_slots.size() * STRING_INDEX_MAX_LOAD_NUM)
+        { rehash(std::max<size_t>(STRING_INDEX_MIN_SLOT, m_slots.size() * 2)); }
+        const uint32_t hash = hash_key(key, length);
+        Slot* slot = find_slot(key, length, hash);
+        if (slot->key != nullptr) return false;
+        slot->key = m_keys.store(key, length);
+        slot->hash = hash;
+        slot->value = static_cast<uint32_t>(value);
+        ++m_size;
+        return true;
+    }
+    bool insert(const std::string& key, const size_t value)
+    {
+        return insert(key.data(), key.size(), value);
+    }
+    /*!
+     * \brief Change the value of an existing key
+     * \return false if the key is not found
+     */
+    bool assign(const std::string& key, const size_t value)
+    {
+        if (m_size == 0) return false;
+        Slot* slot =
+            find_slot(key.data(), key.size(), hash_key(key.data(), key.size()));
+        if (slot->key == nullptr) return false;
+        slot->value = static_cast<uint32_t>(value);
+        return true;
+    }
+    /*!
+     * \brief Return the index associated with the key, or ~size_t(0) if the
+     *        key is not found or was inserted without a value
+     */
+    size_t find(const char* key, const size_t length) const
+    {
+        if (m_size == 0) return ~size_t(0);
+        const Slot* slot = find_slot(key, length, hash_key(key, length));
+        if (slot->key == nullptr || slot->value == STRING_INDEX_NONE)
+            return ~size_t(0);
+        return slot->value;
+    }
+    size_t find(const std::string& key) const
+    {
+        return find(key.data(), key.size());
+    }
+    /*!
+     * \brief Check if the key was inserted, with or without a value
+     */
+    bool contains(const char* key, const size_t length) const
+    {
+        if (m_size == 0) return false;
+        return find_slot(key, length, hash_key(key, length))->key != nullptr;
+    }
+    bool contains(const std::string& key) const
+    {
+        return contains(key.data(), key.size());
+    }
+    /*!
+     * \brief Pre-allocate the table for num_key keys
+     */
+    void reserve(const size_t num_key)
+    {
+        size_t required = STRING_INDEX_MIN_SLOT;
+        while (num_key * STRING_INDEX_MAX_LOAD_DEN
+               > required * STRING_INDEX_MAX_LOAD_NUM)
+        { required *= 2; }
+        if (required > m_slots.size()) rehash(required);
+    }
+    void clear()
+    {
+        m_slots.clear();
+        m_slots.shrink_to_fit();
+        m_keys.clear();
+        m_size = 0;
+    }
+    size_t size() const { return m_size; }
+    /*!
+     * \brief Return the number of bytes allocated for the slots and keys
+     */
+    size_t memory_usage() const
+    {
+        return m_slots.capacity() * sizeof(Slot) + m_keys.capacity();
+    }
+
+private:
+    struct Slot
+    {
+        const char* key;
+        uint32_t hash;
+        uint32_t value;
+    };
+    std::vector<Slot> m_slots;
+    StringArena m_keys;
+    size_t m_size = 0;
+    // FNV-1a followed by the murmur3 finalizer, as the lower bits of FNV-1a
+    // are used to select the slot and mix poorly on their own
+    static uint32_t hash_key(const char* key, const size_t length)
+    {
+        uint64_t hash = 14695981039346656037ULL;
+        for (size_t i = 0; i < length; ++i)
+        {
+            hash ^= static_cast<unsigned char>(key[i]);
+            hash *= 1099511628211ULL;
+        }
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 33;
+        hash *= 0xc4ceb9fe1a85ec53ULL;
+        hash ^= hash >> 33;
+        return static_cast<uint32_t>(hash);
+    }
+    static bool same_key(const char* stored, const char* key,
+                         const size_t length)
+    {
+        // stored keys are null terminated
+        return std::strncmp(stored, key, length) == 0 && stored[length] == '\0';
+    }
+    Slot* find_slot(const char* key, const size_t length,
+                    const uint32_t hash) const
+    {
+        const size_t mask = m_slots.size() - 1;
+        size_t pos = hash & mask;
+        while (true)
+        {
+            const Slot& slot = m_slots[pos];
+            if (slot.key == nullptr
+                || (slot.hash == hash && same_key(slot.key, key, length)))
+            { return const_cast<Slot*>(&slot); }
+            pos = (pos + 1) & mask;
+        }
+    }
+    void rehash(const size_t num_slot)
+    {
+        std::vector<Slot> old(num_slot, Slot {nullptr, 0, 0});
+        old.swap(m_slots);
+        const size_t mask = num_slot - 1;
+        for (auto&& slot : old)
+        {
+            if (slot.key == nullptr) continue;
+            size_t pos = slot.hash & mask;
+            while (m_slots[pos].key != nullptr) pos = (pos + 1) & mask;
+            m_slots[pos] = slot;
+        }
+    }
+};
+
+#endif /* PRSICE_INC_ARENA_HPP_ */
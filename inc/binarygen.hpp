@@ -18,11 +18,22 @@
 #define BinaryGEN_H
 
 #include "bgen_lib.hpp"
+#include "dosagecache.hpp"
 #include "genotype.hpp"
 #include "reporter.hpp"
+#include <condition_variable>
+#include <exception>
+#include <mutex>
 #include <stdexcept>
+#include <thread>
 #include <zlib.h>
 
+// minimum number of SNPs in a dosage scoring call for the threaded pipeline
+// to be used, as the threads are started for each call
+#define BGEN_PIPELINE_MIN_SNP 16
+// number of SNPs buffered per worker thread in the pipeline
+#define BGEN_PIPELINE_DEPTH 4
+
 /**
  * Potential problem:
  * Where multi-allelic variants exist in these data, they have been
@@ -49,6 +60,8 @@ protected:
     typedef std::vector<std::vector<double>> Data;
     std::unordered_map<size_t, genfile::bgen::Context> m_context_map;
     std::vector<genfile::byte_t> m_buffer1, m_buffer2;
+    DosageCache m_dosage_cache;
+    std::string m_dosage_cache_name;
     bool m_target_plink = false;
     bool m_ref_plink = false;
     bool m_has_external_sample = false;
@@ -80,6 +93,47 @@ protected:
      */
     bool check_sample_consistent(const std::string& bgen_name,
                                  const genfile::bgen::Context& context);
+    /*!
+     * \brief Load the dosage cache if it is valid for the current BGEN files
+     * and samples, otherwise start generating a new one
+     * \return true if a new dosage cache need to be generated
+     */
+    bool init_dosage_cache();
+    std::string read_ahead_file(const size_t file_idx,
+                                const long long byte_pos) const
+    {
+        // the intermediate file is always the last genotype file
+        if ((m_target_plink || m_ref_plink)
+            && file_idx + 1 == m_genotype_file_names.size())
+        { return m_genotype_file_names[file_idx]; }
+        if (m_dosage_cache.find(file_idx, static_cast<uint64_t>(byte_pos))
+            != nullptr)
+        { return ""; }
+        return m_genotype_file_names[file_idx] + ".bgen";
+    }
+    /*!
+     * \brief Parse the genotype of a SNP with setter, using the dosage cache
+     * if the SNP is cached
+     *
+     * \param file_idx is the index of the bgen file
+     * \param byte_pos is the streampos of the SNP in the bgen file
+     * \param setter is the structure used for parsing the probabilities
+     */
+    template <typename Setter>
+    void parse_genotype(const size_t file_idx, const long long byte_pos,
+                        Setter& setter)
+    {
+        const DosageCache::Entry* entry = m_dosage_cache.find(
+            file_idx, static_cast<uint64_t>(byte_pos));
+        if (entry != nullptr)
+        {
+            m_dosage_cache.parse(*entry, setter);
+            return;
+        }
+        genfile::bgen::read_and_parse_genotype_data_block<Setter>(
+            m_genotype_file, m_genotype_file_names[file_idx] + ".bgen",
+            m_context_map[file_idx], setter, &m_buffer1, &m_buffer2, byte_pos);
+    }
 
     /*!
      * \brief This function will read in the bgen probability data and transform
@@ -138,8 +192,6 @@ protected:
     {
         // check sample size != 0
         assert(m_unfiltered_sample_ct);
-        // we first check if we will read in a new file
-        auto&& context = m_context_map[file_idx];
         // we initailize the PLINK generator with the m_sample_include
         // vector, the mainbuf (result storage) and also the hard threshold.
         // We don't need to bother about founder or founder info here as all
@@ -156,11 +208,7 @@ protected:
         // such that it will always call .sample_completed() when finish
         // reading each sample. This allow for a more elegant implementation
         // on our side
-        std::string file_name = m_genotype_file_names[file_idx] + ".bgen";
-        // WARNING: Problem here
-        genfile::bgen::read_and_parse_genotype_data_block<PLINK_generator>(
-            m_genotype_file, file_name, context, setter, &m_buffer1, &m_buffer2,
-            byte_pos);
+        parse_genotype(file_idx, byte_pos, setter);
         // output from load_raw should have already copied all samples
         // to the front without the need of subseting
         // mainbuf should contains the information
@@ -179,65 +227,51 @@ protected:
     void dosage_score(const std::vector<size_t>::const_iterator& start_idx,
                       const std::vector<size_t>::const_iterator& end_idx,
                       bool reset_zero);
+    void read_background(const std::vector<size_t>& background);
+
+    /*!
+     * \brief Score the SNPs with a pipeline of threads. One thread reads the
+     * compressed genotype blocks, the worker threads decompress and parse
+     * them and the calling thread adds the dosages to the PRS following the
+     * order of the SNPs, so that the result is identical to dosage_score
+     */
+    void threaded_dosage_score(
+        const std::vector<size_t>::const_iterator& start_idx,
+        const std::vector<size_t>::const_iterator& end_idx, bool reset_zero,
+        const size_t num_worker);
 
     /*
      * Different structures use for reading in the bgen info
      */
-    // TODO: Use ref MAf for dosage score too
-    struct PRS_Interpreter
+    /*!
+     * \brief Dosage_Interpreter is the structure used by BGEN library to parse
+     * the probability data into the weighted dosage of each sample. It does
+     * not touch any shared data, so that SNPs can be parsed concurrently
+     */
+    struct Dosage_Interpreter
     {
-        ~PRS_Interpreter() {}
         /*!
-         * \brief PRS_Interpreter is the structure used by BGEN library to parse
-         * the probability data
-         *
-         * \param sample_prs is the vector where we store the results
          * \param sample_inclusion is the vector telling us if the sample is
          * required
-         *
-         * \param missing contain the method of missingness handling
          */
-        PRS_Interpreter(std::vector<PRS>* sample_prs,
-                        std::vector<uintptr_t>* sample_inclusion,
-                        MISSING_SCORE missing)
-            : m_sample_prs(sample_prs), m_sample_inclusion(sample_inclusion)
+        Dosage_Interpreter(std::vector<uintptr_t>* sample_inclusion)
+            : m_sample_inclusion(sample_inclusion)
         {
-            m_ploidy = 2;
-            m_miss_count = m_ploidy * (missing != MISSING_SCORE::SET_ZERO);
-            // to account for the missingness, we need to calculate the mean of
-            // the PRS before we can assign the missing value to the sample. As
-            // a result of that, we need a vector to store the index of the
-            // missing sample. The maximum possible number of missing sample is
-            // the number of sample, thus we can reserve the required size
-            m_setzero = (missing == MISSING_SCORE::SET_ZERO);
-            m_centre = (missing == MISSING_SCORE::CENTER);
         }
         /*!
-         * \brief As we will reuse this struct in our analysis, we need to
-         * constantly feed in different statistics and to inform this struct
-         * whether we want to reset the PRS
+         * \brief Set the weight of each genotype for the next SNP
          *
-         * \param stat is the effect size of the SNP
          * \param homcom_weight is the weight of the homozygous common variant
          * \param het_weight is the weight of heterozygous
          * \param homrar_weight is the weight of homozygous rare variant
          * \param flipped represent whether we want to flip this SNP
-         * \param not_first inform us if we want to construct a new score or not
          */
-        void set_stat(const double& stat, const double& homcom_weight,
-                      const double& het_weight, const double& homrar_weight,
-                      const bool flipped, const bool not_first)
+        void set_weight(const double& homcom_weight, const double& het_weight,
+                        const double& homrar_weight, const bool flipped)
         {
-            // don't use external expected as that doesn't take into account of
-            // the weighting
-            m_missing.clear();
-            m_stat = stat;
             m_homcom_weight = homcom_weight;
             m_het_weight = het_weight;
             m_homrar_weight = homrar_weight;
-            m_not_first = not_first;
-            m_cal_expected = 0;
-            rs.clear();
             // to match the encoding in PLINK format, we "unflip" SNPs here
             // otherwise our polygenic score will be going to an opposite
             // direction
@@ -246,16 +280,6 @@ protected:
                 // immediately flip the weight at the beginning
                 std::swap(m_homcom_weight, m_homrar_weight);
             }
-            m_adj_score = 0;
-            m_miss_score = 0;
-            m_miss_count = 0;
-            if (!m_setzero)
-            {
-                // this is the only one that depends on ploidy
-                m_miss_count = 2;
-                // again, mean_impute is stable, branch prediction should be ok
-                // 0 if we don't have the expected score
-            }
         }
         /*!
          * \brief This function is called by BGEN whenever a new SNP is
@@ -284,11 +308,6 @@ protected:
         {
             // a flag to indicate if this is a missing sample
             m_is_missing = false;
-            // a flag to indicate this is the first genotype of the sample
-            // we set this to account for the off chance where the set_value
-            // isn't called in the expected order (though in that case, our
-            // m_entry_i might also be wrong)
-            m_start_geno = false;
             // we store the weighted sum of the genotypes to obtain the final
             // dosage
             m_sum = 0.0;
@@ -333,30 +352,236 @@ protected:
          * function instead
          */
         void set_value(uint32_t, genfile::MissingValue) { m_is_missing = true; }
+        /*!
+         * \brief Store the weighted dosage of the sample. m_dosage and
+         * m_missing must be large enough to hold all included samples
+         */
+        void sample_completed()
+        {
+            m_dosage[m_prs_sample_i] = m_sum;
+            m_missing[m_prs_sample_i] = sample_missing();
+            ++m_prs_sample_i;
+        }
+        /*!
+         * \brief Called by BGEN instead of the per sample functions for
+         * unphased, biallelic and diploid v1.2 blocks with 8 or 16 bits
+         *
+         * \param num_sample is the number of samples in the block
+         * \param ploidy is the ploidy byte of each sample, where the highest
+         * bit indicate missingness
+         * \param data is the start of the probabilities
+         * \param bits is the number of bits per probability
+         */
+        void set_diploid_probabilities(uint32_t num_sample,
+                                       const genfile::byte_t* ploidy,
+                                       const genfile::byte_t* data, int bits)
+        {
+            decode_weighted_dosage(num_sample, data, bits);
+            for (uint32_t i = 0; i < num_sample; ++i)
+            {
+                if (!IS_SET(m_sample_inclusion->data(), i)) continue;
+                const bool missing = (ploidy[i] & 0x80);
+                m_dosage[m_prs_sample_i] = missing ? 0.0 : m_block_dosage[i];
+                m_missing[m_prs_sample_i] = missing;
+                ++m_prs_sample_i;
+            }
+        }
+        std::vector<double> m_dosage;
+        std::vector<char> m_missing;
+
+    protected:
+        std::vector<uintptr_t>* m_sample_inclusion;
+        // weighted dosage and heterozygous probability of all samples of the
+        // current block, used by set_diploid_probabilities
+        std::vector<double> m_block_dosage;
+        std::vector<double> m_block_het;
+        double m_sum = 0.0;
+        double m_sum_prob = 0.0;
+        double m_homcom_weight = 0;
+        double m_het_weight = 0.1;
+        double m_homrar_weight = 1;
+        uint32_t m_prs_sample_i = 0;
+        bool m_is_missing = false;
+        bool sample_missing() const
+        {
+            return misc::logically_equal(m_sum_prob, 0.0) || m_is_missing;
+        }
+        /*!
+         * \brief Calculate the weighted dosage of all samples in the block
+         * and store it in m_block_dosage
+         */
+        void decode_weighted_dosage(uint32_t num_sample,
+                                    const genfile::byte_t* data, int bits)
+        {
+            m_block_dosage.resize(num_sample);
+            m_block_het.resize(num_sample);
+            genfile::bgen::v12::decode_diploid_probabilities(
+                data, bits, num_sample, m_block_dosage.data(),
+                m_block_het.data());
+            weight_dosage(num_sample, m_block_dosage.data(),
+                          m_block_het.data());
+        }
+        /*!
+         * \brief Calculate the weighted dosage of each sample from their
+         * probabilities and store it in m_block_dosage. This is done in one
+         * sweep without branches so that it can be vectorised. homcom can
+         * be m_block_dosage
+         */
+        void weight_dosage(size_t num_sample, const double* homcom,
+                           const double* het)
+        {
+            m_block_dosage.resize(num_sample);
+            double* dosage = m_block_dosage.data();
+            // use local copies so that the compiler knows the weights are not
+            // changed by the writes to dosage
+            const double homcom_weight = m_homcom_weight;
+            const double het_weight = m_het_weight;
+            const double homrar_weight = m_homrar_weight;
+            for (size_t i = 0; i < num_sample; ++i)
+            {
+                // same order of operations as set_value, so that the result
+                // is identical
+                const double homrar = 1.0 - (homcom[i] + het[i]);
+                double sum = 0.0;
+                sum += homcom_weight * homcom[i];
+                sum += het_weight * het[i];
+                sum += homrar_weight * homrar;
+                dosage[i] = sum;
+            }
+        }
+    };
+    // TODO: Use ref MAf for dosage score too
+    struct PRS_Interpreter : public Dosage_Interpreter
+    {
+        ~PRS_Interpreter() {}
+        /*!
+         * \brief PRS_Interpreter is the structure used by BGEN library to parse
+         * the probability data and add it to the PRS
+         *
+         * \param sample_prs is the vector where we store the results
+         * \param sample_num_snp is the vector where we store the number of
+         * SNPs contributing to the results
+         * \param sample_inclusion is the vector telling us if the sample is
+         * required
+         *
+         * \param missing contain the method of missingness handling
+         */
+        PRS_Interpreter(std::vector<double>* sample_prs,
+                        std::vector<uint32_t>* sample_num_snp,
+                        std::vector<uintptr_t>* sample_inclusion,
+                        MISSING_SCORE missing)
+            : Dosage_Interpreter(sample_inclusion)
+            , m_sample_prs(sample_prs)
+            , m_sample_num_snp(sample_num_snp)
+        {
+            m_ploidy = 2;
+            m_miss_count = m_ploidy * (missing != MISSING_SCORE::SET_ZERO);
+            // to account for the missingness, we need to calculate the mean of
+            // the PRS before we can assign the missing value to the sample. As
+            // a result of that, we need a vector to store the index of the
+            // missing sample. The maximum possible number of missing sample is
+            // the number of sample, thus we can reserve the required size
+            m_setzero = (missing == MISSING_SCORE::SET_ZERO);
+            m_centre = (missing == MISSING_SCORE::CENTER);
+        }
+        /*!
+         * \brief As we will reuse this struct in our analysis, we need to
+         * constantly feed in different statistics and to inform this struct
+         * whether we want to reset the PRS
+         *
+         * \param stat is the effect size of the SNP
+         * \param homcom_weight is the weight of the homozygous common variant
+         * \param het_weight is the weight of heterozygous
+         * \param homrar_weight is the weight of homozygous rare variant
+         * \param flipped represent whether we want to flip this SNP
+         * \param not_first inform us if we want to construct a new score or not
+         */
+        void set_stat(const double& stat, const double& homcom_weight,
+                      const double& het_weight, const double& homrar_weight,
+                      const bool flipped, const bool not_first)
+        {
+            // don't use external expected as that doesn't take into account of
+            // the weighting
+            m_missing_sample.clear();
+            m_stat = stat;
+            set_weight(homcom_weight, het_weight, homrar_weight, flipped);
+            m_not_first = not_first;
+            rs.clear();
+            m_adj_score = 0;
+            m_miss_score = 0;
+            m_miss_count = 0;
+            if (!m_setzero)
+            {
+                // this is the only one that depends on ploidy
+                m_miss_count = 2;
+                // again, mean_impute is stable, branch prediction should be ok
+                // 0 if we don't have the expected score
+            }
+        }
         /*!
          * \brief This function is called whenever all probability for a sample
          * are read. We can then perform assignment to the sample
          */
-        void sample_completed()
+        void sample_completed() { add_sample(m_sum, sample_missing()); }
+        /*!
+         * \brief Add all samples of an unphased, biallelic and diploid BGEN
+         * v1.2 block with 8 or 16 bits. See
+         * Dosage_Interpreter::set_diploid_probabilities
+         */
+        void set_diploid_probabilities(uint32_t num_sample,
+                                       const genfile::byte_t* ploidy,
+                                       const genfile::byte_t* data, int bits)
+        {
+            decode_weighted_dosage(num_sample, data, bits);
+            for (uint32_t i = 0; i < num_sample; ++i)
+            {
+                if (!IS_SET(m_sample_inclusion->data(), i)) continue;
+                add_sample(m_block_dosage[i], ploidy[i] & 0x80);
+            }
+        }
+        /*!
+         * \brief Add the probabilities of the included samples, as stored in
+         * the dosage cache
+         *
+         * \param num_sample is the number of included samples
+         * \param homcom is the probability of the homozygous first allele
+         * \param het is the probability of the heterozygous genotype
+         * \param missing indicate if the genotype of the sample is missing
+         */
+        void set_included_probabilities(size_t num_sample, const double* homcom,
+                                        const double* het, const char* missing)
+        {
+            weight_dosage(num_sample, homcom, het);
+            for (size_t i = 0; i < num_sample; ++i)
+            { add_sample(m_block_dosage[i], missing[i]); }
+        }
+        /*!
+         * \brief Add the weighted dosage of the next sample to its PRS
+         *
+         * \param sum is the weighted dosage of the sample
+         * \param is_missing indicate if the genotype of the sample is missing
+         */
+        void add_sample(const double sum, const bool is_missing)
         {
             auto&& sample_prs = (*m_sample_prs)[m_prs_sample_i];
+            auto&& sample_num_snp = (*m_sample_num_snp)[m_prs_sample_i];
 
-            if (misc::logically_equal(m_sum_prob, 0.0) || m_is_missing)
+            if (is_missing)
             {
-                m_missing.push_back(m_prs_sample_i);
-                sample_prs.num_snp =
-                    sample_prs.num_snp * m_not_first + m_miss_count;
+                m_missing_sample.push_back(m_prs_sample_i);
+                sample_num_snp = sample_num_snp * m_not_first
+                                 + static_cast<uint32_t>(m_miss_count);
             }
             // this is not a missing sample and we can either add the prs or
             // assign the PRS
             else
             {
                 // this is not the first SNP in the region, we will add
-                sample_prs.num_snp =
-                    sample_prs.num_snp * m_not_first + m_ploidy;
-                sample_prs.prs =
-                    sample_prs.prs * m_not_first + m_sum * m_stat - m_adj_score;
-                rs.push(m_sum);
+                sample_num_snp = sample_num_snp * m_not_first
+                                 + static_cast<uint32_t>(m_ploidy);
+                sample_prs =
+                    sample_prs * m_not_first + sum * m_stat - m_adj_score;
+                rs.push(sum);
             }
             // go to next sample that we need (not the bgen index)
             ++m_prs_sample_i;
@@ -379,10 +604,11 @@ protected:
             size_t cur_idx = 0;
             for (size_t i = 0; i < m_sample_prs->size(); ++i)
             {
-                if (cur_idx < m_missing.size() && i == m_missing[cur_idx])
+                if (cur_idx < m_missing_sample.size()
+                    && i == m_missing_sample[cur_idx])
                 {
-                    (*m_sample_prs)[i].prs =
-                        (*m_sample_prs)[i].prs * m_not_first + m_miss_score;
+                    (*m_sample_prs)[i] =
+                        (*m_sample_prs)[i] * m_not_first + m_miss_score;
                     ++cur_idx;
                 }
                 else if (m_centre)
@@ -390,31 +616,22 @@ protected:
                     // if it is not missing and we want the centre the score
                     // we will need to minus the adjusted score which was 0
                     // before this run
-                    (*m_sample_prs)[i].prs -= m_adj_score;
+                    (*m_sample_prs)[i] -= m_adj_score;
                 }
             }
         }
 
     private:
-        std::vector<PRS>* m_sample_prs;
-        std::vector<uintptr_t>* m_sample_inclusion;
-        std::vector<size_t> m_missing;
+        std::vector<double>* m_sample_prs;
+        std::vector<uint32_t>* m_sample_num_snp;
+        std::vector<size_t> m_missing_sample;
         misc::RunningStat rs;
         double m_stat = 0.0;
-        double m_sum = 0.0;
-        double m_sum_prob = 0.0;
-        double m_homcom_weight = 0;
-        double m_het_weight = 0.1;
-        double m_homrar_weight = 1;
         double m_miss_score = 0.0;
         double m_adj_score = 0.0;
-        double m_cal_expected = 0.0;
-        uint32_t m_prs_sample_i = 0;
         int m_miss_count = 0;
         int m_ploidy = 2;
         bool m_not_first = false;
-        bool m_is_missing = false;
-        bool m_start_geno = false;
         bool m_setzero = false;
         bool m_centre = false;
     };
@@ -469,6 +686,16 @@ protected:
         {
             // we set the sample index to i
             m_sample_i = i;
+            reset_sample();
+            // then we determine if we want to include sample using by
+            // consulting the flag on m_sample
+            return IS_SET(m_sample->data(), m_sample_i);
+        }
+        /*!
+         * \brief reset_sample clear the information of the previous sample
+         */
+        void reset_sample()
+        {
             // set the genotype binary representation to 2 (missing)
             m_geno = 2;
             // we also reset the hard_prob to 0
@@ -477,9 +704,6 @@ protected:
             m_exp_value = 0.0;
             m_missing = false;
             std::fill(m_prob.begin(), m_prob.end(), 0.0);
-            // then we determine if we want to include sample using by
-            // consulting the flag on m_sample
-            return IS_SET(m_sample->data(), m_sample_i);
         }
         /*!
          * \brief set_number_of_entries is yet another function required by
@@ -532,6 +756,67 @@ protected:
          * \param value this is the missing signature used by bgen v1.2+
          */
         void set_value(uint32_t, genfile::MissingValue) { m_missing = true; }
+        /*!
+         * \brief set_diploid_probabilities is called by BGEN instead of the
+         * per sample functions for unphased, biallelic and diploid v1.2
+         * blocks with 8 or 16 bits. The probabilities of the whole block
+         * are decoded at once instead of being read bit by bit
+         *
+         * \param num_sample is the number of samples in the block
+         * \param ploidy is the ploidy byte of each sample, where the highest
+         * bit indicate missingness
+         * \param data is the start of the probabilities
+         * \param bits is the number of bits per probability
+         */
+        void set_diploid_probabilities(uint32_t num_sample,
+                                       const genfile::byte_t* ploidy,
+                                       const genfile::byte_t* data, int bits)
+        {
+            m_block_homcom.resize(num_sample);
+            m_block_het.resize(num_sample);
+            genfile::bgen::v12::decode_diploid_probabilities(
+                data, bits, num_sample, m_block_homcom.data(),
+                m_block_het.data());
+            for (uint32_t i = 0; i < num_sample; ++i)
+            {
+                if (!set_sample(i)) continue;
+                if (ploidy[i] & 0x80)
+                { m_missing = true; }
+                else
+                {
+                    set_value(0, m_block_homcom[i]);
+                    set_value(1, m_block_het[i]);
+                    set_value(2, 1.0 - (m_block_homcom[i] + m_block_het[i]));
+                }
+                sample_completed();
+            }
+        }
+        /*!
+         * \brief set_included_probabilities add the probabilities of the
+         * included samples, as stored in the dosage cache
+         *
+         * \param num_sample is the number of included samples
+         * \param homcom is the probability of the homozygous first allele
+         * \param het is the probability of the heterozygous genotype
+         * \param missing indicate if the genotype of the sample is missing
+         */
+        void set_included_probabilities(size_t num_sample, const double* homcom,
+                                        const double* het, const char* missing)
+        {
+            for (size_t i = 0; i < num_sample; ++i)
+            {
+                reset_sample();
+                if (missing[i])
+                { m_missing = true; }
+                else
+                {
+                    set_value(0, homcom[i]);
+                    set_value(1, het[i]);
+                    set_value(2, 1.0 - (homcom[i] + het[i]));
+                }
+                add_genotype(true);
+            }
+        }
         /*!
          * \brief finalise This function is called when the SNP is
          * processed. Do nothing here
@@ -542,6 +827,18 @@ protected:
          * This will set the binary vector accordingly
          */
         void sample_completed()
+        {
+            // BGEN v1.1 call this for all samples, but we only calculate the
+            // info score with the included samples
+            add_genotype(IS_SET(m_sample->data(), m_sample_i));
+        }
+        /*!
+         * \brief add_genotype set the binary vector of the current sample
+         *
+         * \param included indicate if the expected value of the sample should
+         * be used for the info score calculation
+         */
+        void add_genotype(const bool included)
         {
             // if m_shift is zero, it is when we meet the index for the
             // first time, therefore we want to initialize it
@@ -596,8 +893,7 @@ protected:
             }
             // we can now push in the expected value for this sample. This
             // can then use for the calculation of the info score
-            // always calculate for any inclusion
-            if (IS_SET(m_sample->data(), m_sample_i)) rs.push(m_exp_value);
+            if (included) rs.push(m_exp_value);
         }
         /*!
          * \brief info_score is the function use to calculate the info score
@@ -623,6 +919,10 @@ protected:
         // is the sample inclusion vector, if bit is set, sample is required
         std::vector<uintptr_t>* m_sample;
         std::vector<double> m_prob;
+        // decoded probabilities of the current block, used by
+        // set_diploid_probabilities
+        std::vector<double> m_block_homcom;
+        std::vector<double> m_block_het;
         // is the genotype vector
         uintptr_t* m_genotype;
         misc::RunningStat rs;
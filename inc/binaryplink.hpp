@@ -22,6 +22,8 @@
 #include "genotype.hpp"
 #include "misc.hpp"
 #include "reporter.hpp"
+#include <atomic>
+#include <exception>
 #include <functional>
 #include <mio.hpp>
 class BinaryPlink : public Genotype
@@ -57,6 +59,47 @@ protected:
                              bool force_cal = false);
     void check_bed(const std::string& bed_name, size_t num_marker,
                    uintptr_t& bed_offset);
+    // Variants of a .bim file that are found in the base file, together with
+    // the information required to validate the .bim and .bed file
+    struct BimInfo
+    {
+        struct Variant
+        {
+            std::string chr;
+            std::string rs;
+            std::string bp;
+            std::string a1;
+            std::string a2;
+            // number of non-empty line up to and including this variant
+            size_t line;
+            size_t base_idx;
+        };
+        std::vector<Variant> variants;
+        std::exception_ptr error;
+        uintptr_t bed_offset = 3;
+        size_t num_marker = 0;
+        size_t num_base_missed = 0;
+        // hash of the chromosome, ID, coordinate and alleles of all variants
+        uint64_t variant_hash = FNV_OFFSET_BASIS;
+        // first line with less than 6 column, 0 if none
+        size_t malformed_line = 0;
+    };
+    /*!
+     * \brief Read the .bim file in a single pass, counting the number of
+     *        markers and keeping the variants found in the base file. The
+     *        .bed file is then checked against the marker count. Only read
+     *        from genotype, so different files can be loaded concurrently
+     * \param prefix is the prefix of the .bim and .bed file
+     * \param genotype contains the base SNPs
+     * \param info is the output
+     */
+    void load_bim(const std::string& prefix, const Genotype& genotype,
+                  BimInfo& info);
+    std::string read_ahead_file(const size_t file_idx,
+                                const long long /*byte_pos*/) const
+    {
+        return m_genotype_file_names[file_idx] + ".bed";
+    }
     inline void read_genotype(uintptr_t* __restrict genotype,
                               const long long byte_pos, const size_t& file_idx)
     {
@@ -75,31 +118,40 @@ protected:
             m_genotype_file.read(m_genotype_file_names[file_idx] + ".bed",
                                  byte_pos, unfiltered_sample_ct4,
                                  reinterpret_cast<char*>(genotype));
+            genotype[(m_unfiltered_sample_ct - 1) / BITCT2] &= final_mask;
         }
         else
         {
+            // copy_quaterarr_nonempty_subset dereferences whole words, so the
+            // genotype is staged in the aligned m_tmp_genotype instead of
+            // being read from the (unaligned) memory map
             m_genotype_file.read(
                 m_genotype_file_names[file_idx] + ".bed", byte_pos,
                 unfiltered_sample_ct4,
                 reinterpret_cast<char*>(m_tmp_genotype.data()));
-        }
-        if (m_unfiltered_sample_ct != m_founder_ct)
-        {
             copy_quaterarr_nonempty_subset(
                 m_tmp_genotype.data(), m_founder_info.data(),
                 static_cast<uint32_t>(m_unfiltered_sample_ct),
                 static_cast<uint32_t>(m_founder_ct), genotype);
         }
-        else
-        {
-            genotype[(m_unfiltered_sample_ct - 1) / BITCT2] &= final_mask;
-        }
     }
 
+    /*!
+     * \brief Read the genotype of a SNP for scoring. The genotype is sample
+     *        subsetted unless gather is true
+     * \param genotype is where the genotype is stored
+     * \param maf will contain the frequency used for the score weight
+     * \return false if the SNP is invalid and should not be scored
+     */
+    bool read_score_genotype(SNP& cur_snp, uintptr_t* genotype,
+                             const size_t word_ct, const bool gather,
+                             double& maf);
     virtual void
     read_score(const std::vector<size_t>::const_iterator& start_idx,
                const std::vector<size_t>::const_iterator& end_idx,
                bool reset_zero);
+    void read_score_matrix(const std::vector<size_t>& snp_index);
+    void read_background(const std::vector<size_t>& background);
 };
 
 #endif
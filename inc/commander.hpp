@@ -143,6 +143,11 @@ public:
      */
     bool nonfounders() const { return m_include_nonfounders; }
     bool enable_mmap() const { return m_enable_mmap; }
+    /*!
+     * \brief Return the additional base files used for the score matrix
+     * \return the name of the score base files
+     */
+    std::vector<std::string> score_base() const { return m_score_base; }
 
 
 protected:
@@ -154,6 +159,7 @@ private:
     std::string m_exclude_file = "";
     std::string m_extract_file = "";
     std::string m_help_message;
+    std::vector<std::string> m_score_base;
     // TODO: might consider using 1e-8 instead
     unsigned long long m_memory = 1e10;
     int m_allow_inter = false;
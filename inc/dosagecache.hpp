@@ -0,0 +1,168 @@
+// This file is part of PRSice-2, copyright (C) 2016-2019
+// Shing Wan Choi, Paul F. O’Reilly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef PRSICE_INC_DOSAGECACHE_HPP_
+#define PRSICE_INC_DOSAGECACHE_HPP_
+#include "bgen_lib.hpp"
+#include <cstdint>
+#include <fstream>
+#include <mio.hpp>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#define DOSAGE_CACHE_MAGIC "PRSDCv01"
+#define DOSAGE_CACHE_MAGIC_SIZE 8
+#define DOSAGE_CACHE_HEADER_SIZE 48
+
+/*!
+ * \brief Uncompressed copy of the genotype probabilities of BGEN files,
+ *        restricted to the included samples, so that repeated runs on the
+ *        same target do not need to decompress the genotypes again. Only
+ *        unphased, biallelic and diploid variants stored with 8 or 16 bits
+ *        are cached, other variants must be read from the BGEN file. The
+ *        file is written in native byte order and contains:
+ *        - header: magic, number of samples, hash of the sample inclusion,
+ *          number of source files, number of variants and offset of the
+ *          variant table
+ *        - sources: size, modification time and name of each BGEN file
+ *        - data: for each variant, the probability of the homozygous first
+ *          allele and heterozygous genotype of each included sample, stored
+ *          as in the BGEN file. Missing samples have both values set to the
+ *          maximum
+ *        - variant table: file index, bits, byte position in the BGEN file
+ *          and offset of the data of each variant, sorted by file and byte
+ *          position
+ *        The cache is only valid for the exact same BGEN files and samples
+ */
+class DosageCache
+{
+public:
+    struct Source
+    {
+        std::string name;
+        uint64_t size;
+        int64_t mtime;
+    };
+    struct Entry
+    {
+        uint32_t file_idx;
+        uint32_t bits;
+        uint64_t byte_pos;
+        uint64_t offset;
+    };
+    DosageCache() {}
+    DosageCache(const DosageCache&) = delete;
+    DosageCache& operator=(const DosageCache&) = delete;
+    /*!
+     * \brief Get the size and modification time of a BGEN file
+     */
+    static Source source_info(const std::string& file);
+    /*!
+     * \brief Hash the sample inclusion vector, so that a cache generated with
+     *        a different set of samples is not used
+     */
+    static uint64_t sample_hash(const std::vector<uintptr_t>& sample_include,
+                                const uintptr_t unfiltered_sample_ct);
+    /*!
+     * \brief Start writing a new dosage cache
+     * \param file is the output file name
+     * \param sources are the BGEN files covered by the cache
+     * \param sample_include is the sample inclusion vector
+     * \param unfiltered_sample_ct is the number of samples in the BGEN files
+     * \param sample_ct is the number of included samples
+     */
+    void create(const std::string& file, const std::vector<Source>& sources,
+                const std::vector<uintptr_t>& sample_include,
+                const uintptr_t unfiltered_sample_ct,
+                const uintptr_t sample_ct);
+    /*!
+     * \brief Add a variant to the cache. Must be called in the order of the
+     *        variants within the BGEN files
+     * \param file_idx is the index of the BGEN file
+     * \param byte_pos is the position of the genotype block in the BGEN file
+     * \param context is the context of the BGEN file
+     * \param data is the uncompressed genotype block
+     * \return false if the variant cannot be cached
+     */
+    bool add_variant(const size_t file_idx, const uint64_t byte_pos,
+                     const genfile::bgen::Context& context,
+                     const std::vector<genfile::byte_t>& data);
+    /*!
+     * \brief Write the variant table and complete the header
+     */
+    void close();
+    /*!
+     * \brief Memory map an existing dosage cache
+     * \return false if the cache is missing, invalid, or generated from
+     *         different BGEN files or samples
+     */
+    bool load(const std::string& file, const std::vector<Source>& sources,
+              const std::vector<uintptr_t>& sample_include,
+              const uintptr_t unfiltered_sample_ct, const uintptr_t sample_ct);
+    bool loaded() const { return m_entries != nullptr; }
+    /*!
+     * \brief Return the cached variant located at byte_pos of the BGEN file,
+     *        or nullptr if the variant is not cached
+     */
+    const Entry* find(const size_t file_idx, const uint64_t byte_pos) const;
+    /*!
+     * \brief Pass the cached probabilities of a variant to setter. The setter
+     *        must have the initialise, set_included_probabilities and
+     *        finalise functions
+     */
+    template <typename Setter>
+    void parse(const Entry& entry, Setter& setter)
+    {
+        m_homcom.resize(m_num_sample);
+        m_het.resize(m_num_sample);
+        m_missing.resize(m_num_sample);
+        const genfile::byte_t* data =
+            reinterpret_cast<const genfile::byte_t*>(m_memory_map.data())
+            + entry.offset;
+        genfile::bgen::v12::decode_diploid_probabilities(
+            data, static_cast<int>(entry.bits),
+            static_cast<uint32_t>(m_num_sample), m_homcom.data(), m_het.data());
+        // missing samples are the only ones with probabilities summing to 2
+        for (size_t i = 0; i < m_num_sample; ++i)
+        { m_missing[i] = (m_homcom[i] + m_het[i]) > 1.5; }
+        setter.initialise(m_num_sample, 2);
+        setter.set_included_probabilities(m_num_sample, m_homcom.data(),
+                                          m_het.data(), m_missing.data());
+        setter.finalise();
+    }
+    size_t num_variant() const { return m_num_variant; }
+
+protected:
+    mio::mmap_source m_memory_map;
+    std::ofstream m_out;
+    std::string m_file_name;
+    std::vector<Entry> m_write_entries;
+    std::vector<uintptr_t> m_sample_include;
+    std::vector<double> m_homcom;
+    std::vector<double> m_het;
+    std::vector<char> m_missing;
+    const Entry* m_entries = nullptr;
+    uint64_t m_num_sample = 0;
+    uint64_t m_sample_hash = 0;
+    uint64_t m_num_source = 0;
+    uint64_t m_num_variant = 0;
+    uint64_t m_table_offset = 0;
+    void write_header();
+};
+
+#endif /* PRSICE_INC_DOSAGECACHE_HPP_ */
@@ -20,6 +20,7 @@
 
 #include "IITree.h"
 #include "commander.hpp"
+#include "ldstore.hpp"
 #include "misc.hpp"
 #include "plink_common.hpp"
 #include "reporter.hpp"
@@ -27,18 +28,24 @@
 #include "storage.hpp"
 #include <Eigen/Dense>
 #include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <cmath>
 #include <cstdio>
 #include <cstring>
 #include <deque>
 #include <fstream>
 #include <functional>
+#include <iomanip>
+#include <limits>
 #include <memory>
 #include <memoryread.hpp>
 #include <mio.hpp>
 #include <mutex>
+#include <numeric>
 #include <random>
 #include <set>
+#include <sstream>
 #include <string>
 #include <thread>
 #include <unordered_map>
@@ -51,6 +58,23 @@
 
 #define MULTIPLEX_LD 1920
 #define MULTIPLEX_2LD (MULTIPLEX_LD * 2)
+// maximum size (in bytes) of the genotype buffered for block scoring
+#define SCORE_BLOCK_BYTES 16777216
+// minimum number of genotype words each scoring thread should work on
+#define MIN_SCORE_THREAD_WORD 64
+// number of samples in each tile of the cached background null scores
+#define NULL_SCORE_TILE 128
+// size (in bytes) of each block of the base file parsed at once
+#define BASE_CHUNK_BYTES 8388608
+// minimum number of base file lines each parsing thread should work on
+#define MIN_BASE_THREAD_LINE 4096
+// maximum number of genotype blocks advised ahead of the current read
+#define READ_AHEAD_DEPTH 64
+// maximum size (in bytes) of the genotype blocks advised ahead
+#define READ_AHEAD_BYTES 16777216
+// size (in bytes) of the score matrix rows each thread updates with a block of
+// SNPs before moving on to the next samples
+#define SCORE_MATRIX_TILE_BYTES 131072
 class Genotype
 {
 public:
@@ -123,8 +147,9 @@ public:
     void update_snp_index()
     {
         m_existed_snps_index.clear();
+        m_existed_snps_index.reserve(m_existed_snps.size());
         for (size_t i_snp = 0; i_snp < m_existed_snps.size(); ++i_snp)
-        { m_existed_snps_index[m_existed_snps[i_snp].rs()] = i_snp; }
+        { m_existed_snps_index.insert(m_existed_snps[i_snp].rs(), i_snp); }
     }
     /*!
      * \brief Return the number of sample we wish to perform PRS on
@@ -147,16 +172,12 @@ public:
     std::string
     print_duplicated_snps(const std::unordered_set<std::string>& snp_name,
                           const std::string& out_prefix);
-    bool base_filter_by_value(const std::string& input, const double& threshold,
-                              size_t& filter_count)
+    bool base_filter_by_value(const char* begin, const char* end,
+                              const double& threshold, size_t& filter_count)
     {
         double value = 1;
         // only read in if we want to perform MAF filtering
-        try
-        {
-            value = misc::convert<double>(input.c_str());
-        }
-        catch (...)
+        if (!misc::convert_double(begin, end, value))
         {
             // exclude because we can't read the MAF, therefore assume
             // this is problematic
@@ -288,10 +309,19 @@ public:
      */
     inline double calculate_score(size_t i) const
     {
-        if (i >= m_prs_info.size())
+        if (i >= m_prs_score.size())
             throw std::out_of_range("Sample name vector out of range");
-        double prs = m_prs_info[i].prs;
-        size_t num_snp = m_prs_info[i].num_snp;
+        return final_score(m_prs_score[i], m_prs_num_snp[i], m_mean_score,
+                           m_score_sd);
+    }
+    /*!
+     * \brief Calculate the required PRS from the sum of score and the number
+     * of SNPs contributing to it
+     * \param mean and sd are used for the standardized score
+     */
+    inline double final_score(const double prs, const uint32_t num_snp,
+                              const double mean, const double sd) const
+    {
         double avg = prs;
         if (num_snp == 0) { avg = 0.0; }
         else
@@ -301,9 +331,9 @@ public:
 
         switch (m_prs_calculation.scoring_method)
         {
-        case SCORING::SUM: return m_prs_info[i].prs;
+        case SCORING::SUM: return prs;
         case SCORING::STANDARDIZE:
-        case SCORING::CONTROL_STD: return (avg - m_mean_score) / m_score_sd;
+        case SCORING::CONTROL_STD: return (avg - mean) / sd;
         default:
             // default is avg
             return avg;
@@ -323,6 +353,47 @@ public:
     void get_null_score(const size_t& set_size, const size_t& prev_size,
                         std::vector<size_t>& background_list,
                         const bool first_run);
+    /*!
+     * \brief Store the PRS contribution of each background SNP, such that the
+     * null PRS can be calculated without reading the genotype file
+     * \param background is the index of the background SNPs
+     * \return false if the cache does not fit within the allowed memory, in
+     * which case get_null_score should be used
+     */
+    bool cache_background(const std::vector<size_t>& background);
+    /*!
+     * \brief Free the memory used by the background cache
+     */
+    void release_background()
+    {
+        std::vector<double>().swap(m_bk_score);
+        std::vector<uint8_t>().swap(m_bk_num_snp);
+        std::vector<bool>().swap(m_bk_valid);
+        std::vector<size_t>().swap(m_bk_index);
+    }
+    /*!
+     * \brief Calculate a block of null PRS from the cached background, as the
+     * product of the background score matrix (sample x SNP) and a sparse
+     * selection matrix (SNP x null PRS). The samples are processed in tiles,
+     * such that the tile of each selected SNP is reused from cache across the
+     * whole block. Thread safe, cache_background must be called first
+     * \param col_start is the offset of the first selected SNP of each column
+     * in snp_pos, followed by the total number of selected SNPs
+     * \param snp_pos contains the position of the selected SNPs within the
+     * background given to cache_background, sorted within each column
+     * \param num_set_size is the number of nested columns of each selection.
+     * Each column adds its SNPs to the previous column, except for every
+     * num_set_size column which starts from zero
+     * \param prs and num_snp are the buffers of the sum of score and of the
+     * number of SNPs
+     * \param score stores the required PRS of each sample (row) for each
+     * column
+     */
+    void null_score_block(const std::vector<size_t>& col_start,
+                          const std::vector<size_t>& snp_pos,
+                          const size_t num_set_size, std::vector<double>& prs,
+                          std::vector<uint32_t>& num_snp,
+                          std::vector<double>& score) const;
     /*!
      * \brief return the largest chromosome allowed
      * \return  the largest chromosome
@@ -333,12 +404,96 @@ public:
      * intermediate output generation
      */
     void expect_reference() { m_expect_reference = true; }
+    /*!
+     * \brief Read the base file and store the SNPs that pass the filters
+     * \param base_idx is the column of the base file in the score matrix. If
+     *        not 0, the summary statistics are only stored in the score
+     *        matrix, and SNPs not found in previous base files are added.
+     *        init_score_matrix must be called before reading these files
+     */
     void read_base(const BaseFile& base_file, const QCFiltering& base_qc,
                    const PThresholding& threshold_info,
                    const std::vector<IITree<size_t, size_t>>& exclusion_regions,
-                   const bool keep_ambig);
+                   const bool keep_ambig, const size_t base_idx = 0);
+    /*!
+     * \brief Prepare the score matrix after the first base file is read. The
+     *        first column of the matrix is the summary statistic of the first
+     *        base file
+     * \param num_base is the total number of base files
+     */
+    void init_score_matrix(const size_t num_base);
+    /*!
+     * \brief Calculate the PRS of all samples for every base file with a
+     *        single pass through the target genotypes, and write them to
+     *        <out>.score_matrix. No p-value thresholding is performed
+     * \param out is the output prefix
+     * \param base_names is the name of each base file, used as the header
+     */
+    void score_matrix(const std::string& out,
+                      const std::vector<std::string>& base_names);
     void build_clump_windows(const unsigned long long& clump_distance);
-    intptr_t cal_avail_memory(const uintptr_t founder_ctv2);
+    /*!
+     * \brief Calculate the amount of memory to reserve for clumping
+     * \param founder_ctv2 is the number of words required for one SNP
+     * \param max_cache_snp is the maximum number of SNPs a thread will cache
+     * \param num_thread is the number of thread requested, will be reduced if
+     * there isn't enough memory for all of them
+     * \return the amount of memory (in MB) to reserve
+     */
+    intptr_t cal_avail_memory(const uintptr_t founder_ctv2,
+                              const size_t max_cache_snp, size_t& num_thread);
+    /*!
+     * \brief Partition m_existed_snps into blocks such that no clump window
+     * span across two blocks. SNPs from different blocks can therefore be
+     * clumped independently
+     * \param block_snps will contain the index of SNPs in each block, ordered
+     * the same way as m_sort_by_p_index
+     */
+    void build_clump_blocks(std::vector<std::vector<size_t>>& block_snps);
+    /*!
+     * \brief Calculate the R2 between each SNP and all SNPs located after it
+     * within its clump window, and write those with R2 >= ld_store_r2 to the
+     * LD store. SNPs are visited in coordinate order so that each genotype
+     * is only read once
+     * \param clump_info contains the output file name and R2 floor
+     * \param reference is the genotype used for LD calculation
+     */
+    void export_ld_store(const Clumping& clump_info, Genotype& reference);
+    /*!
+     * \brief Perform clumping using the R2 stored in the LD store instead of
+     * calculating them from the genotypes. The R2 involving SNPs that are not
+     * in the LD store (e.g. removed by the filters of the run generating it)
+     * are calculated from the reference genotypes
+     * \param clump_info contains the LD store file name and thresholds
+     * \param reference is the genotype used to generate the LD store
+     * \param remain_core will be set to true for the index SNPs
+     */
+    void store_clumping(const Clumping& clump_info, Genotype& reference,
+                        std::vector<char>& remain_core);
+    /*!
+     * \brief Remove all non-index SNPs from m_existed_snps after clumping
+     */
+    void finish_clumping(const std::vector<char>& remain_core);
+    /*!
+     * \brief Clump the blocks in block_snps until none remains. Multiple
+     * workers can run at the same time as long as each has its own window
+     * \param next_block is the index of the next block to be processed
+     * \param processed is the number of SNPs processed, use for progress
+     * \param read_mutex guard the reading of the reference genotype
+     * \param cache_data is the memory used to cache the genotypes
+     * \param cache_size is the number of SNPs cache_data can hold, must be at
+     * least m_max_window_size
+     * \param remain_core is set to true for each index SNP
+     * \param print_progress indicate if this worker should print the progress
+     */
+    void clump_worker(const Clumping& clump_info, Genotype& reference,
+                      const std::vector<std::vector<size_t>>& block_snps,
+                      std::atomic<size_t>& next_block,
+                      std::atomic<size_t>& processed, std::mutex& read_mutex,
+                      uintptr_t* cache_data, const size_t cache_size,
+                      std::vector<uintptr_t>& founder_include2,
+                      std::vector<char>& remain_core,
+                      const bool print_progress);
     void build_membership_matrix(std::vector<size_t>& region_membership,
                                  std::vector<size_t>& region_start_idx,
                                  const size_t num_sets, const std::string& out,
@@ -431,8 +586,25 @@ public:
     }
     void init_memory()
     {
+        if (g_allow_mmap) m_genotype_file.use_mmap();
         m_genotype_file.init_memory_map(g_allowed_memory, m_data_size);
     }
+    /*!
+     * \brief Print the number of genotype blocks read and the time spent
+     *        waiting for them since the last call
+     */
+    void print_read_summary()
+    {
+        if (m_genotype_file.num_read() == 0) return;
+        std::ostringstream message;
+        message << std::fixed << "Read " << m_genotype_file.num_read()
+                << " genotype block(s) (" << std::setprecision(2)
+                << static_cast<double>(m_genotype_file.read_byte()) / 1048576.0
+                << " MB), waited " << std::setprecision(3)
+                << m_genotype_file.stall_time() << " second(s) for I/O";
+        m_reporter->report(message.str());
+        m_genotype_file.reset_counter();
+    }
     void snp_extraction(const std::string& extract_snps,
                         const std::string& exclude_snps);
 
@@ -475,16 +647,143 @@ protected:
     // protected elements
     friend class BinaryPlink;
     friend class BinaryGen;
+    // Location of the columns required from a line of the base file, with
+    // the p-value, statistic and coordinate already converted
+    struct BaseLine
+    {
+        const char* line;
+        size_t length;
+        const char* field[+BASE_INDEX::MAX];
+        size_t field_length[+BASE_INDEX::MAX];
+        double pvalue;
+        double stat;
+        size_t loc;
+        bool enough_column;
+        bool valid_pvalue;
+        bool valid_stat;
+        bool valid_loc;
+        const char* begin(BASE_INDEX idx) const { return field[+idx]; }
+        const char* end(BASE_INDEX idx) const
+        {
+            return field[+idx] + field_length[+idx];
+        }
+        std::string get(BASE_INDEX idx) const
+        {
+            return std::string(field[+idx], field_length[+idx]);
+        }
+    };
+    /*!
+     * \brief Locate the required columns of all non-empty lines within
+     *        [begin, end) and convert their p-value, statistic and
+     *        coordinate. The lines are split across m_prs_calculation.thread
+     *        threads
+     * \param begin is the start of the block, must be start of a line
+     * \param end is the end of the block, must be end of a line
+     * \param base_file contains the column information
+     * \param lines will contain the parsed lines in file order
+     */
+    void parse_base_block(const char* begin, const char* end,
+                          const BaseFile& base_file,
+                          std::vector<BaseLine>& lines);
+    /*!
+     * \brief Advise the OS of the genotype blocks that will soon be read, so
+     *        that they are loaded while the current SNPs are processed. Should
+     *        be called before reading the cur-th SNP of a list of SNPs sorted
+     *        by file position. New blocks are advised in batches, when the
+     *        advised blocks are about to run out
+     * \param cur is the index of the SNP that is going to be read
+     * \param total is the number of SNPs in the list
+     * \param is_ref indicate if the reference file location should be used
+     * \param snp_at returns the i-th SNP of the list
+     */
+    template <typename SNPAt>
+    void read_ahead(const size_t cur, const size_t total, const bool is_ref,
+                    SNPAt&& snp_at)
+    {
+        if (m_data_size == 0) return;
+        const size_t depth = std::max<size_t>(
+            1, std::min<unsigned long long>(READ_AHEAD_DEPTH,
+                                            READ_AHEAD_BYTES / m_data_size));
+        // restart when a new list is read or when we jump ahead
+        if (cur == 0 || cur > m_read_ahead_end) m_read_ahead_end = cur;
+        if (cur + depth <= m_read_ahead_end || m_read_ahead_end >= total)
+            return;
+        m_read_ahead_end = advise_range(m_read_ahead_end,
+                                        std::min(total, cur + 2 * depth),
+                                        is_ref, snp_at);
+    }
+    /*!
+     * \brief Advise the OS of the genotype blocks of SNPs within [begin, end)
+     *        of a list sorted by file position. At most READ_AHEAD_BYTES are
+     *        advised, starting from begin
+     * \return the end of the advised range
+     */
+    template <typename SNPAt>
+    size_t advise_range(const size_t begin, const size_t end,
+                        const bool is_ref, SNPAt&& snp_at)
+    {
+        if (m_data_size == 0 || begin >= end) return begin;
+        const size_t stop = std::min<unsigned long long>(
+            end, begin
+                     + std::max<unsigned long long>(
+                         1, READ_AHEAD_BYTES / m_data_size));
+        size_t file_idx;
+        long long byte_pos;
+        for (size_t i = begin; i < stop; ++i)
+        {
+            snp_at(i).get_file_info(file_idx, byte_pos, is_ref);
+            const std::string file = read_ahead_file(file_idx, byte_pos);
+            if (!file.empty())
+            { m_genotype_file.will_need(file, byte_pos, m_data_size); }
+        }
+        m_genotype_file.advise();
+        return stop;
+    }
+    /*!
+     * \brief Return the file from which the genotype located at byte_pos of
+     *        the file_idx-th genotype file will be read, or an empty string
+     *        if the genotype is not read from a file
+     */
+    virtual std::string read_ahead_file(const size_t /*file_idx*/,
+                                        const long long /*byte_pos*/) const
+    {
+        return "";
+    }
     // vector storing all the genotype files
     // std::vector<Sample> m_sample_names;
     MemoryRead m_genotype_file;
+    // storage of the rsID and alleles of m_existed_snps
+    StringArena m_id_arena;
+    AlleleTable m_allele_table;
     std::vector<SNP> m_existed_snps;
-    std::unordered_map<std::string, size_t> m_existed_snps_index;
+    // index of the SNPs in m_existed_snps. When reading the base file, it also
+    // keeps the ID of the filtered SNPs for duplicate detection
+    StringIndex m_existed_snps_index;
     std::unordered_set<std::string> m_sample_selection_list;
     std::unordered_set<std::string> m_snp_selection_list;
     std::vector<std::set<double>> m_set_thresholds;
     std::vector<Sample_ID> m_sample_id;
-    std::vector<PRS> m_prs_info;
+    // PRS of each sample, stored separately from the number of SNPs
+    // contributing to it so that scoring streams over contiguous doubles
+    std::vector<double> m_prs_score;
+    std::vector<uint32_t> m_prs_num_snp;
+    // unfiltered index of each included sample. Only filled when some samples
+    // are excluded, in which case genotypes are scored without subsetting
+    std::vector<uint32_t> m_sample_gather;
+    // summary statistic of each SNP (row) in each base file (column), NaN if
+    // the SNP is not found in the base file
+    std::vector<ScoreBaseStat> m_base_stat;
+    // PRS and number of SNPs of each sample (row) for each base file (column)
+    std::vector<double> m_score_matrix;
+    std::vector<uint32_t> m_score_matrix_num_snp;
+    // PRS contribution and number of SNPs of each background SNP, one column
+    // of m_sample_ct samples per SNP
+    std::vector<double> m_bk_score;
+    std::vector<uint8_t> m_bk_num_snp;
+    // false for the background SNPs that are not scored (e.g. all missing)
+    std::vector<bool> m_bk_valid;
+    // the background SNPs stored in the cache
+    std::vector<size_t> m_bk_index;
     std::vector<std::string> m_genotype_file_names;
     std::vector<mio::mmap_source> m_genotype_files;
     std::vector<double> m_thresholds;
@@ -515,7 +814,7 @@ protected:
     double m_homcom_weight = 0;
     double m_het_weight = 1;
     double m_homrar_weight = 2;
-    unsigned long long m_data_size;
+    unsigned long long m_data_size = 0;
     size_t m_num_thresholds = 0;
     size_t m_thread = 1; // number of final samples
     size_t m_max_window_size = 0;
@@ -525,12 +824,19 @@ protected:
     size_t m_num_info_filter = 0;
     size_t m_num_xrange = 0;
     size_t m_base_missed = 0;
+    size_t m_num_base = 1;
     static unsigned long long g_allowed_memory;
     uintptr_t m_unfiltered_sample_ct = 0; // number of unfiltered samples
     uintptr_t m_unfiltered_marker_ct = 0;
     uintptr_t m_sample_ct = 0;
     uintptr_t m_founder_ct = 0;
     uintptr_t m_marker_ct = 0;
+    // hash of the founder IDs and of all variants in the genotype files, used
+    // to check that an LD store was generated from the same LD reference
+    uint64_t m_founder_hash = FNV_OFFSET_BASIS;
+    uint64_t m_variant_hash = FNV_OFFSET_BASIS;
+    // index of the first SNP that is not yet advised by read_ahead
+    size_t m_read_ahead_end = 0;
     uint32_t m_max_category = 0;
     uint32_t m_autosome_ct = 0;
     uint32_t m_max_code = 0;
@@ -670,7 +976,7 @@ protected:
     /*!
      * \brief Function to read in the sample. Any subclass must implement this
      * function. They \b must initialize the \b m_sample_info \b m_founder_info
-     * \b m_founder_ct \b m_sample_ct \b m_prs_info \b m_in_regression and \b
+     * \b m_founder_ct \b m_sample_ct \b m_prs_score \b m_in_regression and \b
      * m_tmp_genotype (optional)
      * \return vector containing the sample information
      */
@@ -712,6 +1018,25 @@ protected:
             popcount2_longs(&(index_data[2 * founder_ctv2]), founder_ctl2);
     }
 
+    /*!
+     * \brief Obtain the missing, het and homset counts of the window SNP
+     *        within each of the three index genotype masks stored in
+     *        index_data. Result of mask k is stored in counts[3k] to
+     *        counts[3k+2], which is the same as calling genovec_3freq on each
+     *        mask, except that the window genotype is only traversed once
+     *        when the CPU supports AVX2, or hardware popcount for short
+     *        genotypes
+     * \param geno is the genotype of the window SNP
+     * \param index_data contains the three masks, each founder_ctv2 long
+     * \param founder_ctl2 is the number of words per genotype
+     * \param founder_ctv2 is the offset between the masks
+     * \param counts is the output, must have at least 9 elements
+     */
+    static void genovec_3x3freq(const uintptr_t* geno,
+                                const uintptr_t* index_data,
+                                const uintptr_t founder_ctl2,
+                                const uintptr_t founder_ctv2,
+                                uint32_t* counts);
     double get_r2(const uintptr_t founder_ctl2, const uintptr_t founder_ctv2,
                   uintptr_t* window_data_ptr,
                   std::vector<uintptr_t>& index_data,
@@ -733,14 +1058,10 @@ protected:
         // calculate the counts
         // these counts are then used for calculation of R2. However, I
         // don't fully understand the algorithm here (copy from PLINK2)
-        genovec_3freq(window_data_ptr, index_data.data(), founder_ctl2,
-                      &(counts[0]), &(counts[1]), &(counts[2]));
+        genovec_3x3freq(window_data_ptr, index_data.data(), founder_ctl2,
+                        founder_ctv2, counts);
         counts[0] = index_tots[0] - counts[0] - counts[1] - counts[2];
-        genovec_3freq(window_data_ptr, &(index_data[founder_ctv2]),
-                      founder_ctl2, &(counts[3]), &(counts[4]), &(counts[5]));
         counts[3] = index_tots[1] - counts[3] - counts[4] - counts[5];
-        genovec_3freq(window_data_ptr, &(index_data[2 * founder_ctv2]),
-                      founder_ctl2, &(counts[6]), &(counts[7]), &(counts[8]));
         counts[6] = index_tots[2] - counts[6] - counts[7] - counts[8];
         if (!em_phase_hethet_nobase(counts, is_x, is_x, &freq1x, &freq2x,
                                     &freqx1, &freqx2, &freq11))
@@ -769,14 +1090,135 @@ protected:
                   const double homcom_weight, const double het_weight,
                   const double homrar_weight, const bool not_first)
     {
-        uintptr_t* lbptr = genotype.data();
+        read_prs(genotype.data(), 0, m_sample_ct, ploidy, stat, adj_score,
+                 miss_score, miss_count, homcom_weight, het_weight,
+                 homrar_weight, not_first);
+    }
+    /*!
+     * \brief Add the PRS contribution of one SNP to samples within
+     *        [start_sample, end_sample). start_sample must be a multiple of
+     *        BITCT2 so that the range starts at a genotype word boundary.
+     *        Samples outside the range are left untouched, which allow
+     *        multiple threads to work on disjoint sample ranges at once.
+     *        If gather is true, genotype is the unfiltered genotype and the
+     *        included samples are located using m_sample_gather
+     */
+    void read_prs(const uintptr_t* genotype, const size_t start_sample,
+                  const size_t end_sample, const size_t ploidy,
+                  const double stat, const double adj_score,
+                  const double miss_score, const size_t miss_count,
+                  const double homcom_weight, const double het_weight,
+                  const double homrar_weight, const bool not_first,
+                  const bool gather = false)
+    {
+        assert(gather || start_sample % BITCT2 == 0);
+        if (start_sample >= end_sample) return;
+        // the contribution of each genotype only depends on the 2-bit code,
+        // so we compute them once per SNP and replace the per-sample switch
+        // with a table lookup. Codes are the bitwise NOT of the PLINK code:
+        // 0 = hom common, 1 = het, 2 = missing, 3 = hom rare
+        const double prs_lut[4] = {homcom_weight * stat - adj_score,
+                                   het_weight * stat - adj_score, miss_score,
+                                   homrar_weight * stat - adj_score};
+        const uint32_t count_lut[4] = {static_cast<uint32_t>(ploidy),
+                                       static_cast<uint32_t>(ploidy),
+                                       static_cast<uint32_t>(miss_count),
+                                       static_cast<uint32_t>(ploidy)};
+        if (gather && not_first)
+        {
+            decode_prs_gather<true>(genotype, start_sample, end_sample,
+                                    prs_lut, count_lut);
+        }
+        else if (gather)
+        {
+            decode_prs_gather<false>(genotype, start_sample, end_sample,
+                                     prs_lut, count_lut);
+        }
+        else
+        {
+            // complete genotype words are handled by the SIMD kernel when
+            // the CPU supports it, leaving the rest to decode_prs
+            const size_t simd_end =
+                decode_prs_simd(genotype, start_sample, end_sample, prs_lut,
+                                count_lut, not_first);
+            if (not_first)
+            {
+                decode_prs<true>(genotype, simd_end, end_sample, prs_lut,
+                                 count_lut);
+            }
+            else
+            {
+                decode_prs<false>(genotype, simd_end, end_sample, prs_lut,
+                                  count_lut);
+            }
+        }
+    }
+    /*!
+     * \brief AVX2 version of decode_prs for the complete genotype words
+     *        within [start_sample, end_sample). The codes of four samples
+     *        are expanded at once and used as indices of the lookup tables
+     *        held in registers
+     * \return the first sample that was not decoded, which is start_sample
+     *         if the CPU does not support AVX2
+     */
+    size_t decode_prs_simd(const uintptr_t* genotype, const size_t start_sample,
+                           const size_t end_sample, const double prs_lut[4],
+                           const uint32_t count_lut[4], const bool add_score);
+    /*!
+     * \brief Same as decode_prs, but read the genotype of included samples
+     *        from the unfiltered genotype through m_sample_gather. This avoid
+     *        subsetting the genotype, so the work is proportional to the
+     *        number of included samples. Any sample range can be used
+     */
+    template <bool add_score>
+    void decode_prs_gather(const uintptr_t* genotype, const size_t start_sample,
+                           const size_t end_sample, const double prs_lut[4],
+                           const uint32_t count_lut[4])
+    {
+        const uint32_t* sample_idx = m_sample_gather.data();
+        double* prs_ptr = m_prs_score.data();
+        uint32_t* num_snp_ptr = m_prs_num_snp.data();
+        for (size_t i = start_sample; i < end_sample; ++i)
+        {
+            const uint32_t idx = sample_idx[i];
+            const uintptr_t geno =
+                (~genotype[idx / BITCT2] >> ((idx % BITCT2) * 2)) & 3;
+            if (add_score)
+            {
+                prs_ptr[i] += prs_lut[geno];
+                num_snp_ptr[i] += count_lut[geno];
+            }
+            else
+            {
+                prs_ptr[i] = prs_lut[geno];
+                num_snp_ptr[i] = count_lut[geno];
+            }
+        }
+    }
+    /*!
+     * \brief Branchless kernel used by read_prs. Each genotype word is
+     *        expanded two bits at a time into an index of the lookup tables.
+     *        The inner loop has a fixed trip count and no data dependent
+     *        branch, which allow the compiler to unroll and vectorize it
+     * \tparam add_score is true if we should add to the existing PRS, false if
+     *         we should overwrite it (i.e. for the first SNP)
+     */
+    template <bool add_score>
+    void decode_prs(const uintptr_t* genotype, const size_t start_sample,
+                    const size_t end_sample, const double prs_lut[4],
+                    const uint32_t count_lut[4])
+    {
+        const uintptr_t* lbptr = genotype + start_sample / BITCT2;
+        // samples in the last word are bounded by end_sample
+        const size_t full_end =
+            start_sample
+            + ((end_sample - start_sample) / BITCT2) * BITCT2;
+        double* prs_ptr = &m_prs_score[start_sample];
+        uint32_t* num_snp_ptr = &m_prs_num_snp[start_sample];
         uintptr_t ulii;
-        uint32_t uii;
+        size_t uii = start_sample;
         uint32_t ujj;
-        uint32_t ukk;
-        uii = 0;
-        ulii = 0;
-        do
+        for (; uii < end_sample; uii += BITCT2)
         {
             // ulii contain the numeric representation of the current genotype
             ulii = ~(*lbptr++);
@@ -786,74 +1228,367 @@ protected:
                 ulii &= (ONELU << ((m_unfiltered_sample_ct & (BITCT2 - 1)) * 2))
                         - ONELU;
             }
-            // ujj sample index of the current genotype block
-            ujj = 0;
-            while (ujj < BITCT)
+            const uint32_t sample_in_word =
+                (uii < full_end) ? BITCT2
+                                 : static_cast<uint32_t>(end_sample - uii);
+            for (ujj = 0; ujj < sample_in_word; ++ujj)
             {
-                // go through the whole genotype block
-                // ukk is the current genotype
-                ukk = (ulii >> ujj) & 3;
-                // and the sample index can be calculated as uii+(ujj/2)
-                if (uii + (ujj / 2) >= m_sample_ct) { break; }
-                auto&& sample_prs = m_prs_info[uii + (ujj / 2)];
-                // now we will get all genotypes (0, 1, 2, 3)
-                if (not_first)
+                const uintptr_t geno = (ulii >> (ujj * 2)) & 3;
+                if (add_score)
                 {
-                    switch (ukk)
-                    {
-                    default:
-                        // true = 1, false = 0
-                        sample_prs.num_snp += ploidy;
-                        sample_prs.prs += homcom_weight * stat - adj_score;
-                        break;
-                    case 1:
-                        sample_prs.num_snp += ploidy;
-                        sample_prs.prs += het_weight * stat - adj_score;
-                        break;
-                    case 3:
-                        sample_prs.num_snp += ploidy;
-                        sample_prs.prs += homrar_weight * stat - adj_score;
-                        break;
-                    case 2:
-                        // handle missing sample
-                        sample_prs.num_snp += miss_count;
-                        sample_prs.prs += miss_score;
-                        break;
-                    }
+                    prs_ptr[ujj] += prs_lut[geno];
+                    num_snp_ptr[ujj] += count_lut[geno];
                 }
                 else
                 {
-                    switch (ukk)
+                    prs_ptr[ujj] = prs_lut[geno];
+                    num_snp_ptr[ujj] = count_lut[geno];
+                }
+            }
+            prs_ptr += BITCT2;
+            num_snp_ptr += BITCT2;
+        }
+    }
+
+    /*!
+     * \brief Fill m_sample_gather if some samples are excluded, such that the
+     *        PRS can be calculated from the unfiltered genotype
+     */
+    void init_sample_gather()
+    {
+        m_sample_gather.clear();
+        if (m_sample_ct == m_unfiltered_sample_ct) return;
+        m_sample_gather.reserve(m_sample_ct);
+        for (uint32_t i = 0; i < m_unfiltered_sample_ct; ++i)
+        {
+            if (IS_SET(m_sample_include.data(), i))
+            { m_sample_gather.push_back(i); }
+        }
+    }
+    /*!
+     * \brief Number of SNPs we should buffer before calling score_block
+     * \param word_ct is the number of words used to store one SNP
+     * \param num_snp is the number of SNPs remaining to be scored
+     * \return the number of SNPs in one block
+     */
+    size_t score_block_size(const size_t word_ct, const size_t num_snp) const
+    {
+        const size_t max_block =
+            std::max<size_t>(1, SCORE_BLOCK_BYTES
+                                    / (std::max<size_t>(1, word_ct)
+                                       * sizeof(uintptr_t)));
+        return std::max<size_t>(1, std::min(max_block, num_snp));
+    }
+    /*!
+     * \brief Add the PRS contribution of a block of SNPs to all samples.
+     *        Samples are partitioned, in genotype word boundaries, across
+     *        m_prs_calculation.thread threads. Each thread owns a disjoint
+     *        slice of m_prs_score and goes through the SNPs in their original
+     *        order, thus the result is identical to the single thread result
+     * \param block contains the sample subsetted genotype of each SNP, one
+     *        SNP every word_ct words
+     * \param weights contains the scoring parameters of each SNP
+     * \param word_ct is the number of words used to store one SNP
+     * \param ploidy is the ploidy of the genotype
+     * \param gather is true if block contains the unfiltered genotype, which
+     *        is scored through m_sample_gather
+     */
+    void score_block(const std::vector<uintptr_t>& block,
+                     const std::vector<SNPScoreWeight>& weights,
+                     const size_t word_ct, const size_t ploidy,
+                     const bool gather = false)
+    {
+        if (weights.empty()) return;
+        // samples are partitioned by words of the sample subsetted genotype
+        const size_t sample_word_ct = QUATERCT_TO_WORDCT(m_sample_ct);
+        size_t num_thread = static_cast<size_t>(
+            std::max(1, m_prs_calculation.thread));
+        // don't bother with threading when there are too few samples
+        num_thread =
+            std::min(num_thread, sample_word_ct / MIN_SCORE_THREAD_WORD);
+        if (num_thread <= 1)
+        {
+            score_block_range(block, weights, word_ct, ploidy, 0, m_sample_ct,
+                              gather);
+            return;
+        }
+        const size_t word_per_thread = sample_word_ct / num_thread;
+        const size_t remain = sample_word_ct % num_thread;
+        std::vector<std::thread> workers;
+        size_t start_word = 0, end_word;
+        for (size_t i_thread = 0; i_thread < num_thread; ++i_thread)
+        {
+            end_word = start_word + word_per_thread + (i_thread < remain);
+            const size_t start_sample = start_word * BITCT2;
+            const size_t end_sample = std::min(end_word * BITCT2, m_sample_ct);
+            workers.push_back(std::thread(&Genotype::score_block_range, this,
+                                          std::cref(block), std::cref(weights),
+                                          word_ct, ploidy, start_sample,
+                                          end_sample, gather));
+            start_word = end_word;
+        }
+        for (auto&& thread : workers) { thread.join(); }
+    }
+    void score_block_range(const std::vector<uintptr_t>& block,
+                           const std::vector<SNPScoreWeight>& weights,
+                           const size_t word_ct, const size_t ploidy,
+                           const size_t start_sample, const size_t end_sample,
+                           const bool gather)
+    {
+        const uintptr_t* genotype = block.data();
+        for (auto&& w : weights)
+        {
+            read_prs(genotype, start_sample, end_sample, ploidy, w.stat,
+                     w.adj_score, w.miss_score, w.miss_count, w.homcom_weight,
+                     w.het_weight, w.homrar_weight, w.not_first, gather);
+            genotype += word_ct;
+        }
+    }
+    /*!
+     * \brief Calculate the score weight of a SNP
+     * \param stat is the summary statistic of the SNP
+     * \param maf is the frequency calculated from the genotype counts, before
+     *        accounting for flipping
+     * \param flipped indicate if the target alleles are flipped
+     */
+    SNPScoreWeight score_weight(const double stat, double maf,
+                                const bool flipped, const size_t ploidy,
+                                const bool not_first) const
+    {
+        double homcom_weight = m_homcom_weight;
+        double homrar_weight = m_homrar_weight;
+        if (flipped)
+        {
+            std::swap(homcom_weight, homrar_weight);
+            maf = 1.0 - maf;
+        }
+        // missing genotypes only count when they are not set to zero, and
+        // only contribute to the score when they are imputed by the mean
+        const size_t miss_count =
+            (m_prs_calculation.missing_score != MISSING_SCORE::SET_ZERO)
+            * ploidy;
+        double adj_score = 0;
+        if (m_prs_calculation.missing_score == MISSING_SCORE::CENTER)
+        { adj_score = ploidy * stat * maf; }
+        double miss_score = 0;
+        if (m_prs_calculation.missing_score == MISSING_SCORE::MEAN_IMPUTE)
+        { miss_score = ploidy * stat * maf; }
+        return SNPScoreWeight {stat,          adj_score,    miss_score,
+                               homcom_weight, m_het_weight, homrar_weight,
+                               miss_count,    not_first};
+    }
+    /*!
+     * \brief Add the lookup tables of a SNP to the score matrix block. The
+     *        tables contain the score and count of each base file for each
+     *        genotype code, in the same order as used by read_prs
+     * \param stat is the row of m_base_stat of the SNP
+     */
+    void add_score_matrix_lut(const ScoreBaseStat* stat, const double maf,
+                              const bool flipped, const size_t ploidy,
+                              std::vector<double>& prs_lut,
+                              std::vector<uint32_t>& count_lut) const
+    {
+        const size_t offset = prs_lut.size();
+        prs_lut.resize(offset + 4 * m_num_base, 0.0);
+        count_lut.resize(offset + 4 * m_num_base, 0);
+        double* prs = &prs_lut[offset];
+        uint32_t* count = &count_lut[offset];
+        for (size_t i_base = 0; i_base < m_num_base; ++i_base)
+        {
+            // SNPs not found in the base file do not contribute
+            if (std::isnan(stat[i_base].stat)) continue;
+            const SNPScoreWeight w =
+                score_weight(stat[i_base].stat, maf,
+                             flipped != stat[i_base].flipped, ploidy, true);
+            prs[i_base] = w.homcom_weight * w.stat - w.adj_score;
+            prs[m_num_base + i_base] = w.het_weight * w.stat - w.adj_score;
+            prs[2 * m_num_base + i_base] = w.miss_score;
+            prs[3 * m_num_base + i_base] =
+                w.homrar_weight * w.stat - w.adj_score;
+            count[i_base] = static_cast<uint32_t>(ploidy);
+            count[m_num_base + i_base] = static_cast<uint32_t>(ploidy);
+            count[2 * m_num_base + i_base] =
+                static_cast<uint32_t>(w.miss_count);
+            count[3 * m_num_base + i_base] = static_cast<uint32_t>(ploidy);
+        }
+    }
+    /*!
+     * \brief Add a block of SNPs to the score matrix. Each genotype is decoded
+     *        once and its lookup row, which contains the score of every base
+     *        file, is added to the row of the sample. Samples are partitioned
+     *        across threads the same way as score_block
+     * \param num_snp is the number of SNPs in the block
+     */
+    void score_matrix_block(const std::vector<uintptr_t>& block,
+                            const std::vector<double>& prs_lut,
+                            const std::vector<uint32_t>& count_lut,
+                            const size_t num_snp, const size_t word_ct,
+                            const bool gather)
+    {
+        if (num_snp == 0) return;
+        const size_t sample_word_ct = QUATERCT_TO_WORDCT(m_sample_ct);
+        size_t num_thread = static_cast<size_t>(
+            std::max(1, m_prs_calculation.thread));
+        num_thread =
+            std::min(num_thread, sample_word_ct / MIN_SCORE_THREAD_WORD);
+        if (num_thread <= 1)
+        {
+            score_matrix_range(block, prs_lut, count_lut, num_snp, word_ct, 0,
+                               m_sample_ct, gather);
+            return;
+        }
+        const size_t word_per_thread = sample_word_ct / num_thread;
+        const size_t remain = sample_word_ct % num_thread;
+        std::vector<std::thread> workers;
+        size_t start_word = 0, end_word;
+        for (size_t i_thread = 0; i_thread < num_thread; ++i_thread)
+        {
+            end_word = start_word + word_per_thread + (i_thread < remain);
+            const size_t start_sample = start_word * BITCT2;
+            const size_t end_sample = std::min(end_word * BITCT2, m_sample_ct);
+            workers.push_back(std::thread(
+                &Genotype::score_matrix_range, this, std::cref(block),
+                std::cref(prs_lut), std::cref(count_lut), num_snp, word_ct,
+                start_sample, end_sample, gather));
+            start_word = end_word;
+        }
+        for (auto&& thread : workers) { thread.join(); }
+    }
+    void score_matrix_range(const std::vector<uintptr_t>& block,
+                            const std::vector<double>& prs_lut,
+                            const std::vector<uint32_t>& count_lut,
+                            const size_t num_snp, const size_t word_ct,
+                            const size_t start_sample, const size_t end_sample,
+                            const bool gather)
+    {
+        const size_t num_base = m_num_base;
+        // the rows of a tile of samples stay in cache while all SNPs of the
+        // block are added to them
+        const size_t tile_size = std::max<size_t>(
+            1, SCORE_MATRIX_TILE_BYTES
+                   / (num_base * (sizeof(double) + sizeof(uint32_t))));
+        for (size_t tile_start = start_sample; tile_start < end_sample;
+             tile_start += tile_size)
+        {
+            const size_t tile_end =
+                std::min(end_sample, tile_start + tile_size);
+            const uintptr_t* genotype = block.data();
+            for (size_t i_snp = 0; i_snp < num_snp; ++i_snp)
+            {
+                const double* snp_prs = &prs_lut[i_snp * 4 * num_base];
+                const uint32_t* snp_count = &count_lut[i_snp * 4 * num_base];
+                for (size_t i = tile_start; i < tile_end; ++i)
+                {
+                    const size_t idx = gather ? m_sample_gather[i] : i;
+                    const uintptr_t geno =
+                        (~genotype[idx / BITCT2] >> ((idx % BITCT2) * 2)) & 3;
+                    const double* prs = &snp_prs[geno * num_base];
+                    const uint32_t* count = &snp_count[geno * num_base];
+                    double* score = &m_score_matrix[i * num_base];
+                    uint32_t* num = &m_score_matrix_num_snp[i * num_base];
+                    for (size_t i_base = 0; i_base < num_base; ++i_base)
                     {
-                    default:
-                        // true = 1, false = 0
-                        sample_prs.num_snp = ploidy;
-                        sample_prs.prs = homcom_weight * stat - adj_score;
-                        break;
-                    case 1:
-                        sample_prs.num_snp = ploidy;
-                        sample_prs.prs = het_weight * stat - adj_score;
-                        break;
-                    case 3:
-                        sample_prs.num_snp = ploidy;
-                        sample_prs.prs = homrar_weight * stat - adj_score;
-                        break;
-                    case 2:
-                        // handle missing sample
-                        sample_prs.num_snp = miss_count;
-                        sample_prs.prs = miss_score;
-                        break;
+                        score[i_base] += prs[i_base];
+                        num[i_base] += count[i_base];
                     }
                 }
-                // ulii &= ~((3 * ONELU) << ujj);
-                // as each sample is represented by two byte, we will add 2 to
-                // the index
-                ujj += 2;
+                genotype += word_ct;
             }
-            // uii is the number of samples we have finished so far
-            uii += BITCT2;
-        } while (uii < m_sample_ct);
+        }
+    }
+    /*!
+     * \brief Add the lookup table of a SNP to the background block, in the
+     *        same order as used by read_prs
+     */
+    void add_background_lut(const SNPScoreWeight& w, const size_t ploidy,
+                            std::vector<double>& prs_lut,
+                            std::vector<uint8_t>& count_lut) const
+    {
+        prs_lut.push_back(w.homcom_weight * w.stat - w.adj_score);
+        prs_lut.push_back(w.het_weight * w.stat - w.adj_score);
+        prs_lut.push_back(w.miss_score);
+        prs_lut.push_back(w.homrar_weight * w.stat - w.adj_score);
+        count_lut.push_back(static_cast<uint8_t>(ploidy));
+        count_lut.push_back(static_cast<uint8_t>(ploidy));
+        count_lut.push_back(static_cast<uint8_t>(w.miss_count));
+        count_lut.push_back(static_cast<uint8_t>(ploidy));
+    }
+    /*!
+     * \brief Store the PRS contribution of a block of background SNPs in
+     *        m_bk_score and m_bk_num_snp. Samples are partitioned across
+     *        threads the same way as score_block
+     * \param bk_pos is the position of each SNP of the block within the
+     *        background
+     */
+    void background_block(const std::vector<uintptr_t>& block,
+                          const std::vector<double>& prs_lut,
+                          const std::vector<uint8_t>& count_lut,
+                          const std::vector<size_t>& bk_pos,
+                          const size_t word_ct, const bool gather)
+    {
+        if (bk_pos.empty()) return;
+        const size_t sample_word_ct = QUATERCT_TO_WORDCT(m_sample_ct);
+        size_t num_thread = static_cast<size_t>(
+            std::max(1, m_prs_calculation.thread));
+        num_thread =
+            std::min(num_thread, sample_word_ct / MIN_SCORE_THREAD_WORD);
+        if (num_thread <= 1)
+        {
+            background_range(block, prs_lut, count_lut, bk_pos, word_ct, 0,
+                             m_sample_ct, gather);
+            return;
+        }
+        const size_t word_per_thread = sample_word_ct / num_thread;
+        const size_t remain = sample_word_ct % num_thread;
+        std::vector<std::thread> workers;
+        size_t start_word = 0, end_word;
+        for (size_t i_thread = 0; i_thread < num_thread; ++i_thread)
+        {
+            end_word = start_word + word_per_thread + (i_thread < remain);
+            const size_t start_sample = start_word * BITCT2;
+            const size_t end_sample = std::min(end_word * BITCT2, m_sample_ct);
+            workers.push_back(std::thread(
+                &Genotype::background_range, this, std::cref(block),
+                std::cref(prs_lut), std::cref(count_lut), std::cref(bk_pos),
+                word_ct, start_sample, end_sample, gather));
+            start_word = end_word;
+        }
+        for (auto&& thread : workers) { thread.join(); }
     }
+    void background_range(const std::vector<uintptr_t>& block,
+                          const std::vector<double>& prs_lut,
+                          const std::vector<uint8_t>& count_lut,
+                          const std::vector<size_t>& bk_pos,
+                          const size_t word_ct, const size_t start_sample,
+                          const size_t end_sample, const bool gather)
+    {
+        const uintptr_t* genotype = block.data();
+        for (size_t i_snp = 0; i_snp < bk_pos.size(); ++i_snp)
+        {
+            const double* prs = &prs_lut[i_snp * 4];
+            const uint8_t* count = &count_lut[i_snp * 4];
+            double* score = &m_bk_score[bk_pos[i_snp] * m_sample_ct];
+            uint8_t* num_snp = &m_bk_num_snp[bk_pos[i_snp] * m_sample_ct];
+            for (size_t i = start_sample; i < end_sample; ++i)
+            {
+                const size_t idx = gather ? m_sample_gather[i] : i;
+                const uintptr_t geno =
+                    (~genotype[idx / BITCT2] >> ((idx % BITCT2) * 2)) & 3;
+                score[i] = prs[geno];
+                num_snp[i] = count[geno];
+            }
+            genotype += word_ct;
+        }
+    }
+    /*!
+     * \brief Add the SNP of a score base file to the score matrix
+     * \return false if the SNP does not match the one already stored
+     */
+    bool add_base_stat(const size_t base_idx, const std::string& rs_id,
+                       const size_t chr, const size_t loc,
+                       std::string& ref_allele, std::string& alt_allele,
+                       const double stat, const double pvalue,
+                       const unsigned long long category, const double pthres);
 
     /*!
      * \brief Function to read in the genotype in PLINK binary format. Any
@@ -874,7 +1609,37 @@ protected:
                bool /*reset_zero*/)
     {
     }
+    /*!
+     * \brief Add the SNPs to m_score_matrix. Any subclass supporting the
+     *        score matrix must implement this function
+     * \param snp_index is the index of the SNPs, sorted by their location in
+     *        the genotype files
+     */
+    virtual void read_score_matrix(const std::vector<size_t>& /*snp_index*/)
+    {
+        throw std::runtime_error(
+            "Error: Score matrix is not supported for this genotype format");
+    }
+    /*!
+     * \brief Fill m_bk_score and m_bk_num_snp with the PRS contribution of
+     *        each background SNP, and set m_bk_valid for the SNPs that are
+     *        scored. Any subclass supporting the background cache must
+     *        implement this function
+     * \param background is the index of the background SNPs
+     */
+    virtual void read_background(const std::vector<size_t>& /*background*/)
+    {
+        throw std::runtime_error(
+            "Error: Background cache is not supported for this genotype "
+            "format");
+    }
     void standardize_prs();
+    /*!
+     * \brief Calculate the mean and SD of the average score of the samples
+     * used for standardization
+     */
+    void score_mean_sd(const double* prs, const uint32_t* num_snp,
+                       double& mean, double& sd) const;
     // for loading the sample inclusion / exclusion set
     /*!
      * \brief Function to load in the sample extraction exclusion list
@@ -888,6 +1653,20 @@ protected:
 
     void shrink_snp_vector(const std::vector<bool>& retain)
     {
+        if (!m_base_stat.empty())
+        {
+            // keep the rows of the score matrix in sync with the SNPs
+            size_t num_retain = 0;
+            for (size_t i = 0; i < m_existed_snps.size(); ++i)
+            {
+                if (!retain[i]) continue;
+                const ScoreBaseStat* row = m_base_stat.data() + i * m_num_base;
+                std::copy(row, row + m_num_base,
+                          m_base_stat.data() + num_retain * m_num_base);
+                ++num_retain;
+            }
+            m_base_stat.resize(num_retain * m_num_base);
+        }
         m_existed_snps.erase(
             std::remove_if(m_existed_snps.begin(), m_existed_snps.end(),
                            [&retain, this](const SNP& s) {
@@ -0,0 +1,140 @@
+// This file is part of PRSice-2, copyright (C) 2016-2019
+// Shing Wan Choi, Paul F. O’Reilly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef PRSICE_INC_LDSTORE_HPP_
+#define PRSICE_INC_LDSTORE_HPP_
+#include <cstdint>
+#include <fstream>
+#include <mio.hpp>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define LD_STORE_MAGIC "PRSLDv02"
+#define LD_STORE_MAGIC_SIZE 8
+#define LD_STORE_HEADER_SIZE 64
+
+/*!
+ * \brief Sparse storage of the pairwise R2 between SNPs within the clumping
+ *        window, so that repeated clumping against the same LD reference does
+ *        not need to read the genotypes again. The file is written in native
+ *        byte order and contains:
+ *        - header: magic, number of SNPs, number of founders, hash of the
+ *          founder IDs, hash of the reference variant list, clump distance,
+ *          R2 floor and number of stored pairs
+ *        - pairs: for each SNP, the (partner, R2) of all SNPs located after it
+ *          within the window with R2 >= floor, sorted by partner index
+ *        - offsets: the first pair of each SNP (number of SNPs + 1 entries)
+ *        - SNP table: chromosome, coordinate and ID of each SNP
+ *        The pairs and offsets are read directly from the memory mapped file
+ */
+class LDStore
+{
+public:
+    // R2 are kept in double precision such that the clumping decisions are
+    // the same as when the R2 are calculated from the genotypes
+    struct Pair
+    {
+        uint64_t partner;
+        double r2;
+    };
+    LDStore() {}
+    LDStore(const LDStore&) = delete;
+    LDStore& operator=(const LDStore&) = delete;
+    /*!
+     * \brief Start writing a new LD store
+     * \param file is the output file name
+     * \param founder_ct is the number of founders used for the R2 calculation
+     * \param founder_hash is the hash of the founder IDs
+     * \param variant_hash is the hash of the variants in the LD reference
+     * \param distance is the clump distance used to define the windows
+     * \param r2_floor is the minimum R2 to be stored
+     */
+    void create(const std::string& file, const uint64_t founder_ct,
+                const uint64_t founder_hash, const uint64_t variant_hash,
+                const uint64_t distance, const double r2_floor);
+    /*!
+     * \brief Add the R2 between the current SNP and a SNP located after it.
+     *        Must be called with increasing partner index
+     */
+    void add_pair(const size_t partner, const double r2)
+    {
+        if (r2 < m_r2_floor) return;
+        Pair pair = {static_cast<uint64_t>(partner), r2};
+        m_out.write(reinterpret_cast<const char*>(&pair), sizeof(Pair));
+        ++m_num_pair;
+    }
+    /*!
+     * \brief Finish the current SNP. All pairs added before this call belong
+     *        to this SNP
+     */
+    void add_snp(const std::string& rs, const size_t chr, const size_t loc);
+    /*!
+     * \brief Write the offsets and SNP table and complete the header
+     */
+    void close();
+    /*!
+     * \brief Memory map an existing LD store and load its SNP table
+     */
+    void load(const std::string& file);
+    /*!
+     * \brief Return the index of the SNP in the store, or ~size_t(0) if the
+     *        SNP is not found
+     */
+    size_t find(const std::string& rs) const
+    {
+        auto&& idx = m_snp_index.find(rs);
+        if (idx == m_snp_index.end()) return ~size_t(0);
+        return idx->second;
+    }
+    /*!
+     * \brief Return the stored R2 between two SNPs, or -1 if the R2 of the
+     *        pair is below the floor and therefore not stored
+     */
+    double r2(const size_t a, const size_t b) const;
+    size_t chr(const size_t idx) const { return m_chr[idx]; }
+    size_t loc(const size_t idx) const { return m_loc[idx]; }
+    size_t num_snp() const { return m_num_snp; }
+    uint64_t founder_ct() const { return m_founder_ct; }
+    uint64_t founder_hash() const { return m_founder_hash; }
+    uint64_t variant_hash() const { return m_variant_hash; }
+    uint64_t distance() const { return m_distance; }
+    double r2_floor() const { return m_r2_floor; }
+
+protected:
+    mio::mmap_source m_memory_map;
+    std::ofstream m_out;
+    std::string m_file_name;
+    std::unordered_map<std::string, size_t> m_snp_index;
+    std::vector<uint64_t> m_write_offset;
+    std::vector<std::string> m_rs;
+    std::vector<size_t> m_chr;
+    std::vector<size_t> m_loc;
+    const Pair* m_pairs = nullptr;
+    const uint64_t* m_offset = nullptr;
+    uint64_t m_num_snp = 0;
+    uint64_t m_num_pair = 0;
+    uint64_t m_founder_ct = 0;
+    uint64_t m_founder_hash = 0;
+    uint64_t m_variant_hash = 0;
+    uint64_t m_distance = 0;
+    double m_r2_floor = 0;
+    void write_header();
+};
+
+#endif /* PRSICE_INC_LDSTORE_HPP_ */
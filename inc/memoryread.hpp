@@ -2,10 +2,20 @@
 #define MEMORYREAD_HPP
 
 #include "misc.hpp"
+#include <algorithm>
+#include <chrono>
+#include <climits>
 #include <fstream>
 #include <mio.hpp>
 #include <stdexcept>
 #include <string>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// advised blocks separated by less than this number of bytes are merged
+#define MEMORY_READ_AHEAD_GAP 65536
 
 // TODO: Might want to do some precomputation of the ideal offsets such that we
 // can minimize the number of time we do the mapping
@@ -13,64 +23,120 @@ class MemoryRead
 {
 public:
     MemoryRead() {}
+    MemoryRead(const MemoryRead&) = delete;
+    MemoryRead& operator=(const MemoryRead&) = delete;
+    ~MemoryRead() { close_advise_file(); }
     void read(const std::string& file, const long long& byte_pos,
               const unsigned long long read_size, char* result)
     {
+        // time spent here is time the caller waits for the data, which should
+        // mostly be memory copy when the read ahead is effective
+        const auto start = std::chrono::steady_clock::now();
+        read_block(file, byte_pos, read_size, result);
+        m_stall_time += std::chrono::steady_clock::now() - start;
+        ++m_num_read;
+        m_read_byte += read_size;
+    }
+    /*!
+     * \brief Return a pointer to the block within the memory mapped file, so
+     *        that it can be used without copying. The pointer is valid until
+     *        the next call to read or view. It is not aligned, so it must
+     *        only be read byte-wise (e.g. with memcpy), never through
+     *        word or vector pointers
+     * \param file is the name of the file
+     * \param byte_pos is the start of the block
+     * \param view_size is the number of bytes that must be accessible from
+     *        byte_pos
+     * \return nullptr if the file is not memory mapped or if view_size bytes
+     *         are not available, in which case read should be used instead
+     */
+    const char* view(const std::string& file, const long long& byte_pos,
+                     const unsigned long long view_size)
+    {
+        if (!m_use_mmap) return nullptr;
+        const auto start = std::chrono::steady_clock::now();
         if (file != m_file_name) { new_file(file, byte_pos); }
-        if (m_use_mmap)
+        if (!map_block(byte_pos, view_size)) return nullptr;
+        m_stall_time += std::chrono::steady_clock::now() - start;
+        ++m_num_read;
+        m_read_byte += view_size;
+        return &m_memory_map[static_cast<unsigned long long>(byte_pos)
+                             - m_offset];
+    }
+    /*!
+     * \brief Inform the OS that a block of the file will be read soon, so that
+     *        it is loaded into the page cache in the background. Blocks should
+     *        be given in increasing order, and are merged with the previous
+     *        ones when they are close enough. The advice is sent when advise
+     *        is called or when a far away block is given
+     * \param file is the name of the file
+     * \param byte_pos is the start of the block
+     * \param read_size is the (maximum) size of the block
+     */
+    void will_need(const std::string& file, const long long byte_pos,
+                   const unsigned long long read_size)
+    {
+        const unsigned long long start =
+            static_cast<unsigned long long>(byte_pos);
+        if (file == m_advise_file && m_advise_end != 0
+            && start >= m_advise_start
+            && start <= m_advise_end + MEMORY_READ_AHEAD_GAP)
         {
-            // first check if we need to remap the file
-            // last condition is for bgen, which require read of different size
-            // will still be suboptimal for bgen unless we know exactly how many
-            // byte each data span as a whole
-            if (static_cast<unsigned long long>(byte_pos)
-                    >= (m_offset + m_block_size)
-                || static_cast<unsigned long long>(byte_pos) < m_offset
-                || static_cast<unsigned long long>(byte_pos) - m_offset
-                           + read_size
-                       > m_memory_map.mapped_length())
-            {
-                // + byte_pos to account for possible useless bytes
-                m_offset = static_cast<unsigned long long>(byte_pos);
-                std::error_code error;
-                m_memory_map.map(m_file_name, m_offset, m_block_size, error);
-                if (error)
-                {
-                    throw std::runtime_error("Error: Failed to map file: "
-                                             + m_file_name);
-                }
-            }
-            if (static_cast<unsigned long long>(byte_pos) - m_offset + read_size
-                > m_memory_map.mapped_length())
-            {
-                // As we have re-mapped by this point, the only possible reason
-                // for over-run is read_size > file size
-                throw std::runtime_error("Error: File read out of bound");
-            }
-            std::copy(&m_memory_map[static_cast<unsigned long long>(byte_pos)
-                                    - m_offset],
-                      &m_memory_map[static_cast<unsigned long long>(byte_pos)
-                                    - m_offset + read_size],
-                      result);
+            m_advise_end = std::max(m_advise_end, start + read_size);
+            return;
         }
-        else
+        advise();
+        if (file != m_advise_file)
         {
-            assert(m_input.is_open());
-            if (static_cast<unsigned long long>(byte_pos) != m_offset)
-            {
-                if (!m_input.seekg(byte_pos, std::ios_base::beg))
-                {
-                    throw std::runtime_error("Error: Cannot seek within file: "
-                                             + m_file_name);
-                }
-            }
-            if (!m_input.read(result, read_size))
-            {
-                throw std::runtime_error("Error: Cannot read file: "
-                                         + m_file_name);
-            }
-            m_offset = read_size + static_cast<unsigned long long>(byte_pos);
+            close_advise_file();
+            m_advise_file = file;
+#ifndef _WIN32
+            m_advise_fd = ::open(file.c_str(), O_RDONLY);
+#endif
         }
+        m_advise_start = start;
+        m_advise_end = start + read_size;
+    }
+    /*!
+     * \brief Send the pending read ahead advice to the OS
+     */
+    void advise()
+    {
+        if (m_advise_end == 0) return;
+#if defined(__linux__)
+        if (m_advise_fd != -1)
+        {
+            posix_fadvise(m_advise_fd, static_cast<off_t>(m_advise_start),
+                          static_cast<off_t>(m_advise_end - m_advise_start),
+                          POSIX_FADV_WILLNEED);
+        }
+#elif defined(__APPLE__)
+        if (m_advise_fd != -1)
+        {
+            radvisory advice;
+            advice.ra_offset = static_cast<off_t>(m_advise_start);
+            advice.ra_count = static_cast<int>(std::min<unsigned long long>(
+                m_advise_end - m_advise_start, INT_MAX));
+            fcntl(m_advise_fd, F_RDADVISE, &advice);
+        }
+#endif
+        ++m_num_advise;
+        m_advise_start = 0;
+        m_advise_end = 0;
+    }
+    size_t num_read() const { return m_num_read; }
+    size_t num_advise() const { return m_num_advise; }
+    unsigned long long read_byte() const { return m_read_byte; }
+    /*!
+     * \brief Return the total time, in second, spent waiting in read
+     */
+    double stall_time() const { return m_stall_time.count(); }
+    void reset_counter()
+    {
+        m_num_read = 0;
+        m_num_advise = 0;
+        m_read_byte = 0;
+        m_stall_time = std::chrono::duration<double>::zero();
     }
     void init_memory_map(const unsigned long long mem,
                          const unsigned long long& data_size)
@@ -99,10 +165,94 @@ private:
     std::ifstream m_input;
     mio::mmap_source m_memory_map;
     std::string m_file_name;
+    std::string m_advise_file;
+    std::chrono::duration<double> m_stall_time =
+        std::chrono::duration<double>::zero();
     unsigned long long m_offset;
     unsigned long long m_block_size;
+    unsigned long long m_advise_start = 0;
+    unsigned long long m_advise_end = 0;
+    unsigned long long m_read_byte = 0;
+    size_t m_num_read = 0;
+    size_t m_num_advise = 0;
+    int m_advise_fd = -1;
     bool m_use_mmap = false;
     bool m_mem_calculated = false;
+    void close_advise_file()
+    {
+#ifndef _WIN32
+        if (m_advise_fd != -1) ::close(m_advise_fd);
+#endif
+        m_advise_fd = -1;
+        m_advise_file = "";
+    }
+    // map the file such that read_size bytes starting from byte_pos are
+    // mapped, return false if that goes beyond the end of the file
+    bool map_block(const long long& byte_pos,
+                   const unsigned long long read_size)
+    {
+        // first check if we need to remap the file
+        // last condition is for bgen, which require read of different size
+        // will still be suboptimal for bgen unless we know exactly how many
+        // byte each data span as a whole
+        if (static_cast<unsigned long long>(byte_pos)
+                >= (m_offset + m_block_size)
+            || static_cast<unsigned long long>(byte_pos) < m_offset
+            || static_cast<unsigned long long>(byte_pos) - m_offset + read_size
+                   > m_memory_map.length())
+        {
+            // + byte_pos to account for possible useless bytes
+            m_offset = static_cast<unsigned long long>(byte_pos);
+            std::error_code error;
+            m_memory_map.map(m_file_name, m_offset, m_block_size, error);
+            if (error)
+            {
+                throw std::runtime_error("Error: Failed to map file: "
+                                         + m_file_name);
+            }
+        }
+        // mapped_length also counts the padding needed to align the mapping
+        // to the page boundary, which is before m_offset
+        return static_cast<unsigned long long>(byte_pos) - m_offset + read_size
+               <= m_memory_map.length();
+    }
+    void read_block(const std::string& file, const long long& byte_pos,
+                    const unsigned long long read_size, char* result)
+    {
+        if (file != m_file_name) { new_file(file, byte_pos); }
+        if (m_use_mmap)
+        {
+            if (!map_block(byte_pos, read_size))
+            {
+                // As we have re-mapped by this point, the only possible reason
+                // for over-run is read_size > file size
+                throw std::runtime_error("Error: File read out of bound");
+            }
+            std::copy(&m_memory_map[static_cast<unsigned long long>(byte_pos)
+                                    - m_offset],
+                      &m_memory_map[static_cast<unsigned long long>(byte_pos)
+                                    - m_offset + read_size],
+                      result);
+        }
+        else
+        {
+            assert(m_input.is_open());
+            if (static_cast<unsigned long long>(byte_pos) != m_offset)
+            {
+                if (!m_input.seekg(byte_pos, std::ios_base::beg))
+                {
+                    throw std::runtime_error("Error: Cannot seek within file: "
+                                             + m_file_name);
+                }
+            }
+            if (!m_input.read(result, read_size))
+            {
+                throw std::runtime_error("Error: Cannot read file: "
+                                         + m_file_name);
+            }
+            m_offset = read_size + static_cast<unsigned long long>(byte_pos);
+        }
+    }
     // return true if we think mmap is useful
     bool calculate_block_size(const unsigned long long& mem,
                               const unsigned long long& data_size)
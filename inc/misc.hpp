@@ -22,6 +22,8 @@
 #define _USE_MATH_DEFINES
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <cstdlib>
 #include <iostream>
 #include <limits>
 #include <math.h>
@@ -93,6 +95,7 @@
 #endif
 #define BIGSTACK_MIN_MB 64
 #define BIGSTACK_DEFAULT_MB 2048
+#define FNV_OFFSET_BASIS 14695981039346656037ULL
 
 
 namespace misc
@@ -334,6 +337,41 @@ inline T convert(const std::string& str)
     { throw std::runtime_error("Unable to convert the input"); }
     return obj;
 }
+/*!
+ * \brief Convert [begin, end) into a double, following the same rule as
+ *        convert<double> without the need of a string stream or a null
+ *        terminated string
+ * \return false if the whole range is not a valid finite number
+ */
+inline bool convert_double(const char* begin, const char* end, double& value)
+{
+    const size_t length = static_cast<size_t>(end - begin);
+    if (length == 0) return false;
+    // istream only take digits, sign, decimal point and exponent, which
+    // exclude the inf, nan and hexadecimal accepted by strtod
+    for (const char* cur = begin; cur != end; ++cur)
+    {
+        if ((*cur < '0' || *cur > '9') && *cur != '.' && *cur != '-'
+            && *cur != '+' && *cur != 'e' && *cur != 'E')
+        { return false; }
+    }
+    char buffer[64];
+    std::string long_input;
+    const char* input = buffer;
+    if (length < sizeof(buffer))
+    {
+        std::copy(begin, end, buffer);
+        buffer[length] = '\0';
+    }
+    else
+    {
+        long_input.assign(begin, end);
+        input = long_input.c_str();
+    }
+    char* input_end;
+    value = std::strtod(input, &input_end);
+    return input_end == input + length && !std::isinf(value);
+}
 template <typename T>
 inline std::string to_string(T value)
 {
@@ -362,6 +400,29 @@ inline void trim(std::string& s)
     ltrim(s);
     rtrim(s);
 };
+// trim white spaces from both ends of [begin, end) (in place)
+inline void trim(const char*& begin, const char*& end)
+{
+    while (begin < end && std::isspace(static_cast<unsigned char>(*begin)))
+    { ++begin; }
+    while (end > begin && std::isspace(static_cast<unsigned char>(*(end - 1))))
+    { --end; }
+}
+// split [begin, end) by space and tab as in split, but stop once max_token
+// tokens were found
+inline void split(std::vector<std::pair<const char*, const char*>>& token,
+                  const char* begin, const char* end, const size_t max_token)
+{
+    token.clear();
+    while (begin < end && token.size() < max_token)
+    {
+        while (begin < end && (*begin == ' ' || *begin == '\t')) { ++begin; }
+        if (begin == end) break;
+        const char* token_start = begin;
+        while (begin < end && *begin != ' ' && *begin != '\t') { ++begin; }
+        token.emplace_back(token_start, begin);
+    }
+}
 // trim from start (copying)
 inline std::string ltrimmed(std::string s)
 {
@@ -380,6 +441,30 @@ inline std::string trimmed(std::string s)
     trim(s);
     return s;
 };
+// 64 bit FNV-1a hash of [data, data + length). Start from a previous hash to
+// hash a sequence of strings
+inline uint64_t fnv_hash(const char* data, const size_t length,
+                         uint64_t hash = FNV_OFFSET_BASIS)
+{
+    for (size_t i = 0; i < length; ++i)
+    {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+// hash [begin, end) followed by a separator, such that a sequence of fields
+// can't be confused with another sequence with the same concatenation
+inline uint64_t fnv_hash_field(const char* begin, const char* end,
+                               const uint64_t hash)
+{
+    return fnv_hash(
+        "\n", 1, fnv_hash(begin, static_cast<size_t>(end - begin), hash));
+}
+inline uint64_t fnv_hash_field(const std::string& str, const uint64_t hash)
+{
+    return fnv_hash_field(str.data(), str.data() + str.size(), hash);
+}
 // From http://stackoverflow.com/a/24386991/1441789
 template <class T>
 inline T base_name(T const& path, T const& delims = "/\\")
@@ -1088,6 +1173,30 @@ inline size_t string_to_size_t(const char* p)
     }
     return x;
 }
+// same as string_to_size_t, but on [begin, end)
+inline size_t string_to_size_t(const char* begin, const char* end)
+{
+    size_t x = 0;
+    if (begin != end && *begin == '-')
+    {
+        throw std::runtime_error(
+            "Error: Negative value, cannot be assigned to unsigned integer\n");
+    }
+    else if (begin != end && *begin == '+')
+    {
+        ++begin;
+    }
+    else if (begin == end || *begin < '0' || *begin > '9')
+    {
+        throw std::runtime_error("Error: Not an integer\n");
+    }
+    while (begin != end && *begin >= '0' && *begin <= '9')
+    {
+        x = (x * 10) + static_cast<size_t>(*begin - '0');
+        ++begin;
+    }
+    return x;
+}
 // from https://stackoverflow.com/a/874160
 inline bool hasEnding(const std::string& fullString, const std::string& ending)
 {
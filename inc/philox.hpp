@@ -0,0 +1,101 @@
+// This file is part of PRSice-2, copyright (C) 2016-2019
+// Shing Wan Choi, Paul F. O’Reilly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PHILOX_H
+#define PHILOX_H
+
+#include <array>
+#include <cstdint>
+#include <limits>
+
+/*!
+ * \brief Counter based random number generator Philox4x32-10 (Salmon et al.
+ * 2011). Each output block is a keyed bijection of a counter, so any stream
+ * can be started directly from the seed and the stream index without
+ * generating the streams before it. This allow permutation i to use the same
+ * random numbers regardless of which thread generate it. Can be used with
+ * the standard distributions and std::shuffle
+ */
+class Philox4x32
+{
+public:
+    typedef uint32_t result_type;
+    /*!
+     * \brief Start the stream of random numbers
+     * \param seed is the key of the generator
+     * \param stream is the index of the stream, such that each stream gets an
+     * independent sequence of random numbers
+     */
+    Philox4x32(const uint64_t seed, const uint64_t stream)
+    {
+        m_key[0] = static_cast<uint32_t>(seed);
+        m_key[1] = static_cast<uint32_t>(seed >> 32);
+        m_counter[0] = 0;
+        m_counter[1] = 0;
+        m_counter[2] = static_cast<uint32_t>(stream);
+        m_counter[3] = static_cast<uint32_t>(stream >> 32);
+    }
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max()
+    {
+        return std::numeric_limits<result_type>::max();
+    }
+    result_type operator()()
+    {
+        if (m_used == 4)
+        {
+            m_block = block(m_counter, m_key);
+            // the low 64 bits of the counter index the block within a stream
+            if (++m_counter[0] == 0) ++m_counter[1];
+            m_used = 0;
+        }
+        return m_block[m_used++];
+    }
+    /*!
+     * \brief The Philox4x32-10 bijection
+     */
+    static std::array<uint32_t, 4> block(std::array<uint32_t, 4> counter,
+                                         std::array<uint32_t, 2> key)
+    {
+        for (int round = 0; round < 10; ++round)
+        {
+            if (round != 0)
+            {
+                key[0] += 0x9E3779B9;
+                key[1] += 0xBB67AE85;
+            }
+            const uint64_t product0 =
+                static_cast<uint64_t>(0xD2511F53) * counter[0];
+            const uint64_t product1 =
+                static_cast<uint64_t>(0xCD9E8D57) * counter[2];
+            counter = {{static_cast<uint32_t>(product1 >> 32) ^ counter[1]
+                            ^ key[0],
+                        static_cast<uint32_t>(product1),
+                        static_cast<uint32_t>(product0 >> 32) ^ counter[3]
+                            ^ key[1],
+                        static_cast<uint32_t>(product0)}};
+        }
+        return counter;
+    }
+
+private:
+    std::array<uint32_t, 4> m_counter;
+    std::array<uint32_t, 4> m_block;
+    std::array<uint32_t, 2> m_key;
+    int m_used = 4;
+};
+
+#endif // PHILOX_H
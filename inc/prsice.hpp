@@ -21,12 +21,13 @@
 #include "commander.hpp"
 #include "genotype.hpp"
 #include "misc.hpp"
+#include "philox.hpp"
 #include "plink_common.hpp"
 #include "regression.hpp"
 #include "reporter.hpp"
 #include "snp.hpp"
 #include "storage.hpp"
-#include "thread_queue.hpp"
+#include "task_scheduler.hpp"
 #include <Eigen/Dense>
 #include <algorithm>
 #include <atomic>
@@ -37,6 +38,7 @@
 #include <map>
 #include <math.h>
 #include <mutex>
+#include <numeric>
 #include <random>
 #include <stdexcept>
 #include <stdio.h>
@@ -58,6 +60,12 @@
 #define NEXT_LENGTH 0LL
 //#include <pthread.h>
 #endif
+// maximum size (in bytes) of the sample x threshold score matrix
+#define MAX_SCORE_MATRIX_BYTES 268435456
+// maximum number of permuted phenotypes regressed together
+#define PERM_BLOCK_SIZE 256
+// maximum size (in bytes) of a block of permuted phenotypes
+#define MAX_PERM_BLOCK_BYTES 33554432
 #ifdef __APPLE__
 #include <mach/mach.h>
 #include <mach/mach_host.h>
@@ -117,19 +125,22 @@ public:
                     const std::vector<size_t>& region_start_idx,
                     const bool all_scores, Genotype& target);
     /*!
-     * \brief Before calling this function, the target should have loaded the
-     * PRS. Then this function will fill in the m_independent_variable matrix
-     * and call the required regression algorithms. It will then check if we
-     * encounter a more significant result
-     * \param target is the target genotype file containing the PRS information
+     * \brief Before calling this function, the PRS of the threshold should
+     * have been stored in m_score_matrix, and for quantitative traits,
+     * regress_batch should have filled m_covariate_fit. Then this function
+     * will fill in the m_independent_variable matrix and call the required
+     * regression algorithms (or take the result from m_covariate_fit). It
+     * will then check if we encounter a more significant result
+     * \param score_col is the column of m_score_matrix containing the PRS
      * \param threshold is the current p-value threshold, use for output
+     * \param num_snp is the number of SNPs included in the PRS
      * \param thread is the number of thread allowed
      * \param pheno_index is the index of the current phenotype
      * \param iter_threshold is the index of the current threshold
      */
-    void regress_score(Genotype& target, const double threshold,
-                       const int thread, const size_t pheno_index,
-                       const size_t prs_result_idx);
+    void regress_score(const Eigen::Index score_col, const double threshold,
+                       const uint32_t num_snp, const int thread,
+                       const size_t pheno_index, const size_t prs_result_idx);
 
     /*!
      * \brief Function responsible for generating the .prsice file
@@ -229,6 +240,19 @@ public:
     {
         return m_pheno_info.prevalence;
     }
+    /*!
+     * \brief Return the number of permutations whose null PRS are generated
+     * and regressed together in the competitive permutation, such that a
+     * block does not exceed MAX_PERM_BLOCK_BYTES
+     * \param num_set_size is the number of null PRS of each permutation
+     * \param num_target_sample is the number of samples in the target
+     * \param num_regress_sample is the number of samples in the regression
+     * \param num_perm is the number of permutations
+     */
+    static size_t null_set_block_size(const size_t num_set_size,
+                                      const size_t num_target_sample,
+                                      const size_t num_regress_sample,
+                                      const size_t num_perm);
 
 protected:
 private:
@@ -282,6 +306,12 @@ private:
     static std::mutex lock_guard;
 
     Eigen::MatrixXd m_independent_variables;
+    // PRS of all samples (row) for a batch of thresholds (column)
+    Eigen::MatrixXd m_score_matrix;
+    // decomposition of the covariates, shared by all thresholds in a batch
+    Regression::CovariateQR m_covariate_qr;
+    // linear regression result of each column of m_score_matrix
+    Regression::CovariateFit m_covariate_fit;
     Eigen::VectorXd m_phenotype;
     std::unordered_map<std::string, size_t> m_sample_with_phenotypes;
     std::vector<prsice_result> m_prs_results;
@@ -289,6 +319,9 @@ private:
     std::vector<double> m_perm_result;
     std::vector<double> m_permuted_pheno;
     std::vector<double> m_best_sample_score;
+    // threshold and number of SNPs of each column in m_score_matrix
+    std::vector<double> m_batch_threshold;
+    std::vector<uint32_t> m_batch_num_snp;
     std::vector<size_t> m_matrix_index;
     std::vector<size_t> m_significant_store {0, 0, 0};
     std::ofstream m_all_out, m_best_out, m_prsice_out;
@@ -413,94 +446,63 @@ private:
     void print_best(Genotype& target, const size_t pheno_index);
 
     /*!
-     * \brief Function to generate PRS for null set when multiple threading is
-     * used
-     * \param q is teh queue used to communicate with the consumer
+     * \brief Run the competitive permutation, where each task generates the
+     * null PRS of every set size from the random selections of background SNPs
+     * of a block of permutations and performs the regression analysis
+     * \param scheduler is the scheduler running the permutations
      * \param target is the target genotype, responsible for the generation of
      * PRS
-     * \param num_consumer is the number of consumer. use for restricting the
-     * number of PRS read in at one time
-     * \param set_index is the dictionary containing the sizes of sets
-     * \param num_perm is the number of permutation to erpfrom
-     * \param require_standardize is a boolean, indicating if we want a
-     * standardized PRS
-     */
-    void
-    produce_null_prs(Thread_Queue<std::pair<std::vector<double>, size_t>>& q,
-                     Genotype& target, const size_t& num_background,
-                     std::vector<size_t> background, size_t num_consumer,
-                     std::map<size_t, std::vector<size_t>>& set_index);
-    /*!
-     * \brief This is the "consumer" function responsible for reading in the PRS
-     * and perform the regression analysis
-     * \param q is the queue used for communication between the producer and
-     * consumer
-     * \param set_index is the dictionary containing index to ori_t_value for
+     * \param background is the index of the background SNPs
+     * \param set_index is the dictionary containing index to obs_t_value for
      * sets with size specified in the key
-     * \param ori_t_value contain the observed t-statistic for the  sets
+     * \param PQR is the pre-computed decomposition of the phenotype and
+     * covariates, ignored for logistic regression
+     * \param se_base is the pre-computed SE with unit residual variance
+     * \param obs_t_value contain the observed t-statistic for the  sets
      * \param set_perm_res is the vector storing the result of permutation.
      * Counting the number of time the permuted T is bigger than the observed T
      * for a specific set
      * \param is_binary indicate if the phenotype is binary or not
+     * \param cached indicate if the scores of the background SNPs are cached
+     * in target, such that the null PRS of a block of permutations are built
+     * at once without locking target
      */
-    void consume_prs(
-        Thread_Queue<std::pair<std::vector<double>, size_t>>& q,
-        const Eigen::MatrixXd& X,
-        const Eigen::ColPivHouseholderQR<Eigen::MatrixXd>& PQR,
-        const Eigen::ColPivHouseholderQR<Eigen::MatrixXd>::PermutationType&
-            Pmat,
-        const Eigen::MatrixXd& Rinv,
-        std::map<size_t, std::vector<size_t>>& set_index,
-        std::vector<double>& obs_t_value,
-        std::vector<std::atomic<size_t>>& set_perm_res, const bool is_binary);
-
-    void null_set_no_thread(
-        Genotype& target, const size_t num_background,
-        std::vector<size_t> background,
-        const std::map<size_t, std::vector<size_t>>& set_index,
-        const Eigen::MatrixXd& X,
-        const Eigen::ColPivHouseholderQR<Eigen::MatrixXd>& PQR,
-        const Eigen::ColPivHouseholderQR<Eigen::MatrixXd>::PermutationType&
-            Pmat,
-        const Eigen::MatrixXd& Rinv, std::vector<double>& obs_t_value,
-        std::vector<std::atomic<size_t>>& set_perm_res, const bool is_binary);
+    void null_set_perm(Task_Scheduler& scheduler, Genotype& target,
+                       const std::vector<size_t>& background,
+                       const std::map<size_t, std::vector<size_t>>& set_index,
+                       const Eigen::ColPivHouseholderQR<Eigen::MatrixXd>& PQR,
+                       const Eigen::VectorXd& se_base,
+                       const std::vector<double>& obs_t_value,
+                       std::vector<std::atomic<size_t>>& set_perm_res,
+                       const bool is_binary, const bool cached);
     /*!
-     * \brief The "producer" for generating the permuted phenotypes
-     * \param q is the queue for contacting the consumers
-     * \param num_consumer is the number of consumer
+     * \brief Return the number of permuted phenotypes regressed together,
+     * such that a block does not exceed MAX_PERM_BLOCK_BYTES
      */
-    void gen_null_pheno(Thread_Queue<std::pair<Eigen::VectorXd, size_t>>& q,
-                        size_t num_consumer);
+    size_t null_pheno_block_size() const;
     /*!
-     * \brief The "consumer" for calculating the T-value on permuted phenotypes
-     * \param q is the queue where the producer generated the permuted phenotype
-     * \param decomposed is the pre-computed decomposition
-     * \param rank is the pre-computed rank
-     * \param pre_se is the pre-computed SE matrix
-     * \param run_glm is a boolean indicate if we want to run logistic
-     * regression
+     * \brief Generate a block of permuted phenotypes
+     * \param start is the index of the first permutation of the block
+     * \param num_pheno is the number of permuted phenotypes to generate
+     * \param null_pheno stores the permuted phenotypes, one per column
      */
-    void consume_null_pheno(
-        Thread_Queue<std::pair<Eigen::VectorXd, size_t>>& q,
-        const Eigen::ColPivHouseholderQR<Eigen::MatrixXd>& PQR,
-        const Eigen::ColPivHouseholderQR<Eigen::MatrixXd>::PermutationType&
-            Pmat,
-        const Eigen::MatrixXd& R, bool run_glm);
+    void shuffle_null_pheno(const size_t start, const size_t num_pheno,
+                            Eigen::MatrixXd& null_pheno) const;
     /*!
-     * \brief Funtion to perform single threaded permutation
-     * \param decomposed is the pre-decomposed independent matrix. If run glm is
-     * true, this will be ignored
-     * \param rank is the rank of the decomposition
-     * \param pre_se is the pre-computed SE matrix required for calculating the
-     * final SE
-     * \param run_glm indicate if we want to run GLM instead of using
-     * precomputed matrix
+     * \brief Calculate the absolute T-value of the PRS for a block of permuted
+     * phenotypes
+     * \param null_pheno is the block of permuted phenotypes
+     * \param PQR is the pre-computed decomposition, ignored if run_glm is true
+     * \param se_base is the pre-computed SE with unit residual variance
+     * \param run_glm is a boolean indicate if we want to run logistic
+     * regression
+     * \param t_value stores the T-value of each permuted phenotype
      */
-    void run_null_perm_no_thread(
+    void null_pheno_t_value(
+        const Eigen::MatrixXd& null_pheno,
         const Eigen::ColPivHouseholderQR<Eigen::MatrixXd>& PQR,
-        const Eigen::ColPivHouseholderQR<Eigen::MatrixXd>::PermutationType&
-            Pmat,
-        const Eigen::MatrixXd& R, const bool run_glm);
+        const Eigen::VectorXd& se_base, const bool run_glm,
+        Eigen::VectorXd& t_value) const;
 
     void parse_pheno(const bool binary, const std::string& pheno,
                      std::vector<double>& pheno_store, double& first_pheno,
@@ -511,6 +513,30 @@ private:
     load_pheno_map(const size_t idx, const std::string& delim);
     void reset_result_containers(const Genotype& target,
                                  const size_t region_idx);
+    /*!
+     * \brief Calculate the number of thresholds we can store in
+     * m_score_matrix without exceeding MAX_SCORE_MATRIX_BYTES
+     * \param num_sample is the number of samples
+     * \param num_threshold is the number of thresholds
+     * \return the number of columns of m_score_matrix
+     */
+    Eigen::Index score_batch_size(const size_t num_sample,
+                                  const size_t num_threshold) const
+    {
+        const size_t max_col = MAX_SCORE_MATRIX_BYTES
+                               / (std::max<size_t>(1, num_sample)
+                                  * sizeof(double));
+        return static_cast<Eigen::Index>(std::max<size_t>(
+            1, std::min(max_col, std::max<size_t>(1, num_threshold))));
+    }
+    /*!
+     * \brief Run the regression (and permutation) of all thresholds stored
+     * in m_score_matrix, then clear the batch
+     * \param pheno_index is the index of the current phenotype
+     * \param prs_result_idx is the index of the first threshold in the batch,
+     * will be updated to the index of the next threshold
+     */
+    void regress_batch(const size_t pheno_index, size_t& prs_result_idx);
 };
 
 #endif // PRSICE_H
@@ -29,6 +29,7 @@
 #include <limits>
 #include <math.h>
 #include <stdexcept>
+#include <vector>
 namespace Regression
 {
 void glm(const Eigen::VectorXd& y, const Eigen::MatrixXd& x, double& p_value,
@@ -36,6 +37,82 @@ void glm(const Eigen::VectorXd& y, const Eigen::MatrixXd& x, double& p_value,
 void fastLm(const Eigen::VectorXd& y, const Eigen::MatrixXd& X, double& p_value,
             double& r2, double& r2_adjust, double& coeff,
             double& standard_error, int thread, bool intercept, int type = 0);
+/*!
+ * \brief Decomposition of the covariate block (every column of the
+ * independent matrix except the PRS column) which can be reused for any PRS
+ */
+struct CovariateQR
+{
+    // orthonormal basis of the covariate columns
+    Eigen::MatrixXd Q;
+    // phenotype after removing the covariate effects
+    Eigen::VectorXd resid_y;
+    // total sum of square of the phenotype
+    double tss = 0.0;
+    // number of columns of the full model
+    Eigen::Index num_col = 0;
+};
+/*!
+ * \brief Factor the covariate block of X once so that fastLm_covariate can
+ * be used for each PRS
+ * \param y is the phenotype
+ * \param X is the independent matrix, with the PRS in column 1
+ * \param cov_qr is the resulting decomposition
+ * \param thread is the number of thread allowed
+ */
+void factor_covariates(const Eigen::VectorXd& y, const Eigen::MatrixXd& X,
+                       CovariateQR& cov_qr, int thread);
+/*!
+ * \brief Result of fastLm_covariate_block, one entry per PRS column
+ */
+struct CovariateFit
+{
+    Eigen::VectorXd p_value;
+    Eigen::VectorXd r2;
+    Eigen::VectorXd r2_adjust;
+    Eigen::VectorXd coeff;
+    Eigen::VectorXd standard_error;
+    // false if the PRS is collinear with the covariates, in which case
+    // fastLm should be used instead
+    std::vector<bool> estimable;
+};
+/*!
+ * \brief Linear regression of y on the intercept, covariates and each column
+ * of prs in turn using the Frisch-Waugh-Lovell theorem. All columns are
+ * residualized together through Q^T * prs, so the whole batch costs two
+ * matrix-matrix products instead of one solve per PRS
+ * \param cov_qr is the pre-computed decomposition of the covariates
+ * \param prs is the n x B matrix of PRS, one column per threshold
+ * \param fit stores the regression result of each column
+ */
+void fastLm_covariate_block(const CovariateQR& cov_qr,
+                            const Eigen::MatrixXd& prs, CovariateFit& fit);
+/*!
+ * \brief Linear regression of y on the intercept, PRS and covariates using the
+ * Frisch-Waugh-Lovell theorem. Only O(nk) work is required for each PRS
+ * \param cov_qr is the pre-computed decomposition of the covariates
+ * \param prs is the PRS of each sample
+ * \return false if the PRS is collinear with the covariates, in which case
+ * fastLm should be used instead
+ */
+bool fastLm_covariate(const CovariateQR& cov_qr, const Eigen::VectorXd& prs,
+                      double& p_value, double& r2, double& r2_adjust,
+                      double& coeff, double& standard_error);
+/*!
+ * \brief Linear regression of a block of phenotypes on the same independent
+ * matrix. All coefficients and residual sum of squares are obtained from one
+ * Q^T Y product, instead of one solve per phenotype
+ * \param PQR is the decomposition of the independent matrix
+ * \param se_base is the standard error of each coefficient when the residual
+ * standard deviation is 1
+ * \param Y is the n x B matrix of phenotypes, one per column
+ * \param coeff_idx is the column of the independent matrix of interest
+ * \param t_value stores the absolute t-value of the coefficient for each
+ * phenotype
+ */
+void fastLm_block(const Eigen::ColPivHouseholderQR<Eigen::MatrixXd>& PQR,
+                  const Eigen::VectorXd& se_base, const Eigen::MatrixXd& Y,
+                  const Eigen::Index coeff_idx, Eigen::VectorXd& t_value);
 }
 
 #endif /* PRSICE_REGRESSION_H_ */
@@ -18,11 +18,13 @@
 #ifndef SNP_H
 #define SNP_H
 
+#include "arena.hpp"
 #include "commander.hpp"
 #include "misc.hpp"
 #include "plink_common.hpp"
 #include "storage.hpp"
 #include <algorithm>
+#include <cstring>
 #include <limits.h>
 #include <numeric>
 #include <stdexcept>
@@ -31,6 +33,13 @@ static_assert(sizeof(std::streamsize) <= sizeof(unsigned long long),
               "streampos larger than long long, don't know how to proceed. "
               "Please use PRSice on another machine");
 class Genotype;
+/*!
+ * \brief Record of a variant. To keep the per-variant footprint small, the
+ *        rsID is interned into a string arena and the alleles are stored as
+ *        codes of an allele table. Both tables belong to the Genotype holding
+ *        the SNP, and are passed in whenever the SNP needs them. The tables
+ *        are filled when the input is read, which is done by a single thread
+ */
 class SNP
 {
 public:
@@ -38,21 +47,20 @@ public:
     SNP(const std::string& rs_id, const size_t chr, const size_t loc,
         const std::string& ref_allele, const std::string& alt_allele,
         const double& stat, const double& p_value,
-        const unsigned long long category, const double p_threshold)
-        : m_alt(alt_allele)
-        , m_ref(ref_allele)
-        , m_rs(rs_id)
+        const unsigned long long category, const double p_threshold,
+        StringArena& id_arena, AlleleTable& allele_table)
+        : m_rs(id_arena.store(rs_id))
         , m_stat(stat)
         , m_p_value(p_value)
         , m_p_threshold(p_threshold)
         , m_chr(chr)
         , m_loc(loc)
         , m_category(category)
+        , m_alt(allele_table.encode(alt_allele))
+        , m_ref(allele_table.encode(ref_allele))
     {
     }
 
-    virtual ~SNP();
-
     void update_file(const size_t& idx, const long long byte_pos,
                      const bool is_ref)
     {
@@ -75,7 +83,8 @@ public:
     void add_snp_info(const size_t& idx, const long long byte_pos,
                       const size_t chr, const size_t loc,
                       const std::string& ref, const std::string& alt,
-                      const bool flipping, const bool is_ref)
+                      const bool flipping, const bool is_ref,
+                      AlleleTable& allele_table)
     {
         if (!is_ref)
         {
@@ -84,8 +93,8 @@ public:
             m_chr = chr;
             m_loc = loc;
             m_flipped = flipping;
-            m_ref = ref;
-            m_alt = alt;
+            m_ref = allele_table.encode(ref);
+            m_alt = allele_table.encode(alt);
         }
         else
         {
@@ -112,10 +121,12 @@ public:
      * \param alt is the alternative allele of teh other SNP
      * \param flipped is used as a return value. If flipping is required,
      * flipped = true
+     * \param table is the allele table used when the SNP was constructed
      * \return true if it is a match
      */
     inline bool matching(size_t chr, size_t loc, std::string& ref,
-                         std::string& alt, bool& flipped)
+                         std::string& alt, bool& flipped,
+                         const AlleleTable& table)
     {
         // should be trimmed
         if (chr != ~size_t(0) && m_chr != ~size_t(0) && chr != m_chr)
@@ -123,27 +134,30 @@ public:
         if (loc != ~size_t(0) && m_loc != ~size_t(0) && loc != m_loc)
         { return false; }
         flipped = false;
-        if (m_ref == ref)
+        const std::string& cur_ref = table.allele(m_ref);
+        const std::string& cur_alt = table.allele(m_alt);
+        const std::string& comp_ref = table.allele(table.complement(m_ref));
+        const std::string& comp_alt = table.allele(table.complement(m_alt));
+        if (cur_ref == ref)
         {
-            if (!m_alt.empty() && !alt.empty()) { return (m_alt == alt); }
+            if (!cur_alt.empty() && !alt.empty()) { return (cur_alt == alt); }
             else
                 return true;
         }
-        else if (complement(m_ref) == ref)
+        else if (comp_ref == ref)
         {
-            if (!m_alt.empty() && !alt.empty())
-            { return (complement(m_alt) == alt); }
+            if (!cur_alt.empty() && !alt.empty()) { return (comp_alt == alt); }
             else
                 return true;
         }
-        else if (!m_alt.empty() && !alt.empty())
+        else if (!cur_alt.empty() && !alt.empty())
         {
-            if ((m_ref == alt) && (m_alt == ref))
+            if ((cur_ref == alt) && (cur_alt == ref))
             {
                 flipped = true;
                 return true;
             }
-            if ((complement(m_ref) == alt) && (complement(m_alt) == ref))
+            if ((comp_ref == alt) && (comp_alt == ref))
             {
                 flipped = true;
                 return true;
@@ -224,8 +238,14 @@ public:
     }
 
     std::string rs() const { return m_rs; }
-    std::string ref() const { return m_ref; }
-    std::string alt() const { return m_alt; }
+    std::string ref(const AlleleTable& table) const
+    {
+        return table.allele(m_ref);
+    }
+    std::string alt(const AlleleTable& table) const
+    {
+        return table.allele(m_alt);
+    }
     bool is_flipped() const { return m_flipped; }
     bool is_ref_flipped() const { return m_ref_flipped; }
 
@@ -236,15 +256,14 @@ public:
      */
     inline bool in(size_t i) const
     {
-        if (i / BITCT >= m_clump_info.max_flag_idx)
+        if (i / BITCT >= m_clump_info.flags.size())
             throw std::out_of_range("Out of range for flag");
         return (IS_SET(m_clump_info.flags.data(), i));
     }
 
     void set_flag(const size_t num_region, const std::vector<uintptr_t>& flags)
     {
-        m_clump_info.max_flag_idx = BITCT_TO_WORDCT(num_region);
-        m_clump_info.flags = flags;
+        m_clump_info.flags.assign(flags, BITCT_TO_WORDCT(num_region));
         m_clump_info.clumped = false;
     }
 
@@ -274,7 +293,7 @@ public:
         // and the index SNP will get all membership (or) from the clumped
         if (use_proxy && r2 > proxy)
         {
-            for (size_t i_flag = 0; i_flag < m_clump_info.max_flag_idx;
+            for (size_t i_flag = 0; i_flag < m_clump_info.flags.size();
                  ++i_flag)
             {
                 m_clump_info.flags[i_flag] |= target.m_clump_info.flags[i_flag];
@@ -283,7 +302,7 @@ public:
         }
         else
         {
-            for (size_t i_flag = 0; i_flag < m_clump_info.max_flag_idx;
+            for (size_t i_flag = 0; i_flag < m_clump_info.flags.size();
                  ++i_flag)
             {
                 // For normal clumping, we will remove set identity from the
@@ -365,20 +384,19 @@ public:
     {
         auto&& target = is_ref ? m_ref_count : m_target_count;
         if (m_ref_flipped && is_ref) std::swap(homcom, homrar);
-        target.homcom = homcom;
-        target.het = het;
-        target.homrar = homrar;
-        target.missing = missing;
+        target.homcom = static_cast<uint32_t>(homcom);
+        target.het = static_cast<uint32_t>(het);
+        target.homrar = static_cast<uint32_t>(homrar);
+        target.missing = static_cast<uint32_t>(missing);
         target.has_count = true;
     }
 
     std::vector<size_t> get_set_idx(const size_t num_sets) const
     {
-        std::vector<uintptr_t> flags = m_clump_info.flags;
         uintptr_t bitset;
         std::vector<size_t> out;
         out.reserve(num_sets);
-        for (size_t k = 0; k < m_clump_info.max_flag_idx; ++k)
+        for (size_t k = 0; k < m_clump_info.flags.size(); ++k)
         {
             bitset = m_clump_info.flags[k];
             while (bitset != 0)
@@ -423,9 +441,7 @@ private:
     FileInfo m_target;
     FileInfo m_reference;
     SNPClump m_clump_info;
-    std::string m_alt;
-    std::string m_ref;
-    std::string m_rs;
+    const char* m_rs = "";
     double m_stat = 0.0;
     double m_p_value = 2.0;
     double m_p_threshold = 0;
@@ -434,23 +450,13 @@ private:
     size_t m_chr = ~size_t(0);
     size_t m_loc = ~size_t(0);
     unsigned long long m_category = 0;
+    uint32_t m_alt = 0;
+    uint32_t m_ref = 0;
     bool m_has_expected = false;
     bool m_has_ref_expected = false;
     bool m_flipped = false;
     bool m_ref_flipped = false;
     bool m_is_valid = true;
-
-    inline std::string complement(const std::string& allele) const
-    {
-        // assume capitalized
-        if (allele == "A") return "T";
-        if (allele == "T") return "A";
-        if (allele == "G") return "C";
-        if (allele == "C")
-            return "G";
-        else
-            return allele; // Cannot flip, so will just return it as is
-    }
 };
 
 #endif // SNP_H
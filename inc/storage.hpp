@@ -18,6 +18,7 @@
 #ifndef PRSICE_INC_STORAGE_HPP_
 #define PRSICE_INC_STORAGE_HPP_
 #include "enumerators.h"
+#include <algorithm>
 #include <cstdint>
 #include <memory>
 #include <random>
@@ -25,11 +26,25 @@
 #include <vector>
 // From http://stackoverflow.com/a/12927952/1441789
 
-struct PRS
+// parameters required to add one SNP's contribution to the PRS
+struct SNPScoreWeight
 {
-    double prs;
-    size_t num_snp;
-    PRS() : prs(0.0), num_snp(0) {}
+    double stat;
+    double adj_score;
+    double miss_score;
+    double homcom_weight;
+    double het_weight;
+    double homrar_weight;
+    size_t miss_count;
+    bool not_first;
+};
+
+// summary statistic of a SNP in one of the base files of the score matrix.
+// flipped is true if its effect allele is the non-effect allele of the SNP
+struct ScoreBaseStat
+{
+    double stat;
+    bool flipped;
 };
 
 struct Sample_ID
@@ -76,6 +91,7 @@ struct GenoFile
     std::string keep;
     std::string remove;
     std::string type = "bed";
+    std::string dosage_cache;
     int hard_coded = false;
     int is_ref = false;
 };
@@ -109,21 +125,111 @@ struct Permutations
     bool run_set_perm = false;
 };
 
+/*!
+ * \brief Bit flags of the sets a SNP belongs to. When there are no more than
+ *        64 sets, the flags are stored inline so that we don't need a heap
+ *        allocation for every SNP
+ */
+class SetFlags
+{
+public:
+    SetFlags() { m_data.word = 0; }
+    SetFlags(const SetFlags& other) { copy(other); }
+    SetFlags(SetFlags&& other) noexcept
+    {
+        m_data = other.m_data;
+        m_num_word = other.m_num_word;
+        other.m_num_word = 0;
+        other.m_data.word = 0;
+    }
+    SetFlags& operator=(const SetFlags& other)
+    {
+        if (this != &other)
+        {
+            release();
+            copy(other);
+        }
+        return *this;
+    }
+    SetFlags& operator=(SetFlags&& other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+            m_data = other.m_data;
+            m_num_word = other.m_num_word;
+            other.m_num_word = 0;
+            other.m_data.word = 0;
+        }
+        return *this;
+    }
+    ~SetFlags() { release(); }
+    /*!
+     * \brief Replace the flags with the first num_word words of flags. Missing
+     *        words are set to 0
+     */
+    void assign(const std::vector<uintptr_t>& flags, const size_t num_word)
+    {
+        release();
+        m_num_word = static_cast<uint32_t>(num_word);
+        if (m_num_word > 1) m_data.heap = new uintptr_t[m_num_word];
+        uintptr_t* res = data();
+        for (size_t i = 0; i < num_word; ++i)
+        { res[i] = (i < flags.size()) ? flags[i] : 0; }
+    }
+    uintptr_t* data() { return (m_num_word > 1) ? m_data.heap : &m_data.word; }
+    const uintptr_t* data() const
+    {
+        return (m_num_word > 1) ? m_data.heap : &m_data.word;
+    }
+    uintptr_t& operator[](const size_t i) { return data()[i]; }
+    uintptr_t operator[](const size_t i) const { return data()[i]; }
+    size_t size() const { return m_num_word; }
+
+private:
+    union
+    {
+        uintptr_t word;
+        uintptr_t* heap;
+    } m_data;
+    uint32_t m_num_word = 0;
+    void release()
+    {
+        if (m_num_word > 1) delete[] m_data.heap;
+        m_num_word = 0;
+        m_data.word = 0;
+    }
+    void copy(const SetFlags& other)
+    {
+        m_num_word = other.m_num_word;
+        if (m_num_word > 1)
+        {
+            m_data.heap = new uintptr_t[m_num_word];
+            std::copy(other.m_data.heap, other.m_data.heap + m_num_word,
+                      m_data.heap);
+        }
+        else
+        {
+            m_data.word = other.m_data.word;
+        }
+    }
+};
+
 struct SNPClump
 {
-    std::vector<uintptr_t> flags;
+    SetFlags flags;
     size_t low_bound = ~size_t(0);
     size_t up_bound = ~size_t(0);
-    size_t max_flag_idx = 0;
     bool clumped = false;
 };
 
+// genotype counts are bounded by the number of samples, which fits in 32 bit
 struct AlleleCounts
 {
-    size_t homcom = 0;
-    size_t het = 0;
-    size_t homrar = 0;
-    size_t missing = 0;
+    uint32_t homcom = 0;
+    uint32_t het = 0;
+    uint32_t homrar = 0;
+    uint32_t missing = 0;
     bool has_count = false;
 };
 
@@ -176,6 +282,10 @@ struct QCFiltering
 
 struct Clumping
 {
+    // LD store to read the R2 from, and the LD store to write to
+    std::string ld_store;
+    std::string ld_store_out;
+    double ld_store_r2 = -1;
     double r2 = 0.1;
     double proxy = -1;
     double pvalue = 1;
@@ -0,0 +1,213 @@
+// This file is part of PRSice-2, copyright (C) 2016-2019
+// Shing Wan Choi, Paul F. O’Reilly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef TASK_SCHEDULER_H
+#define TASK_SCHEDULER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*!
+ * \brief Fixed capacity work stealing deque of task indices (Chase and Lev).
+ * Only the owner can push and take from the bottom, while any other thread
+ * can steal from the top without taking a lock
+ */
+class Task_Deque
+{
+public:
+    explicit Task_Deque(const size_t capacity)
+        : m_task(new std::atomic<size_t>[capacity > 0 ? capacity : 1])
+        , m_capacity(capacity > 0 ? capacity : 1)
+    {
+    }
+    Task_Deque(const Task_Deque&) = delete;
+    Task_Deque& operator=(const Task_Deque&) = delete;
+    /*!
+     * \brief Add a task to the bottom of the deque. Only the owner can call
+     * this and the deque must not hold more than its capacity
+     */
+    void push(const size_t task)
+    {
+        const long long bottom = m_bottom.load(std::memory_order_relaxed);
+        assert(bottom - m_top.load(std::memory_order_acquire)
+               < static_cast<long long>(m_capacity));
+        m_task[static_cast<size_t>(bottom) % m_capacity].store(
+            task, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+    /*!
+     * \brief Take the most recently pushed task. Only the owner can call this
+     * \return false if the deque is empty
+     */
+    bool take(size_t& task)
+    {
+        const long long bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+        m_bottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        long long top = m_top.load(std::memory_order_relaxed);
+        if (top > bottom)
+        {
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+            return false;
+        }
+        task = m_task[static_cast<size_t>(bottom) % m_capacity].load(
+            std::memory_order_relaxed);
+        if (top != bottom) return true;
+        // last task, race with the thieves for it
+        const bool won = m_top.compare_exchange_strong(
+            top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        return won;
+    }
+    /*!
+     * \brief Steal the oldest task. Can be called by any thread
+     * \return false if the deque is empty or if another thread got the task
+     * first
+     */
+    bool steal(size_t& task)
+    {
+        long long top = m_top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const long long bottom = m_bottom.load(std::memory_order_acquire);
+        if (top >= bottom) return false;
+        task = m_task[static_cast<size_t>(top) % m_capacity].load(
+            std::memory_order_relaxed);
+        return m_top.compare_exchange_strong(top, top + 1,
+                                             std::memory_order_seq_cst,
+                                             std::memory_order_relaxed);
+    }
+
+private:
+    std::unique_ptr<std::atomic<size_t>[]> m_task;
+    size_t m_capacity;
+    std::atomic<long long> m_top {0};
+    std::atomic<long long> m_bottom {0};
+};
+
+/*!
+ * \brief Run a set of independent tasks over a number of threads. Each thread
+ * owns a deque with a contiguous range of tasks, and steals from the other
+ * threads once its own deque is empty, so that no producer thread is required
+ * and threads stay busy when tasks take different amount of time
+ */
+class Task_Scheduler
+{
+public:
+    explicit Task_Scheduler(const size_t num_thread)
+        : m_num_thread(num_thread > 0 ? num_thread : 1)
+    {
+    }
+    Task_Scheduler(const Task_Scheduler&) = delete;
+    Task_Scheduler& operator=(const Task_Scheduler&) = delete;
+    size_t num_thread() const { return m_num_thread; }
+    /*!
+     * \brief Run task(task_idx, worker_idx) for each task_idx in
+     * [0, num_task). The calling thread is worker 0, and each worker runs
+     * one task at a time, so worker_idx can be used to index per worker
+     * buffers. The first exception thrown by a task is rethrown here once
+     * all workers stopped
+     */
+    void run(const size_t num_task,
+             const std::function<void(size_t, size_t)>& task)
+    {
+        if (num_task == 0) return;
+        const size_t num_worker = std::min(m_num_thread, num_task);
+        if (num_worker == 1)
+        {
+            for (size_t i = 0; i < num_task; ++i) task(i, 0);
+            return;
+        }
+        m_deque.clear();
+        m_remain = num_task;
+        m_error = nullptr;
+        m_failed = false;
+        for (size_t i = 0; i < num_worker; ++i)
+        {
+            const size_t start = num_task * i / num_worker;
+            const size_t end = num_task * (i + 1) / num_worker;
+            m_deque.emplace_back(new Task_Deque(end - start));
+            // push backward so that the owner run its tasks in order, while
+            // thieves take the tasks furthest away from it
+            for (size_t j = end; j > start; --j) m_deque.back()->push(j - 1);
+        }
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < num_worker; ++i)
+        {
+            workers.emplace_back(&Task_Scheduler::work, this, i,
+                                 std::cref(task));
+        }
+        work(0, task);
+        for (auto&& worker : workers) worker.join();
+        if (m_error) std::rethrow_exception(m_error);
+    }
+
+private:
+    std::vector<std::unique_ptr<Task_Deque>> m_deque;
+    std::exception_ptr m_error;
+    std::mutex m_error_mutex;
+    std::atomic<size_t> m_remain {0};
+    std::atomic<bool> m_failed {false};
+    size_t m_num_thread;
+    bool next_task(const size_t worker, size_t& task)
+    {
+        if (m_deque[worker]->take(task)) return true;
+        const size_t num_worker = m_deque.size();
+        for (size_t i = 1; i < num_worker; ++i)
+        {
+            if (m_deque[(worker + i) % num_worker]->steal(task)) return true;
+        }
+        return false;
+    }
+    void work(const size_t worker,
+              const std::function<void(size_t, size_t)>& task)
+    {
+        size_t task_idx;
+        // tasks are never added once started, so we are done when all of them
+        // are finished
+        while (m_remain.load(std::memory_order_acquire) != 0)
+        {
+            if (!next_task(worker, task_idx))
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            if (!m_failed.load(std::memory_order_relaxed))
+            {
+                try
+                {
+                    task(task_idx, worker);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(m_error_mutex);
+                    if (!m_error) m_error = std::current_exception();
+                    m_failed = true;
+                }
+            }
+            m_remain.fetch_sub(1, std::memory_order_acq_rel);
+        }
+    }
+};
+
+#endif
@@ -724,6 +724,24 @@ namespace bgen
         {
             call_finalise(setter, tag<has_finalise<Setter>::Yes>());
         }
+
+        // Setters with a set_diploid_probabilities method can receive the
+        // probabilities of regular (unphased, biallelic, diploid and 8 or 16
+        // bits) v1.2 blocks in one call instead of one call per value
+        template <typename Setter>
+        struct has_set_diploid_probabilities
+        {
+            template <typename U, void (U::*)(uint32_t, byte_t const*,
+                                              byte_t const*, int)>
+            struct SFINAE
+            {
+            };
+            template <typename U>
+            static uint8_t Test(SFINAE<U, &U::set_diploid_probabilities>*);
+            template <typename U>
+            static uint32_t Test(...);
+            static const bool Yes = sizeof(Test<Setter>(0)) == sizeof(uint8_t);
+        };
     }
 
     namespace impl
@@ -1052,6 +1070,79 @@ namespace bgen
             this->end = end;
         }
 
+        namespace impl
+        {
+            template <typename IntegerType>
+            void decode_diploid_probabilities(byte_t const* buffer,
+                                              uint32_t const number_of_samples,
+                                              double* homcom, double* het)
+            {
+                // same as parse_bit_representation, but the values are byte
+                // aligned so the whole block can be converted in one loop
+                double const max_value =
+                    double(std::numeric_limits<IntegerType>::max());
+                std::size_t const width = sizeof(IntegerType);
+                for (uint32_t i = 0; i < number_of_samples; ++i)
+                {
+                    byte_t const* p = buffer + 2 * width * i;
+                    uint32_t homcom_value = p[0];
+                    uint32_t het_value = p[width];
+                    if (width == 2)
+                    {
+                        homcom_value |= uint32_t(p[1]) << 8;
+                        het_value |= uint32_t(p[3]) << 8;
+                    }
+                    homcom[i] = homcom_value / max_value;
+                    het[i] = het_value / max_value;
+                }
+            }
+        }
+
+        // Decode the two stored probabilities (homozygous for the first allele
+        // and heterozygous) of each sample of a regular diploid block, as
+        // passed to set_diploid_probabilities. Missing samples are decoded
+        // as stored (zero) and must be identified from their ploidy byte
+        inline void decode_diploid_probabilities(
+            byte_t const* buffer, int const bits,
+            uint32_t const number_of_samples, double* homcom, double* het)
+        {
+            if (bits == 8)
+            {
+                impl::decode_diploid_probabilities<uint8_t>(
+                    buffer, number_of_samples, homcom, het);
+            }
+            else
+            {
+                assert(bits == 16);
+                impl::decode_diploid_probabilities<uint16_t>(
+                    buffer, number_of_samples, homcom, het);
+            }
+        }
+
+        template <typename Setter>
+        bool parse_diploid_probability_data(GenotypeDataBlock const& pack,
+                                            Setter& setter, tag<true> const&)
+        {
+            if (pack.numberOfAlleles != 2 || pack.phased
+                || pack.ploidyExtent[0] != 2 || pack.ploidyExtent[1] != 2
+                || (pack.bits != 8 && pack.bits != 16))
+            { return false; }
+            if (pack.end < pack.buffer
+                               + std::size_t(pack.numberOfSamples) * 2
+                                     * (pack.bits / 8))
+            { throw BGenError(); }
+            setter.set_diploid_probabilities(pack.numberOfSamples, pack.ploidy,
+                                             pack.buffer, int(pack.bits));
+            return true;
+        }
+
+        template <typename Setter>
+        bool parse_diploid_probability_data(GenotypeDataBlock const&, Setter&,
+                                            tag<false> const&)
+        {
+            return false;
+        }
+
         template <typename Setter>
         void parse_probability_data(byte_t const* buffer,
                                     byte_t const* const end,
@@ -1076,7 +1167,13 @@ namespace bgen
             call_set_min_max_ploidy(setter, uint32_t(pack.ploidyExtent[0]),
                                     uint32_t(pack.ploidyExtent[1]),
                                     pack.numberOfAlleles, pack.phased);
-
+            if (parse_diploid_probability_data(
+                    pack, setter,
+                    tag<has_set_diploid_probabilities<Setter>::Yes>()))
+            {
+                call_finalise(setter);
+                return;
+            }
             {
                 uint64_t data = 0;
                 int size = 0;
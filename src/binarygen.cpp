@@ -24,6 +24,7 @@ BinaryGen::BinaryGen(const GenoFile& geno, const Phenotype& pheno,
     m_remove_file = geno.remove;
     m_delim = delim;
     m_hard_coded = geno.hard_coded;
+    m_dosage_cache_name = geno.dosage_cache;
     m_reporter = reporter;
     init_chr();
     std::string message = "Initializing Genotype";
@@ -227,6 +228,9 @@ std::vector<Sample_ID> BinaryGen::gen_sample_vector()
             { duplicated_sample_id.push_back(id); }
             sample_in_file.insert(id);
             temp_inclusion_vec.push_back(inclusion);
+            // all included samples are founders
+            if (inclusion)
+            { m_founder_hash = misc::fnv_hash_field(id, m_founder_hash); }
             if (!m_is_ref && inclusion)
             {
                 // all sample must be a founder
@@ -263,9 +267,9 @@ std::vector<Sample_ID> BinaryGen::gen_sample_vector()
         }
     }
     m_founder_ct = m_sample_ct;
-    // initialize the PRS vector (can't reserve, otherwise seg fault(no idea
-    // why))
-    for (size_t i = 0; i < m_sample_ct; ++i) { m_prs_info.emplace_back(PRS()); }
+    // initialize the PRS vector
+    m_prs_score.assign(m_sample_ct, 0.0);
+    m_prs_num_snp.assign(m_sample_ct, 0);
     // initialize regression flag
     m_in_regression.resize(m_sample_include.size(), 0);
     return sample_name;
@@ -525,6 +529,8 @@ void BinaryGen::gen_snp_vector(
             std::string(m_genotype_file_names.front() + ".bgen"),
             m_context_map[0]);
     }
+    // the dosage cache is generated while we go through the bgen files
+    const bool build_cache = init_dosage_cache();
     for (size_t file_idx = 0; file_idx < m_genotype_file_names.size();
          ++file_idx)
     {
@@ -566,6 +572,9 @@ void BinaryGen::gen_snp_vector(
             // directly use the library without decompressing the genotype
             read_snp_identifying_data(bgen_file, context, &SNPID, &RSID,
                                       &chromosome, &SNP_position, &A1, &A2);
+            for (auto&& field : {chromosome, SNPID, RSID,
+                                 misc::to_string(SNP_position), A1, A2})
+            { m_variant_hash = misc::fnv_hash_field(field, m_variant_hash); }
             exclude_snp = false;
             if (chromosome != prev_chr)
             {
@@ -604,22 +613,21 @@ void BinaryGen::gen_snp_vector(
             // by this time point, we should always have the
             // m_existed_snps_index propagated with SNPs from the base. So we
             // can first check if the SNP are presented in base
-            auto&& find_rs = genotype->m_existed_snps_index.find(RSID);
-            auto&& find_snp = genotype->m_existed_snps_index.find(SNPID);
-            if (find_rs == genotype->m_existed_snps_index.end()
-                && find_snp == genotype->m_existed_snps_index.end())
+            const size_t find_rs = genotype->m_existed_snps_index.find(RSID);
+            const size_t find_snp = genotype->m_existed_snps_index.find(SNPID);
+            if (find_rs == ~size_t(0) && find_snp == ~size_t(0))
             {
                 // this is the reference panel, and the SNP wasn't found in the
                 // target doens't matter if we use RSID or SNPID
                 ++m_base_missed;
                 exclude_snp = true;
             }
-            else if (find_snp != genotype->m_existed_snps_index.end())
+            else if (find_snp != ~size_t(0))
             {
                 // we found the SNPID
                 cur_id = SNPID;
             }
-            else if (find_rs != genotype->m_existed_snps_index.end())
+            else if (find_rs != ~size_t(0))
             {
                 // we found the RSID
                 cur_id = RSID;
@@ -650,6 +658,15 @@ void BinaryGen::gen_snp_vector(
             // read in the genotype data block so that we advance the ifstream
             // pointer to the next SNP entry
             read_genotype_data_block(bgen_file, context, &m_buffer1);
+            if (build_cache)
+            {
+                // cache all SNPs, so that the cache can be used with any base
+                genfile::bgen::uncompress_probability_data(context, m_buffer1,
+                                                           &m_buffer2);
+                m_dosage_cache.add_variant(file_idx,
+                                           static_cast<uint64_t>(byte_pos),
+                                           context, m_buffer2);
+            }
             data_size = static_cast<long long>(bgen_file.tellg()) - start;
             if (data_size > static_cast<long long>(m_data_size))
             { m_data_size = static_cast<unsigned long long>(data_size); }
@@ -659,9 +676,11 @@ void BinaryGen::gen_snp_vector(
             {
                 // A1 = alleles.front();
                 // A2 = alleles.back();
-                auto&& target_index = genotype->m_existed_snps_index[cur_id];
+                const size_t target_index =
+                    genotype->m_existed_snps_index.find(cur_id);
                 if (!genotype->m_existed_snps[target_index].matching(
-                        chr_num, SNP_position, A1, A2, flipping))
+                        chr_num, SNP_position, A1, A2, flipping,
+                        genotype->m_allele_table))
                 {
 
                     genotype->print_mismatch(
@@ -675,7 +694,7 @@ void BinaryGen::gen_snp_vector(
                     processed_snps.insert(cur_id);
                     genotype->m_existed_snps[target_index].add_snp_info(
                         file_idx, byte_pos, chr_num, SNP_position, A1, A2,
-                        flipping, m_is_ref);
+                        flipping, m_is_ref, genotype->m_allele_table);
                     retain_snp[target_index] = true;
                     ++ref_target_match;
                 }
@@ -694,6 +713,16 @@ void BinaryGen::gen_snp_vector(
         bgen_file.close();
         fprintf(stderr, "\n");
     }
+    if (build_cache)
+    {
+        m_dosage_cache.close();
+        init_dosage_cache();
+        if (!m_dosage_cache.loaded())
+        {
+            throw std::runtime_error("Error: Failed to load dosage cache: "
+                                     + m_dosage_cache_name);
+        }
+    }
     if (ref_target_match != genotype->m_existed_snps.size())
     {
         // there are mismatch, so we need to update the snp vector
@@ -709,6 +738,29 @@ void BinaryGen::gen_snp_vector(
 }
 
 
+bool BinaryGen::init_dosage_cache()
+{
+    if (m_is_ref || m_dosage_cache_name.empty()) return false;
+    std::vector<DosageCache::Source> sources;
+    for (auto&& prefix : m_genotype_file_names)
+    { sources.push_back(DosageCache::source_info(prefix + ".bgen")); }
+    if (m_dosage_cache.load(m_dosage_cache_name, sources, m_sample_include,
+                            m_unfiltered_sample_ct, m_sample_ct))
+    {
+        m_reporter->report("Using dosage cache " + m_dosage_cache_name
+                           + " with "
+                           + misc::to_string(m_dosage_cache.num_variant())
+                           + " variant(s)");
+        return false;
+    }
+    m_reporter->report("Dosage cache " + m_dosage_cache_name
+                       + " not found or outdated. Generating a new one");
+    m_dosage_cache.create(m_dosage_cache_name, sources, m_sample_include,
+                          m_unfiltered_sample_ct, m_sample_ct);
+    return true;
+}
+
+
 bool BinaryGen::calc_freq_gen_inter(const QCFiltering& filter_info,
                                     const std::string& prefix, Genotype* target,
                                     bool force_cal)
@@ -789,7 +841,6 @@ bool BinaryGen::calc_freq_gen_inter(const QCFiltering& filter_info,
     // now start processing the bgen file
     double progress = 0, prev_progress = -1.0;
     const size_t total_snp = genotype->m_existed_snps.size();
-    genfile::bgen::Context context;
     for (auto&& snp : genotype->m_existed_snps)
     {
         progress = static_cast<double>(processed_count)
@@ -800,13 +851,14 @@ bool BinaryGen::calc_freq_gen_inter(const QCFiltering& filter_info,
                     progress);
             prev_progress = progress;
         }
+        read_ahead(processed_count, total_snp, m_is_ref,
+                   [&genotype](size_t i) -> const SNP& {
+                       return genotype->m_existed_snps[i];
+                   });
         snp.get_file_info(cur_file_idx, byte_pos, m_is_ref);
-        context = m_context_map[cur_file_idx];
         ++processed_count;
         // now read in the genotype information
-        genfile::bgen::read_and_parse_genotype_data_block<PLINK_generator>(
-            m_genotype_file, m_genotype_file_names[cur_file_idx] + ".bgen",
-            context, setter, &m_buffer1, &m_buffer2, byte_pos);
+        parse_genotype(cur_file_idx, byte_pos, setter);
         // no founder, much easier
         setter.get_count(ll_ct, lh_ct, hh_ct, missing);
         uii = ll_ct + lh_ct + hh_ct;
@@ -932,29 +984,42 @@ void BinaryGen::dosage_score(
     // currently, use_ref_maf doesn't work on bgen dosage file
     // main reason is we need expected value instead of
     // the MAF
+    const size_t num_snp = static_cast<size_t>(end_idx - start_idx);
+    const size_t num_thread =
+        static_cast<size_t>(std::max(1, m_prs_calculation.thread));
+    // there is no decompression to share between threads when the SNPs are
+    // read from the dosage cache
+    if (num_thread > 1 && num_snp >= BGEN_PIPELINE_MIN_SNP
+        && !m_dosage_cache.loaded())
+    {
+        // keep one thread for the accumulation
+        threaded_dosage_score(start_idx, end_idx, reset_zero, num_thread - 1);
+        return;
+    }
     bool not_first = !reset_zero;
     // we initialize the PRS interpretor with the required information.
-    // m_prs_info is where we store the PRS information
+    // m_prs_score and m_prs_num_snp are where we store the PRS information
     // and m_sample_include let us know if the sample is required.
     // m_missing_score will inform us as to how to handle the missingness
-    PRS_Interpreter setter(&m_prs_info, &m_sample_include,
+    PRS_Interpreter setter(&m_prs_score, &m_prs_num_snp, &m_sample_include,
                            m_prs_calculation.missing_score);
+    auto snp_at = [this, &start_idx](size_t i) -> const SNP& {
+        return m_existed_snps[*(start_idx + static_cast<long>(i))];
+    };
     std::vector<size_t>::const_iterator cur_idx = start_idx;
     size_t file_idx;
     long long byte_pos;
     for (; cur_idx != end_idx; ++cur_idx)
     {
+        read_ahead(static_cast<size_t>(cur_idx - start_idx), num_snp,
+                   m_is_ref, snp_at);
         auto&& snp = m_existed_snps[(*cur_idx)];
         snp.get_file_info(file_idx, byte_pos, m_is_ref);
-        // if the file name differ, or the file isn't open, we will open it
-        auto&& context = m_context_map[file_idx];
         setter.set_stat(snp.stat(), m_homcom_weight, m_het_weight,
                         m_homrar_weight, snp.is_flipped(), not_first);
 
         // start performing the parsing
-        genfile::bgen::read_and_parse_genotype_data_block<PRS_Interpreter>(
-            m_genotype_file, m_genotype_file_names[file_idx] + ".bgen", context,
-            setter, &m_buffer1, &m_buffer2, byte_pos);
+        parse_genotype(file_idx, byte_pos, setter);
         // check if this SNP has some non-missing sample, if not, invalidate
         // it
         // after reading in this SNP, we no longer need to reset the PRS
@@ -963,6 +1028,172 @@ void BinaryGen::dosage_score(
 }
 
 
+void BinaryGen::threaded_dosage_score(
+    const std::vector<size_t>::const_iterator& start_idx,
+    const std::vector<size_t>::const_iterator& end_idx, bool reset_zero,
+    const size_t num_worker)
+{
+    // a block goes through empty -> read -> parsed -> empty. Blocks are
+    // reused in a round robin fashion and seq tells us which SNP it holds
+    enum class BlockState
+    {
+        EMPTY,
+        READ,
+        PARSED
+    };
+    struct Block
+    {
+        std::vector<genfile::byte_t> compressed;
+        std::vector<double> dosage;
+        std::vector<char> missing;
+        const genfile::bgen::Context* context = nullptr;
+        size_t snp_idx = 0;
+        size_t seq = 0;
+        BlockState state = BlockState::EMPTY;
+    };
+    const size_t num_snp = static_cast<size_t>(end_idx - start_idx);
+    const size_t num_sample = m_prs_score.size();
+    std::vector<Block> blocks(num_worker * BGEN_PIPELINE_DEPTH);
+    std::mutex block_mutex;
+    std::condition_variable block_cond;
+    std::exception_ptr error;
+    size_t next_parse = 0;
+    bool abort = false;
+    auto stop = [&](std::exception_ptr cur_error) {
+        {
+            std::unique_lock<std::mutex> lock(block_mutex);
+            if (!error) error = cur_error;
+            abort = true;
+        }
+        block_cond.notify_all();
+    };
+    auto set_state = [&](Block& block, BlockState state) {
+        {
+            std::unique_lock<std::mutex> lock(block_mutex);
+            block.state = state;
+        }
+        block_cond.notify_all();
+    };
+    // return false if the pipeline was aborted
+    auto wait_for = [&](Block& block, size_t seq, BlockState state) {
+        std::unique_lock<std::mutex> lock(block_mutex);
+        block_cond.wait(lock, [&] {
+            return abort || (block.state == state && block.seq == seq);
+        });
+        return !abort;
+    };
+    // only this thread use m_genotype_file and m_context_map
+    auto reader = [&]() {
+        try
+        {
+            size_t file_idx;
+            long long byte_pos;
+            for (size_t i = 0; i < num_snp; ++i)
+            {
+                Block& block = blocks[i % blocks.size()];
+                // the block is empty when the SNP that used it before is done
+                if (i >= blocks.size()
+                    && !wait_for(block, i - blocks.size(), BlockState::EMPTY))
+                { return; }
+                read_ahead(i, num_snp, m_is_ref, [&](size_t j) -> const SNP& {
+                    return m_existed_snps[*(start_idx + static_cast<long>(j))];
+                });
+                block.snp_idx = *(start_idx + static_cast<long>(i));
+                m_existed_snps[block.snp_idx].get_file_info(file_idx, byte_pos,
+                                                            m_is_ref);
+                block.context = &m_context_map[file_idx];
+                genfile::bgen::read_genotype_data_block(
+                    m_genotype_file, m_genotype_file_names[file_idx] + ".bgen",
+                    *block.context, &block.compressed,
+                    static_cast<unsigned long long>(byte_pos));
+                {
+                    std::unique_lock<std::mutex> lock(block_mutex);
+                    block.seq = i;
+                    block.state = BlockState::READ;
+                }
+                block_cond.notify_all();
+            }
+        }
+        catch (...)
+        {
+            stop(std::current_exception());
+        }
+    };
+    auto worker = [&]() {
+        try
+        {
+            Dosage_Interpreter setter(&m_sample_include);
+            std::vector<genfile::byte_t> buffer;
+            while (true)
+            {
+                size_t i;
+                {
+                    std::unique_lock<std::mutex> lock(block_mutex);
+                    i = next_parse++;
+                }
+                if (i >= num_snp) return;
+                Block& block = blocks[i % blocks.size()];
+                if (!wait_for(block, i, BlockState::READ)) return;
+                setter.set_weight(m_homcom_weight, m_het_weight,
+                                  m_homrar_weight,
+                                  m_existed_snps[block.snp_idx].is_flipped());
+                block.dosage.resize(num_sample);
+                block.missing.resize(num_sample);
+                setter.m_dosage.swap(block.dosage);
+                setter.m_missing.swap(block.missing);
+                genfile::bgen::uncompress_probability_data(
+                    *block.context, block.compressed, &buffer);
+                genfile::bgen::parse_probability_data(
+                    buffer.data(), buffer.data() + buffer.size(),
+                    *block.context, setter);
+                setter.m_dosage.swap(block.dosage);
+                setter.m_missing.swap(block.missing);
+                set_state(block, BlockState::PARSED);
+            }
+        }
+        catch (...)
+        {
+            stop(std::current_exception());
+        }
+    };
+    std::vector<std::thread> threads;
+    threads.push_back(std::thread(reader));
+    for (size_t i_thread = 0; i_thread < num_worker; ++i_thread)
+    { threads.push_back(std::thread(worker)); }
+    // now add the SNPs to the PRS following their order, which is what
+    // dosage_score does
+    try
+    {
+        bool not_first = !reset_zero;
+        PRS_Interpreter setter(&m_prs_score, &m_prs_num_snp, &m_sample_include,
+                               m_prs_calculation.missing_score);
+        for (size_t i = 0; i < num_snp; ++i)
+        {
+            Block& block = blocks[i % blocks.size()];
+            if (!wait_for(block, i, BlockState::PARSED)) break;
+            auto&& snp = m_existed_snps[block.snp_idx];
+            setter.set_stat(snp.stat(), m_homcom_weight, m_het_weight,
+                            m_homrar_weight, snp.is_flipped(), not_first);
+            setter.initialise(num_sample, 0);
+            for (size_t i_sample = 0; i_sample < num_sample; ++i_sample)
+            {
+                setter.add_sample(block.dosage[i_sample],
+                                  block.missing[i_sample]);
+            }
+            setter.finalise();
+            not_first = true;
+            set_state(block, BlockState::EMPTY);
+        }
+    }
+    catch (...)
+    {
+        stop(std::current_exception());
+    }
+    for (auto&& thread : threads) { thread.join(); }
+    if (error) { std::rethrow_exception(error); }
+}
+
+
 void BinaryGen::hard_code_score(
     const std::vector<size_t>::const_iterator& start_idx,
     const std::vector<size_t>::const_iterator& end_idx, bool reset_zero)
@@ -994,13 +1225,18 @@ void BinaryGen::hard_code_score(
     long long byte_pos;
     // initialize the data structure for storing the genotype
     std::vector<uintptr_t> genotype(unfiltered_sample_ctl * 2, 0);
-    genfile::bgen::Context context;
     PLINK_generator setter(&m_sample_include, genotype.data(), m_hard_threshold,
                            m_dose_threshold);
+    const size_t num_snp = static_cast<size_t>(end_idx - start_idx);
+    auto snp_at = [this, &start_idx](size_t i) -> const SNP& {
+        return m_existed_snps[*(start_idx + static_cast<long>(i))];
+    };
     std::vector<size_t>::const_iterator cur_idx = start_idx;
     size_t idx;
     for (; cur_idx != end_idx; ++cur_idx)
     {
+        read_ahead(static_cast<size_t>(cur_idx - start_idx), num_snp,
+                   m_is_ref, snp_at);
         auto&& cur_snp = m_existed_snps[(*cur_idx)];
         // read in the genotype using the modified load_and_collapse_incl
         // function. m_target_plink will inform the function wheter there's
@@ -1027,11 +1263,7 @@ void BinaryGen::hard_code_score(
         else
         {
             // now read in the genotype information
-            context = m_context_map[idx];
-            // start performing the parsing
-            genfile::bgen::read_and_parse_genotype_data_block<PLINK_generator>(
-                m_genotype_file, file_name + ".bgen", context, setter,
-                &m_buffer1, &m_buffer2, byte_pos);
+            parse_genotype(idx, byte_pos, setter);
             setter.get_count(homcom_ct, het_ct, homrar_ct, missing_ct);
         }
         // TODO: if we haven't got the count from the genotype matrix, we will
@@ -1091,3 +1323,22 @@ void BinaryGen::read_score(const std::vector<size_t>::const_iterator& start_idx,
         dosage_score(start_idx, end_idx, reset_zero);
     }
 }
+
+void BinaryGen::read_background(const std::vector<size_t>& background)
+{
+    // a single SNP is scored serially without any thread, and every sample
+    // is overwritten, so we can simply copy the PRS of each SNP
+    for (size_t i = 0; i < background.size(); ++i)
+    {
+        read_score(background.cbegin() + static_cast<long>(i),
+                   background.cbegin() + static_cast<long>(i + 1), true);
+        std::copy(m_prs_score.begin(), m_prs_score.end(),
+                  m_bk_score.begin() + static_cast<long>(i * m_sample_ct));
+        for (size_t j = 0; j < m_sample_ct; ++j)
+        {
+            m_bk_num_snp[i * m_sample_ct + j] =
+                static_cast<uint8_t>(m_prs_num_snp[j]);
+        }
+        m_bk_valid[i] = true;
+    }
+}
@@ -16,6 +16,7 @@
 
 
 #include "binaryplink.hpp"
+#include <cstring>
 
 BinaryPlink::BinaryPlink(const GenoFile& geno, const Phenotype& pheno,
                          const std::string& delim, Reporter* reporter)
@@ -149,6 +150,7 @@ std::vector<Sample_ID> BinaryPlink::gen_sample_vector()
         {
             // this is a founder (with no dad / mum)
             ++m_founder_ct;
+            m_founder_hash = misc::fnv_hash_field(id, m_founder_hash);
             SET_BIT(sample_index, m_founder_info.data());
             SET_BIT(sample_index, m_sample_include.data());
             founder = true;
@@ -199,10 +201,10 @@ std::vector<Sample_ID> BinaryPlink::gen_sample_vector()
     // initialize the m_tmp_genotype vector
     const uintptr_t unfiltered_sample_ctv2 = 2 * unfiltered_sample_ctl;
     m_tmp_genotype.resize(unfiltered_sample_ctv2, 0);
-    // m_prs_info.reserve(m_sample_ct);
-    // now we add the prs information. For some reason, we can't do a simple
-    // reserve
-    for (size_t i = 0; i < m_sample_ct; ++i) { m_prs_info.emplace_back(PRS()); }
+    // now we add the prs information
+    m_prs_score.assign(m_sample_ct, 0.0);
+    m_prs_num_snp.assign(m_sample_ct, 0);
+    init_sample_gather();
     // also resize the in_regression flag
     m_in_regression.resize(m_sample_include.size(), 0);
     // initialize the sample_include2 and founder_include2 which are
@@ -280,6 +282,10 @@ bool BinaryPlink::calc_freq_gen_inter(const QCFiltering& filter_info,
                     progress);
             prev_progress = progress;
         }
+        read_ahead(processed_count, total_snp, m_is_ref,
+                   [&genotype](size_t i) -> const SNP& {
+                       return genotype->m_existed_snps[i];
+                   });
         ++processed_count;
         snp.get_file_info(cur_file_idx, byte_pos, m_is_ref);
         bed_name = m_genotype_file_names[cur_file_idx] + ".bed";
@@ -348,86 +354,62 @@ void BinaryPlink::gen_snp_vector(
     const uintptr_t unfiltered_sample_ct4 = (m_unfiltered_sample_ct + 3) / 4;
     std::unordered_set<std::string> processed_snps;
     std::unordered_set<std::string> duplicated_snp;
-    std::vector<std::string> bim_token;
     auto&& genotype = (m_is_ref) ? target : this;
     std::vector<bool> retain_snp(genotype->m_existed_snps.size(), false);
-    std::ifstream bim;
-    std::string bim_name, bed_name, chr, line;
     std::string prev_chr = "", error_message = "";
     const std::string mismatch_snp_record_name = out_prefix + ".mismatch";
-    std::string prefix;
     const std::string mismatch_print_type = (m_is_ref) ? "Reference" : "Base";
-    uintptr_t bed_offset;
     size_t num_retained = 0;
     size_t chr_num = 0;
-    size_t num_snp_read = 0;
     long long byte_pos;
     int chr_code = 0;
     bool chr_error = false, chr_sex_error = false, prev_chr_sex_error = false,
          prev_chr_error = false, flipping = false;
-    for (size_t idx = 0; idx < m_genotype_file_names.size(); ++idx)
-    {
-        // go through each genotype file
-        prefix = m_genotype_file_names[idx];
-        bim_name = prefix + ".bim";
-        bed_name = prefix + ".bed";
-        // make sure we reset the flag of the ifstream by closing it before use
-        if (bim.is_open()) bim.close();
-        bim.clear();
-        bim.open(bim_name.c_str());
-        if (!bim.is_open())
-        {
-            std::string error_message =
-                "Error: Cannot open bim file: " + bim_name;
-            throw std::runtime_error(error_message);
-        }
-        // First pass, get the number of marker in bed & bim
-        // as we want the number for checking, num_snp_read will start at 0
-        num_snp_read = 0;
-        prev_chr = "";
-        while (std::getline(bim, line))
-        {
-            misc::trim(line);
-            if (line.empty()) continue;
-            ++num_snp_read;
-        }
-        bim.clear();
-        bim.seekg(0, bim.beg);
-        // check if the bed file is valid
-        check_bed(bed_name, num_snp_read, bed_offset);
-        // now go through the bim file and perform filtering
-        num_snp_read = 0;
-        while (std::getline(bim, line))
+    // read all the bim files concurrently. Any error is kept and only thrown
+    // when we reach the file, so that the error reported is the same as when
+    // the files are read one by one
+    const size_t num_file = m_genotype_file_names.size();
+    std::vector<BimInfo> bim_info(num_file);
+    std::atomic<size_t> next_file(0);
+    auto load_worker = [&]() {
+        size_t idx;
+        while ((idx = next_file++) < num_file)
         {
-            misc::trim(line);
-            if (line.empty()) continue;
-            // we need to remember the actual number read is num_snp_read+1
-            ++num_snp_read;
-            bim_token = misc::split(line);
-            if (bim_token.size() < 6)
+            try
             {
-                std::string error_message =
-                    "Error: Malformed bim file. Less than 6 column on "
-                    "line: "
-                    + misc::to_string(num_snp_read) + "\n";
-                throw std::runtime_error(error_message);
+                load_bim(m_genotype_file_names[idx], *genotype, bim_info[idx]);
             }
-            auto&& base_idx =
-                genotype->m_existed_snps_index.find(bim_token[+BIM::RS]);
-            if (base_idx == genotype->m_existed_snps_index.end())
+            catch (...)
             {
-                ++m_base_missed;
-                continue;
+                bim_info[idx].error = std::current_exception();
             }
-
-            // read in the chromosome string
-            chr = bim_token[+BIM::CHR];
+        }
+    };
+    const size_t num_thread = std::min(
+        num_file,
+        static_cast<size_t>(std::max(1, genotype->m_prs_calculation.thread)));
+    std::vector<std::thread> workers;
+    for (size_t i_thread = 1; i_thread < num_thread; ++i_thread)
+    { workers.push_back(std::thread(load_worker)); }
+    load_worker();
+    for (auto&& thread : workers) { thread.join(); }
+    // now merge the variants following the file order
+    for (size_t idx = 0; idx < num_file; ++idx)
+    {
+        auto&& info = bim_info[idx];
+        if (info.error) { std::rethrow_exception(info.error); }
+        m_base_missed += info.num_base_missed;
+        m_variant_hash = misc::fnv_hash_field(
+            misc::to_string(info.variant_hash), m_variant_hash);
+        prev_chr = "";
+        for (auto&& variant : info.variants)
+        {
             // check if this is a new chromosome. If this is a new chromosome,
             // check if we want to remove it
-            if (chr != prev_chr)
+            if (variant.chr != prev_chr)
             {
                 // get the chromosome code using PLINK 2 function
-                chr_code = get_chrom_code_raw(chr.c_str());
+                chr_code = get_chrom_code_raw(variant.chr.c_str());
                 // check if we want to skip this chromosome
                 if (chr_code_check(chr_code, chr_sex_error, chr_error,
                                    error_message))
@@ -449,21 +431,20 @@ void BinaryPlink::gen_snp_vector(
                 // only update the prev_chr after we have done the checking
                 // this will help us to continue to skip all SNPs that are
                 // supposed to be removed instead of the first entry
-                prev_chr = chr;
+                prev_chr = variant.chr;
                 chr_num = static_cast<size_t>(chr_code);
             }
             // now read in the coordinate
             size_t loc = ~size_t(0);
             try
             {
-                loc = misc::string_to_size_t(bim_token[+BIM::BP].c_str());
+                loc = misc::string_to_size_t(variant.bp.c_str());
             }
             catch (...)
             {
                 throw std::runtime_error(
-                    "Error: Invalid SNP coordinate: " + bim_token[+BIM::RS]
-                    + ":" + bim_token[+BIM::BP]
-                    + "\nPlease check you have the correct input");
+                    "Error: Invalid SNP coordinate: " + variant.rs + ":"
+                    + variant.bp + "\nPlease check you have the correct input");
             }
             if (Genotype::within_region(exclusion_regions, chr_num, loc))
             {
@@ -472,21 +453,17 @@ void BinaryPlink::gen_snp_vector(
             }
 
             // ensure all alleles are capitalized for easy matching
-            std::transform(bim_token[+BIM::A1].begin(),
-                           bim_token[+BIM::A1].end(),
-                           bim_token[+BIM::A1].begin(), ::toupper);
-            std::transform(bim_token[+BIM::A2].begin(),
-                           bim_token[+BIM::A2].end(),
-                           bim_token[+BIM::A2].begin(), ::toupper);
+            std::transform(variant.a1.begin(), variant.a1.end(),
+                           variant.a1.begin(), ::toupper);
+            std::transform(variant.a2.begin(), variant.a2.end(),
+                           variant.a2.begin(), ::toupper);
             // check if this is a duplicated SNP
-            if (processed_snps.find(bim_token[+BIM::RS])
-                != processed_snps.end())
+            if (processed_snps.find(variant.rs) != processed_snps.end())
             {
-                duplicated_snp.insert(bim_token[+BIM::RS]);
+                duplicated_snp.insert(variant.rs);
                 continue;
             }
-            else if (!ambiguous(bim_token[+BIM::A1], bim_token[+BIM::A2])
-                     || m_keep_ambig)
+            else if (!ambiguous(variant.a1, variant.a2) || m_keep_ambig)
             {
                 // if the SNP is not ambiguous (or if we want to keep ambiguous
                 // SNPs), we will start processing the bed file (if required)
@@ -494,30 +471,27 @@ void BinaryPlink::gen_snp_vector(
                 // now read in the binary information and determine if we
                 // want to keep this SNP only do the filtering if we need to
                 // as my current implementation isn't as efficient as PLINK
-                m_num_ambig +=
-                    ambiguous(bim_token[+BIM::A1], bim_token[+BIM::A2]);
-
-                if (!genotype->m_existed_snps[base_idx->second].matching(
-                        chr_num, loc, bim_token[+BIM::A1], bim_token[+BIM::A2],
-                        flipping))
+                m_num_ambig += ambiguous(variant.a1, variant.a2);
+                auto&& base_snp = genotype->m_existed_snps[variant.base_idx];
+                if (!base_snp.matching(chr_num, loc, variant.a1, variant.a2,
+                                       flipping, genotype->m_allele_table))
                 {
                     genotype->print_mismatch(
                         mismatch_snp_record_name, mismatch_print_type,
-                        genotype->m_existed_snps[base_idx->second],
-                        bim_token[+BIM::RS], bim_token[+BIM::A1],
-                        bim_token[+BIM::A2], chr_num, loc);
+                        base_snp, variant.rs, variant.a1, variant.a2, chr_num,
+                        loc);
                     ++m_num_ref_target_mismatch;
                 }
                 else
                 {
                     byte_pos = static_cast<long long>(
-                        bed_offset
-                        + ((num_snp_read - 1) * (unfiltered_sample_ct4)));
-                    genotype->m_existed_snps[base_idx->second].add_snp_info(
-                        idx, byte_pos, chr_num, loc, bim_token[+BIM::A1],
-                        bim_token[+BIM::A2], flipping, m_is_ref);
-                    processed_snps.insert(bim_token[+BIM::RS]);
-                    retain_snp[base_idx->second] = true;
+                        info.bed_offset
+                        + ((variant.line - 1) * (unfiltered_sample_ct4)));
+                    base_snp.add_snp_info(idx, byte_pos, chr_num, loc,
+                                          variant.a1, variant.a2, flipping,
+                                          m_is_ref, genotype->m_allele_table);
+                    processed_snps.insert(variant.rs);
+                    retain_snp[variant.base_idx] = true;
                     num_retained++;
                 }
             }
@@ -526,7 +500,15 @@ void BinaryPlink::gen_snp_vector(
                 ++m_num_ambig;
             }
         }
-        bim.close();
+        if (info.malformed_line != 0)
+        {
+            throw std::runtime_error(
+                "Error: Malformed bim file. Less than 6 column on line: "
+                + misc::to_string(info.malformed_line) + "\n");
+        }
+        // release the memory
+        info.variants.clear();
+        info.variants.shrink_to_fit();
     }
     // try to release memory
     if (num_retained != genotype->m_existed_snps.size())
@@ -543,6 +525,86 @@ void BinaryPlink::gen_snp_vector(
     }
 }
 
+void BinaryPlink::load_bim(const std::string& prefix, const Genotype& genotype,
+                           BimInfo& info)
+{
+    const std::string bim_name = prefix + ".bim";
+    std::ifstream bim(bim_name.c_str());
+    if (!bim.is_open())
+    {
+        std::string error_message = "Error: Cannot open bim file: " + bim_name;
+        throw std::runtime_error(error_message);
+    }
+    bim.seekg(0, bim.end);
+    const size_t file_length = static_cast<size_t>(bim.tellg());
+    bim.close();
+    mio::mmap_source bim_map;
+    if (file_length != 0)
+    {
+        std::error_code error;
+        bim_map.map(bim_name, error);
+        if (error)
+        {
+            throw std::runtime_error("Error: Failed to map bim file: "
+                                     + bim_name);
+        }
+    }
+    const char* cur = bim_map.data();
+    const char* end = &(cur[file_length]);
+    std::vector<std::pair<const char*, const char*>> token;
+    while (cur < end)
+    {
+        const char* line_end = static_cast<const char*>(
+            memchr(cur, '\n', static_cast<size_t>(end - cur)));
+        if (line_end == nullptr) line_end = end;
+        const char* next_line = (line_end == end) ? end : line_end + 1;
+        misc::trim(cur, line_end);
+        if (cur == line_end)
+        {
+            cur = next_line;
+            continue;
+        }
+        // the number of marker is the number of non-empty line
+        ++info.num_marker;
+        // no need to read in any variant after the file is found to be
+        // malformed, but we still need the marker count for checking the bed
+        if (info.malformed_line == 0)
+        {
+            misc::split(token, cur, line_end, +BIM::MAX);
+            if (token.size() < +BIM::MAX)
+            { info.malformed_line = info.num_marker; }
+            else
+            {
+                for (auto&& col :
+                     {BIM::CHR, BIM::RS, BIM::BP, BIM::A1, BIM::A2})
+                {
+                    info.variant_hash = misc::fnv_hash_field(
+                        token[+col].first, token[+col].second,
+                        info.variant_hash);
+                }
+                auto&& rs = token[+BIM::RS];
+                const size_t base_idx = genotype.m_existed_snps_index.find(
+                    rs.first, static_cast<size_t>(rs.second - rs.first));
+                if (base_idx == ~size_t(0)) { ++info.num_base_missed; }
+                else
+                {
+                    auto&& get = [&](BIM col) {
+                        return std::string(token[+col].first,
+                                           token[+col].second);
+                    };
+                    info.variants.push_back(BimInfo::Variant {
+                        get(BIM::CHR), get(BIM::RS), get(BIM::BP),
+                        get(BIM::A1), get(BIM::A2), info.num_marker,
+                        base_idx});
+                }
+            }
+        }
+        cur = next_line;
+    }
+    // check if the bed file is valid
+    check_bed(prefix + ".bed", info.num_marker, info.bed_offset);
+}
+
 
 void BinaryPlink::check_bed(const std::string& bed_name, size_t num_marker,
                             uintptr_t& bed_offset)
@@ -643,14 +705,13 @@ void BinaryPlink::check_bed(const std::string& bed_name, size_t num_marker,
 
 BinaryPlink::~BinaryPlink() {}
 
-void BinaryPlink::read_score(
-    const std::vector<size_t>::const_iterator& start_idx,
-    const std::vector<size_t>::const_iterator& end_idx, bool reset_zero)
+bool BinaryPlink::read_score_genotype(SNP& cur_snp, uintptr_t* genotype,
+                                      const size_t word_ct, const bool gather,
+                                      double& maf)
 {
     // for removing unwanted bytes from the end of the genotype vector
     const uintptr_t final_mask =
         get_final_mask(static_cast<uint32_t>(m_sample_ct));
-    // this is use for initialize the array sizes
     const uintptr_t unfiltered_sample_ctl =
         BITCT_TO_WORDCT(m_unfiltered_sample_ct);
     const uintptr_t unfiltered_sample_ct4 = (m_unfiltered_sample_ct + 3) / 4;
@@ -664,111 +725,217 @@ void BinaryPlink::read_score(
     size_t homcom_ct = 0;
     size_t tmp_total = 0;
     const size_t ploidy = 2;
-    // those are the weight (0,1,2) for each genotype observation
-    double homcom_weight = m_homcom_weight;
-    double het_weight = m_het_weight;
-    double homrar_weight = m_homrar_weight;
-    // this is required if we want to calculate the MAF from the genotype (for
-    // imputation of missing genotype)
-    // if we want to set the missing score to zero, miss_count will equal to 0,
-    // 1 otherwise
-    const size_t miss_count =
-        (m_prs_calculation.missing_score != MISSING_SCORE::SET_ZERO) * ploidy;
-    // this indicate if we want the mean of the genotype to be 0 (missingness =
-    // 0)
-    const bool is_centre =
-        (m_prs_calculation.missing_score == MISSING_SCORE::CENTER);
-    // this indicate if we want to impute the missing genotypes using the
-    // population mean
-    const bool mean_impute =
-        (m_prs_calculation.missing_score == MISSING_SCORE::MEAN_IMPUTE);
+    size_t file_idx;
+    long long cur_line;
+    cur_snp.get_file_info(file_idx, cur_line, false);
+    const std::string file_name = m_genotype_file_names[file_idx] + ".bed";
+    // important point to note here is the use of m_sample_include and
+    // m_sample_ct instead of using the m_founder m_founder_info as the
+    // founder vector is for LD calculation whereas the sample_include is
+    // for PRS
+    const char* raw_genotype = nullptr;
+    if (cur_snp.get_counts(homcom_ct, het_ct, homrar_ct, missing_ct,
+                           m_prs_calculation.use_ref_maf))
+    {
+        // the counts are known, so the genotype only need to be copied
+        // into the block, which can be done directly from the memory map
+        // when available
+        if (m_founder_ct == missing_ct)
+        {
+            // problematic snp
+            cur_snp.invalid();
+            return false;
+        }
+        raw_genotype =
+            m_genotype_file.view(file_name, cur_line, unfiltered_sample_ct4);
+    }
+    else
+    {
+        // we need to calculate the MAF, which requires an aligned copy
+        // if we want to use reference, we will always have calculated the
+        // MAF
+        m_genotype_file.read(file_name, cur_line, unfiltered_sample_ct4,
+                             reinterpret_cast<char*>(m_tmp_genotype.data()));
+        single_marker_freqs_and_hwe(
+            unfiltered_sample_ctv2, m_tmp_genotype.data(),
+            m_sample_include2.data(), m_founder_include2.data(), m_sample_ct,
+            &ll_ct, &lh_ct, &hh_ct, m_founder_ct, &ll_ctf, &lh_ctf, &hh_ctf);
+        homcom_ct = ll_ctf;
+        het_ct = lh_ctf;
+        homrar_ct = hh_ctf;
+        tmp_total = (homcom_ct + het_ct + homrar_ct);
+        assert(m_founder_ct >= tmp_total);
+        missing_ct = m_founder_ct - tmp_total;
+        cur_snp.set_counts(homcom_ct, het_ct, homrar_ct, missing_ct, false);
+        if (m_founder_ct == missing_ct)
+        {
+            // problematic snp
+            cur_snp.invalid();
+            return false;
+        }
+        raw_genotype = reinterpret_cast<const char*>(m_tmp_genotype.data());
+    }
+    // the genotype is never subsetted here, as the included samples are
+    // gathered from the unfiltered genotype when scoring
+    if (!gather) genotype[word_ct - 1] = 0;
+    if (raw_genotype == nullptr)
+    {
+        m_genotype_file.read(file_name, cur_line, unfiltered_sample_ct4,
+                             reinterpret_cast<char*>(genotype));
+    }
+    else
+    {
+        std::memcpy(genotype, raw_genotype, unfiltered_sample_ct4);
+    }
+    if (!gather)
+    { genotype[(m_unfiltered_sample_ct - 1) / BITCT2] &= final_mask; }
+    maf = 1.0
+          - static_cast<double>(m_homcom_weight * homcom_ct
+                                + het_ct * m_het_weight
+                                + m_homrar_weight * homrar_ct)
+                / (static_cast<double>((homcom_ct + het_ct + homrar_ct)
+                                       * ploidy));
+    return true;
+}
+
+void BinaryPlink::read_score(
+    const std::vector<size_t>::const_iterator& start_idx,
+    const std::vector<size_t>::const_iterator& end_idx, bool reset_zero)
+{
+    const size_t ploidy = 2;
     // check if it is not the frist run, if it is the first run, we will reset
     // the PRS to zero instead of addint it up
     bool not_first = !reset_zero;
-    double stat, maf, adj_score, miss_score;
-    // m_cur_file = ""; // just close it
-    // if (m_bed_file.is_open()) { m_bed_file.close(); }
-    // initialize the genotype vector to store the binary genotypes
-    std::vector<uintptr_t> genotype(unfiltered_sample_ctl * 2, 0);
+    double maf;
+    // SNPs are first read (serially, as the file reader and the SNP counts
+    // are not thread safe) into a block of sample subsetted genotypes, which
+    // is then scored by score_block using all available threads. When some
+    // samples are excluded, the block contains the unfiltered genotypes and
+    // the included samples are gathered during scoring instead
+    const bool gather = !m_sample_gather.empty();
+    const size_t word_ct = gather ? QUATERCT_TO_WORDCT(m_unfiltered_sample_ct)
+                                  : QUATERCT_TO_WORDCT(m_sample_ct);
+    const size_t block_size = score_block_size(
+        word_ct, static_cast<size_t>(std::distance(start_idx, end_idx)));
+    std::vector<uintptr_t> block(block_size * word_ct, 0);
+    std::vector<SNPScoreWeight> weights;
+    weights.reserve(block_size);
+    uintptr_t* genotype = block.data();
     std::vector<size_t>::const_iterator cur_idx = start_idx;
-    long long cur_line;
-    std::string file_name;
-    size_t file_idx;
+    const size_t num_snp = static_cast<size_t>(end_idx - start_idx);
+    auto snp_at = [this, &start_idx](size_t i) -> const SNP& {
+        return m_existed_snps[*(start_idx + static_cast<long>(i))];
+    };
     for (; cur_idx != end_idx; ++cur_idx)
     {
+        read_ahead(static_cast<size_t>(cur_idx - start_idx), num_snp, false,
+                   snp_at);
         auto&& cur_snp = m_existed_snps[(*cur_idx)];
-        cur_snp.get_file_info(file_idx, cur_line, false);
-        file_name = m_genotype_file_names[file_idx] + ".bed";
-        // we now read the genotype from the file by calling
-        // load_and_collapse_incl
-        // important point to note here is the use of m_sample_include and
-        // m_sample_ct instead of using the m_founder m_founder_info as the
-        // founder vector is for LD calculation whereas the sample_include is
-        // for PRS
-        m_genotype_file.read(file_name, cur_line, unfiltered_sample_ct4,
-                             reinterpret_cast<char*>(m_tmp_genotype.data()));
-        if (!cur_snp.get_counts(homcom_ct, het_ct, homrar_ct, missing_ct,
-                                m_prs_calculation.use_ref_maf))
-        {
-            // we need to calculate the MA
-            // if we want to use reference, we will always have calculated the
-            // MAF
-            single_marker_freqs_and_hwe(
-                unfiltered_sample_ctv2, m_tmp_genotype.data(),
-                m_sample_include2.data(), m_founder_include2.data(),
-                m_sample_ct, &ll_ct, &lh_ct, &hh_ct, m_founder_ct, &ll_ctf,
-                &lh_ctf, &hh_ctf);
-            homcom_ct = ll_ctf;
-            het_ct = lh_ctf;
-            homrar_ct = hh_ctf;
-            tmp_total = (homcom_ct + het_ct + homrar_ct);
-            assert(m_founder_ct >= tmp_total);
-            missing_ct = m_founder_ct - tmp_total;
-            cur_snp.set_counts(homcom_ct, het_ct, homrar_ct, missing_ct, false);
-        }
-        if (m_unfiltered_sample_ct != m_sample_ct)
+        if (!read_score_genotype(cur_snp, genotype, word_ct, gather, maf))
+            continue;
+        weights.push_back(score_weight(cur_snp.stat(), maf,
+                                       cur_snp.is_flipped(), ploidy,
+                                       not_first));
+        genotype += word_ct;
+        // indicate that we've already read in the first SNP and no longer need
+        // to reset the PRS
+        not_first = true;
+        if (weights.size() == block_size)
         {
-            copy_quaterarr_nonempty_subset(
-                m_tmp_genotype.data(), m_sample_include.data(),
-                static_cast<uint32_t>(m_unfiltered_sample_ct),
-                static_cast<uint32_t>(m_sample_ct), genotype.data());
+            // now we go through the SNP block
+            score_block(block, weights, word_ct, ploidy, gather);
+            weights.clear();
+            genotype = block.data();
         }
-        else
+    }
+    score_block(block, weights, word_ct, ploidy, gather);
+}
+
+void BinaryPlink::read_score_matrix(const std::vector<size_t>& snp_index)
+{
+    const size_t ploidy = 2;
+    double maf;
+    // same as read_score, except that each SNP has a row of lookup tables
+    // containing the score of all base files instead of a single weight
+    const bool gather = !m_sample_gather.empty();
+    const size_t word_ct = gather ? QUATERCT_TO_WORDCT(m_unfiltered_sample_ct)
+                                  : QUATERCT_TO_WORDCT(m_sample_ct);
+    const size_t block_size = score_block_size(word_ct, snp_index.size());
+    std::vector<uintptr_t> block(block_size * word_ct, 0);
+    std::vector<double> prs_lut;
+    std::vector<uint32_t> count_lut;
+    prs_lut.reserve(block_size * 4 * m_num_base);
+    count_lut.reserve(block_size * 4 * m_num_base);
+    uintptr_t* genotype = block.data();
+    size_t num_block_snp = 0;
+    auto snp_at = [this, &snp_index](size_t i) -> const SNP& {
+        return m_existed_snps[snp_index[i]];
+    };
+    for (size_t i = 0; i < snp_index.size(); ++i)
+    {
+        read_ahead(i, snp_index.size(), false, snp_at);
+        auto&& cur_snp = m_existed_snps[snp_index[i]];
+        if (!read_score_genotype(cur_snp, genotype, word_ct, gather, maf))
+            continue;
+        add_score_matrix_lut(&m_base_stat[snp_index[i] * m_num_base], maf,
+                             cur_snp.is_flipped(), ploidy, prs_lut, count_lut);
+        genotype += word_ct;
+        if (++num_block_snp == block_size)
         {
-            genotype = m_tmp_genotype;
-            genotype[(m_unfiltered_sample_ct - 1) / BITCT2] &= final_mask;
+            score_matrix_block(block, prs_lut, count_lut, num_block_snp,
+                               word_ct, gather);
+            prs_lut.clear();
+            count_lut.clear();
+            num_block_snp = 0;
+            genotype = block.data();
         }
-        // directly read in the current location
-        if (m_founder_ct == missing_ct)
-        {
-            // problematic snp
-            cur_snp.invalid();
+    }
+    score_matrix_block(block, prs_lut, count_lut, num_block_snp, word_ct,
+                       gather);
+}
+
+void BinaryPlink::read_background(const std::vector<size_t>& background)
+{
+    const size_t ploidy = 2;
+    double maf;
+    // same as read_score_matrix, except that each SNP has its own column in
+    // the background cache, which is overwritten instead of added to
+    const bool gather = !m_sample_gather.empty();
+    const size_t word_ct = gather ? QUATERCT_TO_WORDCT(m_unfiltered_sample_ct)
+                                  : QUATERCT_TO_WORDCT(m_sample_ct);
+    const size_t block_size = score_block_size(word_ct, background.size());
+    std::vector<uintptr_t> block(block_size * word_ct, 0);
+    std::vector<double> prs_lut;
+    std::vector<uint8_t> count_lut;
+    std::vector<size_t> bk_pos;
+    prs_lut.reserve(block_size * 4);
+    count_lut.reserve(block_size * 4);
+    bk_pos.reserve(block_size);
+    uintptr_t* genotype = block.data();
+    auto snp_at = [this, &background](size_t i) -> const SNP& {
+        return m_existed_snps[background[i]];
+    };
+    for (size_t i = 0; i < background.size(); ++i)
+    {
+        read_ahead(i, background.size(), false, snp_at);
+        auto&& cur_snp = m_existed_snps[background[i]];
+        if (!read_score_genotype(cur_snp, genotype, word_ct, gather, maf))
             continue;
-        }
-        homcom_weight = m_homcom_weight;
-        het_weight = m_het_weight;
-        homrar_weight = m_homrar_weight;
-        maf = 1.0
-              - static_cast<double>(homcom_weight * homcom_ct
-                                    + het_ct * het_weight
-                                    + homrar_weight * homrar_ct)
-                    / (static_cast<double>((homcom_ct + het_ct + homrar_ct)
-                                           * ploidy));
-        if (cur_snp.is_flipped())
+        add_background_lut(score_weight(cur_snp.stat(), maf,
+                                        cur_snp.is_flipped(), ploidy, false),
+                           ploidy, prs_lut, count_lut);
+        bk_pos.push_back(i);
+        m_bk_valid[i] = true;
+        genotype += word_ct;
+        if (bk_pos.size() == block_size)
         {
-            std::swap(homcom_weight, homrar_weight);
-            maf = 1.0 - maf;
+            background_block(block, prs_lut, count_lut, bk_pos, word_ct,
+                             gather);
+            prs_lut.clear();
+            count_lut.clear();
+            bk_pos.clear();
+            genotype = block.data();
         }
-        stat = cur_snp.stat();
-        adj_score = 0;
-        if (is_centre) { adj_score = ploidy * stat * maf; }
-        miss_score = 0;
-        if (mean_impute) { miss_score = ploidy * stat * maf; }
-        // now we go through the SNP vector
-        read_prs(genotype, ploidy, stat, adj_score, miss_score, miss_count,
-                 homcom_weight, het_weight, homrar_weight, not_first);
-        // indicate that we've already read in the first SNP and no longer need
-        // to reset the PRS
-        not_first = true;
     }
+    background_block(block, prs_lut, count_lut, bk_pos, word_ct, gather);
 }
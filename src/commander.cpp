@@ -87,6 +87,7 @@ bool Commander::init(int argc, char* argv[], Reporter& reporter)
         {"clump-p", required_argument, nullptr, 0},
         {"clump-r2", required_argument, nullptr, 0},
         {"cov-factor", required_argument, nullptr, 0},
+        {"dosage-cache", required_argument, nullptr, 0},
         {"dose-thres", required_argument, nullptr, 0},
         {"exclude", required_argument, nullptr, 0},
         {"extract", required_argument, nullptr, 0},
@@ -99,6 +100,9 @@ bool Commander::init(int argc, char* argv[], Reporter& reporter)
         {"ld-dose-thres", required_argument, nullptr, 0},
         {"ld-keep", required_argument, nullptr, 0},
         {"ld-list", required_argument, nullptr, 0},
+        {"ld-store", required_argument, nullptr, 0},
+        {"ld-store-out", required_argument, nullptr, 0},
+        {"ld-store-r2", required_argument, nullptr, 0},
         {"ld-type", required_argument, nullptr, 0},
         {"ld-remove", required_argument, nullptr, 0},
         {"ld-maf", required_argument, nullptr, 0},
@@ -113,6 +117,7 @@ bool Commander::init(int argc, char* argv[], Reporter& reporter)
         {"proxy", required_argument, nullptr, 0},
         {"remove", required_argument, nullptr, 0},
         {"score", required_argument, nullptr, 0},
+        {"score-base", required_argument, nullptr, 0},
         {"set-perm", required_argument, nullptr, 0},
         {"shrink-perm", required_argument, nullptr, 0},
         {"snp", required_argument, nullptr, 0},
@@ -180,6 +185,8 @@ bool Commander::parse_command(int argc, char* argv[], const char* optString,
                 error |= !set_numeric<double>(optarg, command, m_clump_info.r2);
             else if (command == "cov-factor")
                 load_string_vector(optarg, command, m_pheno_info.factor_cov);
+            else if (command == "dosage-cache")
+                set_string(optarg, command, m_target.dosage_cache);
             else if (command == "dose-thres")
                 error |= !set_numeric<double>(optarg, command,
                                               m_target_filter.dose_threshold);
@@ -218,6 +225,13 @@ bool Commander::parse_command(int argc, char* argv[], const char* optString,
                 set_string(optarg, command, m_reference.keep);
             else if (command == "ld-list")
                 set_string(optarg, command, m_reference.file_list);
+            else if (command == "ld-store")
+                set_string(optarg, command, m_clump_info.ld_store);
+            else if (command == "ld-store-out")
+                set_string(optarg, command, m_clump_info.ld_store_out);
+            else if (command == "ld-store-r2")
+                error |= !set_numeric<double>(optarg, command,
+                                              m_clump_info.ld_store_r2);
             else if (command == "ld-maf")
                 error |=
                     !set_numeric<double>(optarg, command, m_ref_filter.maf);
@@ -254,6 +268,8 @@ bool Commander::parse_command(int argc, char* argv[], const char* optString,
                 set_string(optarg, command, m_target.remove);
             else if (command == "score")
                 error |= !set_score(optarg);
+            else if (command == "score-base")
+                load_string_vector(optarg, command, m_score_base);
             else if (command == "set-perm")
             {
                 error |= !set_numeric<size_t>(optarg, command,
@@ -495,6 +511,19 @@ void Commander::set_help_message()
         "                            from --beta \n"
         "    --pvalue        | -p    Column header containing the p-value\n"
         "                            Default: P\n"
+        "    --score-base            Additional base files, comma separated, "
+        "with the\n"
+        "                            same columns as the base file. If "
+        "provided, PRSice\n"
+        "                            will output the PRS of all samples for "
+        "each base\n"
+        "                            file to <out>.score_matrix, reading the "
+        "target\n"
+        "                            genotypes once. Clumping, p-value "
+        "thresholding\n"
+        "                            and regression are not performed. Only "
+        "support\n"
+        "                            binary PLINK target\n"
         "    --snp                   Column header containing the SNP ID\n"
         "                            Default: SNP\n"
         "    --stat                  Column header containing the summary "
@@ -596,6 +625,15 @@ void Commander::set_help_message()
         "clumping\n"
         "                            reference and for hard coding PRS "
         "calculation\n"
+        "    --dosage-cache          Uncompressed copy of the target "
+        "genotypes. If the\n"
+        "                            file does not exist or was generated "
+        "from different\n"
+        "                            bgen files or samples, it will be "
+        "generated. Later\n"
+        "                            runs on the same target can then skip "
+        "the\n"
+        "                            decompression of the genotypes\n"
         "    --dose-thres            Translate any SNPs with highest genotype "
         "probability\n"
         "                            less than this threshold to missing call\n"
@@ -668,6 +706,30 @@ void Commander::set_help_message()
           "                            at the moment\n"
           "    --ld-maf                Filter SNPs based on minor allele "
           "frequency\n"
+          "    --ld-store              LD store generated by --ld-store-out. "
+          "Clumping will\n"
+          "                            use the R2 stored in this file instead "
+          "of\n"
+          "                            calculating them from the LD reference. "
+          "Must be\n"
+          "                            generated from the same LD reference "
+          "samples with\n"
+          "                            --clump-kb at least as large as the "
+          "current run\n"
+          "    --ld-store-out          Write the R2 between all SNPs within "
+          "the clump\n"
+          "                            window to this file, so that it can be "
+          "reused by\n"
+          "                            --ld-store in later runs. Only SNPs "
+          "included in\n"
+          "                            this run are stored. R2 are stored in "
+          "double\n"
+          "                            precision, so clumping with the store "
+          "gives the\n"
+          "                            same result as calculating them\n"
+          "    --ld-store-r2           Minimum R2 to be kept in the LD store. "
+          "Default is\n"
+          "                            the R2 threshold used for clumping\n"
           "    --ld-remove             File containing the sample(s) to be "
           "removed from\n"
           "                            the LD reference file. First column "
@@ -1105,6 +1167,30 @@ bool Commander::base_check()
         { max_index = m_base_info.column_index[i]; }
     }
     m_base_info.column_index[+BASE_INDEX::MAX] = max_index;
+    // the score base files are parsed using the column index of the base
+    // file, so their headers must match
+    if (!m_base_info.is_index)
+    {
+        const std::vector<std::string> base_header =
+            get_base_header(m_base_info.file_name);
+        for (auto&& file : m_score_base)
+        {
+            const std::vector<std::string> header = get_base_header(file);
+            for (size_t i = 0; i < +BASE_INDEX::MAX; ++i)
+            {
+                if (!m_base_info.has_column[i]) continue;
+                const size_t idx = m_base_info.column_index[i];
+                if (idx >= header.size() || header[idx] != base_header[idx])
+                {
+                    error = true;
+                    m_error_message.append("Error: Columns of score base file "
+                                           + file
+                                           + " do not match the base file\n");
+                    break;
+                }
+            }
+        }
+    }
     return !error;
 }
 
@@ -1132,6 +1218,32 @@ bool Commander::clump_check()
             m_error_message.append(
                 "Error: R2 threshold must be within 0 and 1!\n");
         }
+        if (!m_clump_info.ld_store.empty()
+            && !m_clump_info.ld_store_out.empty())
+        {
+            error = true;
+            m_error_message.append("Error: --ld-store and --ld-store-out "
+                                   "cannot be used together!\n");
+        }
+        if (!m_clump_info.ld_store_out.empty())
+        {
+            // by default, keep all R2 that can affect the current clumping
+            if (m_clump_info.ld_store_r2 < 0)
+            {
+                m_clump_info.ld_store_r2 =
+                    (m_clump_info.use_proxy)
+                        ? std::min(m_clump_info.proxy, m_clump_info.r2)
+                        : m_clump_info.r2;
+            }
+            else if (m_clump_info.ld_store_r2 > 1.0)
+            {
+                error = true;
+                m_error_message.append(
+                    "Error: LD store R2 must be within 0 and 1!\n");
+            }
+            m_parameter_log["ld-store-r2"] =
+                std::to_string(m_clump_info.ld_store_r2);
+        }
         m_parameter_log["clump-r2"] = std::to_string(m_clump_info.r2);
         m_parameter_log["clump-p"] = std::to_string(m_clump_info.pvalue);
         // we divided by 1000 here to make sure it is in KB (our preferred
@@ -1533,6 +1645,34 @@ bool Commander::misc_check()
                 "generate intermediate file\n");
         }
     }
+    if (!m_score_base.empty() && m_target.type != "bed")
+    {
+        error = true;
+        m_error_message.append("Error: Score matrix (--score-base) is only "
+                               "supported for binary PLINK target\n");
+    }
+    if (!m_score_base.empty() && m_prset.run)
+    {
+        error = true;
+        m_error_message.append("Error: Score matrix (--score-base) cannot be "
+                               "used together with PRSet\n");
+    }
+    if (!m_score_base.empty()
+        && m_prs_info.scoring_method == SCORING::CONTROL_STD)
+    {
+        // the score matrix has no phenotype, so there are no controls to
+        // standardize on
+        error = true;
+        m_error_message.append("Error: Score matrix (--score-base) cannot be "
+                               "used together with --score con_std\n");
+    }
+    if (!m_target.dosage_cache.empty() && m_target.type != "bgen")
+    {
+        m_target.dosage_cache.clear();
+        m_parameter_log.erase("dosage-cache");
+        m_error_message.append("Warning: Dosage cache is only used for bgen "
+                               "target. Will not generate dosage cache\n");
+    }
     if (m_prs_info.no_regress && m_pheno_info.pheno_col.size() > 1)
     {
         m_error_message.append(
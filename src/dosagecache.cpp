@@ -0,0 +1,253 @@
+// This file is part of PRSice-2, copyright (C) 2016-2019
+// Shing Wan Choi, Paul F. O’Reilly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "dosagecache.hpp"
+#include "plink_common.hpp"
+#include <algorithm>
+#include <cstring>
+#include <sys/stat.h>
+
+DosageCache::Source DosageCache::source_info(const std::string& file)
+{
+    struct stat st;
+    if (stat(file.c_str(), &st) != 0)
+    { throw std::runtime_error("Error: Cannot access file: " + file); }
+    Source source;
+    source.name = file;
+    source.size = static_cast<uint64_t>(st.st_size);
+    source.mtime = static_cast<int64_t>(st.st_mtime);
+    return source;
+}
+
+uint64_t DosageCache::sample_hash(const std::vector<uintptr_t>& sample_include,
+                                  const uintptr_t unfiltered_sample_ct)
+{
+    // FNV-1a over the number of samples and the inclusion bits
+    uint64_t hash = 14695981039346656037ULL;
+    auto add = [&hash](const void* data, size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash ^= bytes[i];
+            hash *= 1099511628211ULL;
+        }
+    };
+    const uint64_t sample_ct = unfiltered_sample_ct;
+    add(&sample_ct, sizeof(uint64_t));
+    add(sample_include.data(), sample_include.size() * sizeof(uintptr_t));
+    return hash;
+}
+
+void DosageCache::create(const std::string& file,
+                         const std::vector<Source>& sources,
+                         const std::vector<uintptr_t>& sample_include,
+                         const uintptr_t unfiltered_sample_ct,
+                         const uintptr_t sample_ct)
+{
+    m_file_name = file;
+    m_out.open(file.c_str(), std::ios::binary | std::ios::trunc);
+    if (!m_out.is_open())
+    {
+        throw std::runtime_error("Error: Cannot open dosage cache to write: "
+                                 + file);
+    }
+    m_sample_include = sample_include;
+    m_num_sample = sample_ct;
+    m_sample_hash = sample_hash(sample_include, unfiltered_sample_ct);
+    m_num_source = sources.size();
+    m_num_variant = 0;
+    // a table offset of 0 marks an incomplete cache until close is called
+    m_table_offset = 0;
+    m_write_entries.clear();
+    write_header();
+    for (auto&& source : sources)
+    {
+        const uint32_t name_length = static_cast<uint32_t>(source.name.size());
+        m_out.write(reinterpret_cast<const char*>(&source.size),
+                    sizeof(uint64_t));
+        m_out.write(reinterpret_cast<const char*>(&source.mtime),
+                    sizeof(int64_t));
+        m_out.write(reinterpret_cast<const char*>(&name_length),
+                    sizeof(uint32_t));
+        m_out.write(source.name.data(), name_length);
+    }
+}
+
+void DosageCache::write_header()
+{
+    m_out.write(DOSAGE_CACHE_MAGIC, DOSAGE_CACHE_MAGIC_SIZE);
+    m_out.write(reinterpret_cast<const char*>(&m_num_sample), sizeof(uint64_t));
+    m_out.write(reinterpret_cast<const char*>(&m_sample_hash),
+                sizeof(uint64_t));
+    m_out.write(reinterpret_cast<const char*>(&m_num_source), sizeof(uint64_t));
+    m_out.write(reinterpret_cast<const char*>(&m_num_variant),
+                sizeof(uint64_t));
+    m_out.write(reinterpret_cast<const char*>(&m_table_offset),
+                sizeof(uint64_t));
+}
+
+bool DosageCache::add_variant(const size_t file_idx, const uint64_t byte_pos,
+                              const genfile::bgen::Context& context,
+                              const std::vector<genfile::byte_t>& data)
+{
+    if ((context.flags & genfile::bgen::e_Layout) != genfile::bgen::e_Layout2)
+        return false;
+    genfile::bgen::v12::GenotypeDataBlock pack(context, data.data(),
+                                               data.data() + data.size());
+    if (pack.numberOfAlleles != 2 || pack.phased || pack.ploidyExtent[0] != 2
+        || pack.ploidyExtent[1] != 2 || (pack.bits != 8 && pack.bits != 16))
+        return false;
+    const size_t width = 2 * static_cast<size_t>(pack.bits / 8);
+    if (pack.end < pack.buffer + pack.numberOfSamples * width)
+    {
+        throw std::runtime_error("Error: Invalid genotype block in "
+                                 "BGEN file");
+    }
+    std::vector<genfile::byte_t> record(m_num_sample * width);
+    genfile::byte_t* out = record.data();
+    for (uint32_t i = 0; i < pack.numberOfSamples; ++i)
+    {
+        if (!IS_SET(m_sample_include.data(), i)) continue;
+        if (pack.ploidy[i] & 0x80)
+        { std::memset(out, 0xFF, width); }
+        else
+        {
+            std::memcpy(out, pack.buffer + width * i, width);
+        }
+        out += width;
+    }
+    Entry entry = {static_cast<uint32_t>(file_idx),
+                   static_cast<uint32_t>(pack.bits), byte_pos,
+                   static_cast<uint64_t>(m_out.tellp())};
+    m_out.write(reinterpret_cast<const char*>(record.data()),
+                static_cast<std::streamsize>(record.size()));
+    m_write_entries.push_back(entry);
+    ++m_num_variant;
+    return true;
+}
+
+void DosageCache::close()
+{
+    // the variant table is read in place, so it must be aligned
+    uint64_t table_offset = static_cast<uint64_t>(m_out.tellp());
+    const char padding[sizeof(uint64_t)] = {0};
+    const uint64_t padding_size =
+        (sizeof(uint64_t) - table_offset % sizeof(uint64_t))
+        % sizeof(uint64_t);
+    m_out.write(padding, static_cast<std::streamsize>(padding_size));
+    m_table_offset = table_offset + padding_size;
+    m_out.write(reinterpret_cast<const char*>(m_write_entries.data()),
+                static_cast<std::streamsize>(m_write_entries.size()
+                                             * sizeof(Entry)));
+    m_out.seekp(0);
+    write_header();
+    if (!m_out.good())
+    {
+        throw std::runtime_error("Error: Failed to write dosage cache: "
+                                 + m_file_name);
+    }
+    m_out.close();
+    m_write_entries.clear();
+}
+
+bool DosageCache::load(const std::string& file,
+                       const std::vector<Source>& sources,
+                       const std::vector<uintptr_t>& sample_include,
+                       const uintptr_t unfiltered_sample_ct,
+                       const uintptr_t sample_ct)
+{
+    m_file_name = file;
+    m_entries = nullptr;
+    if (m_memory_map.is_mapped()) m_memory_map.unmap();
+    std::error_code error;
+    m_memory_map.map(file, error);
+    if (error) return false;
+    // unmap invalid cache, as it will be overwritten
+    auto invalid = [this]() {
+        m_memory_map.unmap();
+        return false;
+    };
+    const char* data = m_memory_map.data();
+    const size_t file_size = m_memory_map.size();
+    if (file_size < DOSAGE_CACHE_HEADER_SIZE
+        || std::memcmp(data, DOSAGE_CACHE_MAGIC, DOSAGE_CACHE_MAGIC_SIZE) != 0)
+        return invalid();
+    size_t pos = DOSAGE_CACHE_MAGIC_SIZE;
+    auto read_field = [&](void* target, size_t size) {
+        if (pos + size > file_size) return false;
+        std::memcpy(target, &(data[pos]), size);
+        pos += size;
+        return true;
+    };
+    read_field(&m_num_sample, sizeof(uint64_t));
+    read_field(&m_sample_hash, sizeof(uint64_t));
+    read_field(&m_num_source, sizeof(uint64_t));
+    read_field(&m_num_variant, sizeof(uint64_t));
+    read_field(&m_table_offset, sizeof(uint64_t));
+    if (m_num_sample != sample_ct
+        || m_sample_hash != sample_hash(sample_include, unfiltered_sample_ct)
+        || m_num_source != sources.size() || m_table_offset == 0
+        || m_table_offset % sizeof(uint64_t) != 0
+        || m_table_offset > file_size
+        || m_num_variant > (file_size - m_table_offset) / sizeof(Entry))
+        return invalid();
+    Source source;
+    uint32_t name_length;
+    for (auto&& expected : sources)
+    {
+        if (!read_field(&source.size, sizeof(uint64_t))
+            || !read_field(&source.mtime, sizeof(int64_t))
+            || !read_field(&name_length, sizeof(uint32_t))
+            || pos + name_length > file_size)
+            return invalid();
+        source.name.assign(&(data[pos]), name_length);
+        pos += name_length;
+        if (source.name != expected.name || source.size != expected.size
+            || source.mtime != expected.mtime)
+            return invalid();
+    }
+    const Entry* entries =
+        reinterpret_cast<const Entry*>(&(data[m_table_offset]));
+    for (size_t i = 0; i < m_num_variant; ++i)
+    {
+        const Entry& entry = entries[i];
+        if ((entry.bits != 8 && entry.bits != 16)
+            || entry.offset + m_num_sample * entry.bits / 4 > m_table_offset
+            || (i != 0
+                && (entries[i - 1].file_idx > entry.file_idx
+                    || (entries[i - 1].file_idx == entry.file_idx
+                        && entries[i - 1].byte_pos >= entry.byte_pos))))
+            return invalid();
+    }
+    m_entries = entries;
+    return true;
+}
+
+const DosageCache::Entry* DosageCache::find(const size_t file_idx,
+                                            const uint64_t byte_pos) const
+{
+    if (m_entries == nullptr) return nullptr;
+    const Entry* end = m_entries + m_num_variant;
+    const Entry* res = std::lower_bound(
+        m_entries, end, std::make_pair(file_idx, byte_pos),
+        [](const Entry& e, const std::pair<size_t, uint64_t>& key) {
+            return e.file_idx < key.first
+                   || (e.file_idx == key.first && e.byte_pos < key.second);
+        });
+    if (res == end || res->file_idx != file_idx || res->byte_pos != byte_pos)
+        return nullptr;
+    return res;
+}
@@ -36,8 +36,8 @@ std::string Genotype::print_duplicated_snps(
         // we only output the valid SNPs.
         if (duplicated_snp.find(snp.rs()) == duplicated_snp.end())
             log_file_stream << snp.rs() << "\t" << snp.chr() << "\t"
-                            << snp.loc() << "\t" << snp.ref() << "\t"
-                            << snp.alt() << "\n";
+                            << snp.loc() << "\t" << snp.ref(m_allele_table)
+                            << "\t" << snp.alt(m_allele_table) << "\n";
     }
     log_file_stream.close();
     return std::string(
@@ -196,19 +196,17 @@ void Genotype::read_base(
     const BaseFile& base_file, const QCFiltering& base_qc,
     const PThresholding& threshold_info,
     const std::vector<IITree<size_t, size_t>>& exclusion_regions,
-    const bool keep_ambig)
+    const bool keep_ambig, const size_t base_idx)
 {
-    const unsigned long long max_index =
-        base_file.column_index[+BASE_INDEX::MAX];
     const double max_threshold =
         threshold_info.no_full
             ? (threshold_info.fastscore ? threshold_info.bar_levels.back()
                                         : threshold_info.upper)
             : 1.0;
-    std::vector<std::string> token;
     std::string line;
     GZSTREAM_NAMESPACE::igzstream gz_snp_file;
     std::ifstream snp_file;
+    mio::mmap_source snp_map;
     std::string message = "Base file: " + base_file.file_name + "\n";
     // Some QC counts
     std::string rs_id;
@@ -231,11 +229,16 @@ void Genotype::read_base(
     size_t num_info_filter = 0;
     size_t num_chr_filter = 0;
     size_t num_maf_filter = 0;
-    int32_t chr_code;
-    std::streampos file_length = 0;
+    size_t num_mismatch = 0;
+    size_t num_included = 0;
+    size_t file_length = 0;
+    size_t file_offset = 0;
     unsigned long long category = 0;
     bool to_remove = false;
     bool gz_input = false;
+    // duplicates of the score bases are detected separately, as their SNPs
+    // are expected to be found in the previous base files
+    StringIndex score_base_ids;
     try
     {
         gz_input = misc::is_gz_file(base_file.file_name);
@@ -276,145 +279,195 @@ void Genotype::read_base(
                                      + base_file.file_name);
         }
         snp_file.seekg(0, snp_file.end);
-        file_length = snp_file.tellg();
-        snp_file.clear();
-        snp_file.seekg(0, snp_file.beg);
+        file_length = static_cast<size_t>(snp_file.tellg());
+        snp_file.close();
+        // parse the file directly from the memory map to avoid copying it
+        if (file_length != 0)
+        {
+            std::error_code error;
+            snp_map.map(base_file.file_name, error);
+            if (error)
+            {
+                throw std::runtime_error("Error: Failed to map base file: "
+                                         + base_file.file_name);
+            }
+        }
         // if the input is index, we will keep the header, otherwise, we
         // will remove the header
-        if (!base_file.is_index) std::getline(snp_file, line);
-    }
-    double prev_progress = 0.0;
-    std::unordered_set<std::string> dup_index;
-    while ((gz_input && std::getline(gz_snp_file, line))
-           || (!gz_input && std::getline(snp_file, line)))
-    {
+        if (!base_file.is_index && file_length != 0)
+        {
+            const char* header_end = static_cast<const char*>(
+                memchr(snp_map.data(), '\n', file_length));
+            file_offset = (header_end == nullptr)
+                              ? file_length
+                              : static_cast<size_t>(header_end - snp_map.data())
+                                    + 1;
+        }
+    }
+    // The gz file is decompressed into this buffer. gz_used is the number of
+    // valid bytes and gz_consumed is the number of bytes handed out in the
+    // previous block. Any incomplete line is kept for the next block
+    std::vector<char> gz_buffer;
+    size_t gz_used = 0, gz_consumed = 0;
+    bool gz_eof = false;
+    // obtain the next block of complete lines
+    auto next_block = [&](const char*& begin, const char*& end) {
         if (!gz_input)
         {
-            double progress = static_cast<double>(snp_file.tellg())
-                              / static_cast<double>(file_length) * 100;
-            if (progress - prev_progress > 0.01)
+            if (file_offset >= file_length) return false;
+            begin = &(snp_map.data()[file_offset]);
+            size_t block_size =
+                std::min<size_t>(BASE_CHUNK_BYTES, file_length - file_offset);
+            if (file_offset + block_size != file_length)
             {
-                fprintf(stderr, "\rReading %03.2f%%", progress);
-                prev_progress = progress;
+                // extend the block to the end of its last line
+                const char* line_end = static_cast<const char*>(
+                    memchr(&(begin[block_size]), '\n',
+                           file_length - file_offset - block_size));
+                block_size = (line_end == nullptr)
+                                 ? file_length - file_offset
+                                 : static_cast<size_t>(line_end - begin) + 1;
             }
-        }
-        misc::trim(line);
-        if (line.empty()) continue;
-        ++num_line_in_base;
-        token = misc::split(line);
-        if (token.size() <= max_index)
+            end = &(begin[block_size]);
+            file_offset += block_size;
+            return true;
+        }
+        std::copy(gz_buffer.begin() + static_cast<long>(gz_consumed),
+                  gz_buffer.begin() + static_cast<long>(gz_used),
+                  gz_buffer.begin());
+        gz_used -= gz_consumed;
+        gz_consumed = 0;
+        while (true)
+        {
+            size_t last_line = gz_used;
+            while (last_line != 0 && gz_buffer[last_line - 1] != '\n')
+            { --last_line; }
+            if (last_line != 0 || gz_eof)
+            {
+                gz_consumed = (last_line != 0) ? last_line : gz_used;
+                break;
+            }
+            gz_buffer.resize(gz_used + BASE_CHUNK_BYTES);
+            gz_snp_file.read(&(gz_buffer[gz_used]), BASE_CHUNK_BYTES);
+            const size_t num_read =
+                static_cast<size_t>(gz_snp_file.gcount());
+            gz_used += num_read;
+            if (num_read < BASE_CHUNK_BYTES) gz_eof = true;
+        }
+        begin = gz_buffer.data();
+        end = &(gz_buffer.data()[gz_consumed]);
+        return gz_consumed != 0;
+    };
+    std::vector<BaseLine> lines;
+    const char* block_begin = nullptr;
+    const char* block_end = nullptr;
+    while (next_block(block_begin, block_end))
+    {
+        parse_base_block(block_begin, block_end, base_file, lines);
+        if (!gz_input)
         {
-            std::string error_message = line;
-            error_message.append("\nMore index than column in data\n");
-            throw std::runtime_error(error_message);
+            fprintf(stderr, "\rReading %03.2f%%",
+                    static_cast<double>(file_offset)
+                        / static_cast<double>(file_length) * 100);
         }
-        rs_id = token[base_file.column_index[+BASE_INDEX::RS]];
-        if (dup_index.find(rs_id) != dup_index.end())
+        for (auto&& base_line : lines)
         {
-            ++num_duplicated;
-            continue;
-        }
+            ++num_line_in_base;
+            if (!base_line.enough_column)
+            {
+                std::string error_message(base_line.line, base_line.length);
+                error_message.append("\nMore index than column in data\n");
+                throw std::runtime_error(error_message);
+            }
+            rs_id = base_line.get(BASE_INDEX::RS);
+            if ((base_idx == 0 && m_existed_snps_index.contains(rs_id))
+                || (base_idx != 0 && !score_base_ids.insert(rs_id, 0)))
+            {
+                ++num_duplicated;
+                continue;
+            }
 
-        auto&& selection = m_snp_selection_list.find(rs_id);
-        if ((!m_exclude_snp && selection == m_snp_selection_list.end())
-            || (m_exclude_snp && selection != m_snp_selection_list.end()))
-        {
-            ++num_selected;
-            continue;
-        }
-        dup_index.insert(rs_id);
-        chr_code = -1;
-        chr = ~size_t(0);
-        if (base_file.has_column[+BASE_INDEX::CHR])
-        {
-            chr = get_chr_code(
-                token[base_file.column_index[+BASE_INDEX::CHR]].c_str(),
-                num_chr_filter, num_haploid);
-            if (chr == ~size_t(0)) continue;
-        }
-        ref_allele = (base_file.has_column[+BASE_INDEX::EFFECT])
-                         ? token[base_file.column_index[+BASE_INDEX::EFFECT]]
-                         : "";
-        alt_allele = (base_file.has_column[+BASE_INDEX::NONEFFECT])
-                         ? token[base_file.column_index[+BASE_INDEX::NONEFFECT]]
-                         : "";
-        std::transform(ref_allele.begin(), ref_allele.end(), ref_allele.begin(),
-                       ::toupper);
-        std::transform(alt_allele.begin(), alt_allele.end(), alt_allele.begin(),
-                       ::toupper);
-        loc = ~size_t(0);
-        if (base_file.has_column[+BASE_INDEX::BP])
-        {
+            auto&& selection = m_snp_selection_list.find(rs_id);
+            if ((!m_exclude_snp && selection == m_snp_selection_list.end())
+                || (m_exclude_snp && selection != m_snp_selection_list.end()))
+            {
+                ++num_selected;
+                continue;
+            }
+            // record the ID for duplicate detection. The index will only be
+            // assigned if the SNP passes all the filters
+            if (base_idx == 0) m_existed_snps_index.insert(rs_id, ~size_t(0));
+            chr = ~size_t(0);
+            if (base_file.has_column[+BASE_INDEX::CHR])
+            {
+                chr = get_chr_code(base_line.get(BASE_INDEX::CHR),
+                                   num_chr_filter, num_haploid);
+                if (chr == ~size_t(0)) continue;
+            }
+            ref_allele = (base_file.has_column[+BASE_INDEX::EFFECT])
+                             ? base_line.get(BASE_INDEX::EFFECT)
+                             : "";
+            alt_allele = (base_file.has_column[+BASE_INDEX::NONEFFECT])
+                             ? base_line.get(BASE_INDEX::NONEFFECT)
+                             : "";
+            std::transform(ref_allele.begin(), ref_allele.end(),
+                           ref_allele.begin(), ::toupper);
+            std::transform(alt_allele.begin(), alt_allele.end(),
+                           alt_allele.begin(), ::toupper);
             // obtain the SNP coordinate
-            try
+            loc = base_line.loc;
+            if (!base_line.valid_loc)
             {
-                loc = misc::string_to_size_t(
-                    token[base_file.column_index[+BASE_INDEX::BP]].c_str());
+                throw std::runtime_error("Error: Invalid loci for " + rs_id
+                                         + ": " + base_line.get(BASE_INDEX::BP)
+                                         + "\n");
             }
-            catch (...)
+            to_remove = false;
+            if (base_file.has_column[+BASE_INDEX::BP]
+                && base_file.has_column[+BASE_INDEX::CHR])
+                to_remove =
+                    Genotype::within_region(exclusion_regions, chr, loc);
+            if (to_remove)
             {
-                throw std::runtime_error(
-                    "Error: Invalid loci for " + rs_id + ": "
-                    + token[base_file.column_index[+BASE_INDEX::BP]] + "\n");
+                ++num_region_exclude;
+                continue;
             }
-        }
-        to_remove = false;
-        if (base_file.has_column[+BASE_INDEX::BP]
-            && base_file.has_column[+BASE_INDEX::CHR])
-            to_remove = Genotype::within_region(exclusion_regions, chr, loc);
-        if (to_remove)
-        {
-            ++num_region_exclude;
-            continue;
-        }
-
-        if (base_file.has_column[+BASE_INDEX::MAF])
-        {
-            base_filter_by_value(
-                token[base_file.column_index[+BASE_INDEX::MAF]], base_qc.maf,
-                num_maf_filter);
-        }
-        if (base_file.has_column[+BASE_INDEX::MAF_CASE])
-        {
-            base_filter_by_value(
-                token[base_file.column_index[+BASE_INDEX::MAF_CASE]],
-                base_qc.maf, num_maf_filter);
-        }
-        if (base_file.has_column[+BASE_INDEX::INFO])
-        {
-            base_filter_by_value(
-                token[base_file.column_index[+BASE_INDEX::INFO]], base_qc.maf,
-                num_info_filter);
-        }
-        pvalue = 2.0;
-        try
-        {
-            pvalue = misc::convert<double>(
-                token[base_file.column_index[+BASE_INDEX::P]]);
-            if (pvalue < 0.0 || pvalue > 1.0)
+            if (base_file.has_column[+BASE_INDEX::MAF])
             {
-                std::string error_message =
-                    "Error: Invalid p-value for " + rs_id + ": "
-                    + token[base_file.column_index[+BASE_INDEX::P]] + "!\n";
-                throw std::runtime_error(error_message);
+                base_filter_by_value(base_line.begin(BASE_INDEX::MAF),
+                                     base_line.end(BASE_INDEX::MAF),
+                                     base_qc.maf, num_maf_filter);
+            }
+            if (base_file.has_column[+BASE_INDEX::MAF_CASE])
+            {
+                base_filter_by_value(base_line.begin(BASE_INDEX::MAF_CASE),
+                                     base_line.end(BASE_INDEX::MAF_CASE),
+                                     base_qc.maf, num_maf_filter);
+            }
+            if (base_file.has_column[+BASE_INDEX::INFO])
+            {
+                base_filter_by_value(base_line.begin(BASE_INDEX::INFO),
+                                     base_line.end(BASE_INDEX::INFO),
+                                     base_qc.maf, num_info_filter);
+            }
+            pvalue = base_line.pvalue;
+            if (!base_line.valid_pvalue || pvalue < 0.0 || pvalue > 1.0)
+            {
+                ++num_not_converted;
+                continue;
             }
             else if (pvalue > max_threshold)
             {
                 ++num_excluded;
                 continue;
             }
-        }
-        catch (...)
-        {
-            ++num_not_converted;
-            continue;
-        }
-        stat = 0.0;
-        try
-        {
-            stat = misc::convert<double>(
-                token[base_file.column_index[+BASE_INDEX::STAT]]);
-            if (stat < 0 && base_file.is_or)
+            stat = base_line.stat;
+            if (!base_line.valid_stat)
+            {
+                ++num_not_converted;
+                continue;
+            }
+            else if (stat < 0 && base_file.is_or)
             {
                 ++num_negative_stat;
                 continue;
@@ -426,45 +479,55 @@ void Genotype::read_base(
             }
             else if (base_file.is_or)
                 stat = log(stat);
-        }
-        catch (...)
-        {
-            ++num_not_converted;
-            continue;
-        }
-        if (!alt_allele.empty() && ambiguous(ref_allele, alt_allele))
-        {
-            ++num_ambiguous;
-            if (!keep_ambig) continue;
-        }
-        category = 0;
-        pthres = 0.0;
-        if (threshold_info.fastscore)
-        {
-            category =
-                calculate_category(pvalue, threshold_info.bar_levels, pthres);
-        }
-        else
-        {
-            try
+            if (!alt_allele.empty() && ambiguous(ref_allele, alt_allele))
             {
-                category = calculate_category(pvalue, pthres, threshold_info);
+                ++num_ambiguous;
+                if (!keep_ambig) continue;
             }
-            catch (const std::runtime_error&)
+            category = 0;
+            pthres = 0.0;
+            if (threshold_info.fastscore)
             {
-                m_very_small_thresholds = true;
-                category = 0;
+                category = calculate_category(pvalue, threshold_info.bar_levels,
+                                              pthres);
             }
-        }
-        m_existed_snps_index[rs_id] = m_existed_snps.size();
-        m_existed_snps.emplace_back(SNP(rs_id, chr, loc, ref_allele, alt_allele,
-                                        stat, pvalue, category, pthres));
-    }
-    if (gz_input)
-        gz_snp_file.close();
-    else
-        snp_file.close();
-
+            else
+            {
+                try
+                {
+                    category =
+                        calculate_category(pvalue, pthres, threshold_info);
+                }
+                catch (const std::runtime_error&)
+                {
+                    m_very_small_thresholds = true;
+                    category = 0;
+                }
+            }
+            if (base_idx != 0)
+            {
+                if (add_base_stat(base_idx, rs_id, chr, loc, ref_allele,
+                                  alt_allele, stat, pvalue, category, pthres))
+                { ++num_included; }
+                else
+                {
+                    ++num_mismatch;
+                }
+                continue;
+            }
+            m_existed_snps_index.assign(rs_id, m_existed_snps.size());
+            m_existed_snps.emplace_back(SNP(rs_id, chr, loc, ref_allele,
+                                            alt_allele, stat, pvalue, category,
+                                            pthres, m_id_arena,
+                                            m_allele_table));
+            ++num_included;
+        }
+    }
+    if (gz_input) gz_snp_file.close();
+    // drop the IDs of the filtered SNPs, which were only kept for the
+    // duplicate detection
+    if (base_idx == 0 && m_existed_snps_index.size() != m_existed_snps.size())
+    { update_snp_index(); }
     fprintf(stderr, "\rReading %03.2f%%\n", 100.0);
     message.append(std::to_string(num_line_in_base)
                    + " variant(s) observed in base file, with:\n");
@@ -530,13 +593,142 @@ void Genotype::read_base(
         if (!keep_ambig) { message.append(" excluded"); }
         message.append("\n");
     }
-    message.append(std::to_string(m_existed_snps.size())
+    if (num_mismatch)
+    {
+        message.append(std::to_string(num_mismatch)
+                       + " variant(s) with alleles or coordinates mismatched "
+                         "with the previous base file(s)\n");
+    }
+    message.append(std::to_string(num_included)
                    + " total variant(s) included from base file\n\n");
     m_reporter->report(message);
-    if (m_existed_snps.size() == 0)
+    if (num_included == 0)
     { throw std::runtime_error("Error: No valid variant remaining"); }
 }
 
+void Genotype::init_score_matrix(const size_t num_base)
+{
+    m_num_base = num_base;
+    m_base_stat.assign(
+        m_existed_snps.size() * m_num_base,
+        ScoreBaseStat {std::numeric_limits<double>::quiet_NaN(), false});
+    for (size_t i = 0; i < m_existed_snps.size(); ++i)
+    { m_base_stat[i * m_num_base].stat = m_existed_snps[i].stat(); }
+}
+
+bool Genotype::add_base_stat(const size_t base_idx, const std::string& rs_id,
+                             const size_t chr, const size_t loc,
+                             std::string& ref_allele, std::string& alt_allele,
+                             const double stat, const double pvalue,
+                             const unsigned long long category,
+                             const double pthres)
+{
+    assert(base_idx < m_num_base);
+    size_t idx = m_existed_snps_index.find(rs_id);
+    if (idx == ~size_t(0))
+    {
+        // SNPs not found in the previous base files are added so that the
+        // target is scored against the union of all base files
+        idx = m_existed_snps.size();
+        m_existed_snps_index.insert(rs_id, idx);
+        m_existed_snps.emplace_back(SNP(rs_id, chr, loc, ref_allele,
+                                        alt_allele, stat, pvalue, category,
+                                        pthres, m_id_arena, m_allele_table));
+        m_base_stat.resize(
+            m_existed_snps.size() * m_num_base,
+            ScoreBaseStat {std::numeric_limits<double>::quiet_NaN(), false});
+    }
+    // the effect allele can be the non-effect allele of the stored SNP, in
+    // which case the genotype is flipped when scoring this base file
+    bool flipped = false;
+    if (!m_existed_snps[idx].matching(chr, loc, ref_allele, alt_allele,
+                                     flipped, m_allele_table))
+    { return false; }
+    m_base_stat[idx * m_num_base + base_idx] = ScoreBaseStat {stat, flipped};
+    return true;
+}
+
+
+void Genotype::parse_base_block(const char* begin, const char* end,
+                                const BaseFile& base_file,
+                                std::vector<BaseLine>& lines)
+{
+    lines.clear();
+    // locate all the non-empty lines, ignoring white spaces on both end of
+    // the line as in misc::trim
+    const char* cur = begin;
+    while (cur < end)
+    {
+        const char* line_end = static_cast<const char*>(
+            memchr(cur, '\n', static_cast<size_t>(end - cur)));
+        if (line_end == nullptr) line_end = end;
+        const char* last = line_end;
+        misc::trim(cur, last);
+        if (cur != last)
+        {
+            lines.emplace_back();
+            lines.back().line = cur;
+            lines.back().length = static_cast<size_t>(last - cur);
+        }
+        cur = (line_end == end) ? end : line_end + 1;
+    }
+    const size_t max_index = base_file.column_index[+BASE_INDEX::MAX];
+    auto parse_lines = [&](const size_t start, const size_t finish) {
+        std::vector<std::pair<const char*, const char*>> token;
+        for (size_t i = start; i < finish; ++i)
+        {
+            auto&& base_line = lines[i];
+            // stop once we have all the columns we need
+            misc::split(token, base_line.line,
+                        &(base_line.line[base_line.length]), max_index + 1);
+            base_line.enough_column = token.size() > max_index;
+            if (!base_line.enough_column) continue;
+            for (size_t col = 0; col < +BASE_INDEX::MAX; ++col)
+            {
+                auto&& cur_token = token[std::min<size_t>(
+                    base_file.column_index[col], max_index)];
+                base_line.field[col] = cur_token.first;
+                base_line.field_length[col] =
+                    static_cast<size_t>(cur_token.second - cur_token.first);
+            }
+            base_line.valid_pvalue = misc::convert_double(
+                base_line.begin(BASE_INDEX::P), base_line.end(BASE_INDEX::P),
+                base_line.pvalue);
+            base_line.valid_stat = misc::convert_double(
+                base_line.begin(BASE_INDEX::STAT),
+                base_line.end(BASE_INDEX::STAT), base_line.stat);
+            base_line.loc = ~size_t(0);
+            base_line.valid_loc = true;
+            if (base_file.has_column[+BASE_INDEX::BP])
+            {
+                try
+                {
+                    base_line.loc =
+                        misc::string_to_size_t(base_line.begin(BASE_INDEX::BP),
+                                               base_line.end(BASE_INDEX::BP));
+                }
+                catch (...)
+                {
+                    base_line.valid_loc = false;
+                }
+            }
+        }
+    };
+    const size_t num_line = lines.size();
+    const size_t num_thread = std::max<size_t>(
+        1, std::min<size_t>(
+               static_cast<size_t>(std::max(1, m_prs_calculation.thread)),
+               num_line / MIN_BASE_THREAD_LINE));
+    std::vector<std::thread> workers;
+    for (size_t i_thread = 1; i_thread < num_thread; ++i_thread)
+    {
+        workers.push_back(std::thread(parse_lines,
+                                      num_line * i_thread / num_thread,
+                                      num_line * (i_thread + 1) / num_thread));
+    }
+    parse_lines(0, num_line / num_thread);
+    for (auto&& thread : workers) { thread.join(); }
+}
 
 std::vector<std::string>
 Genotype::load_genotype_prefix(const std::string& file_name)
@@ -876,8 +1068,9 @@ void Genotype::print_mismatch(const std::string& out, const std::string& type,
     {
         m_mismatch_snp_record << target.loc() << "\t";
     }
-    m_mismatch_snp_record << a1 << "\t" << target.ref() << "\t" << a2 << "\t"
-                          << target.alt() << std::endl;
+    m_mismatch_snp_record << a1 << "\t" << target.ref(m_allele_table) << "\t"
+                          << a2 << "\t" << target.alt(m_allele_table)
+                          << std::endl;
 }
 void Genotype::load_snps(
     const std::string& out,
@@ -923,7 +1116,9 @@ void Genotype::load_snps(
 
 
 Genotype::~Genotype() {}
-intptr_t Genotype::cal_avail_memory(const uintptr_t founder_ctv2)
+intptr_t Genotype::cal_avail_memory(const uintptr_t founder_ctv2,
+                                    const size_t max_cache_snp,
+                                    size_t& num_thread)
 {
 #ifdef __APPLE__
     int32_t mib[2];
@@ -972,22 +1167,35 @@ intptr_t Genotype::cal_avail_memory(const uintptr_t founder_ctv2)
     // m_max_window_size represent the maximum number of SNPs required for any
     // one window
 
-    // calculate the maximum amount of memory required (the thing is, we can't
-    // do the analysis if we don't have this amount as the largest region will
-    // fail. So should I call this maximum amount of memory required or minimum
-    // amount of memory required?
-    malloc_size_mb = (static_cast<uintptr_t>(m_max_window_size) + 1)
-                         * founder_ctv2 * sizeof(intptr_t) / 1048576
-                     + 1;
+    // calculate the minimum amount of memory required for each thread (the
+    // thing is, we can't do the analysis if we don't have this amount as the
+    // largest region will fail).
+    const uintptr_t snp_byte = founder_ctv2 * sizeof(intptr_t);
+    const uintptr_t min_thread_byte =
+        (static_cast<uintptr_t>(m_max_window_size) + 1) * snp_byte;
+    // anything beyond the minimum is used to cache the genotypes, bounded by
+    // --memory and by the number of SNPs that can ever be cached
+    uintptr_t allowed_byte = std::min<uintptr_t>(
+        static_cast<uintptr_t>(default_alloc_mb) * 1048576, g_allowed_memory);
+    num_thread = std::max<size_t>(
+        1, std::min<size_t>(num_thread, allowed_byte / min_thread_byte));
+    const uintptr_t thread_byte = std::max<uintptr_t>(
+        min_thread_byte,
+        std::min<uintptr_t>(allowed_byte / num_thread,
+                            (static_cast<uintptr_t>(max_cache_snp) + 1)
+                                * snp_byte));
+    malloc_size_mb = static_cast<intptr_t>(thread_byte * num_thread / 1048576
+                                           + 1);
     std::string message = "";
     if (llxx)
     {
         // we have detected the memory, but need to check if that's enough
-        if (malloc_size_mb > llxx)
+        if (static_cast<intptr_t>(min_thread_byte / 1048576 + 1) > llxx)
         {
             throw std::runtime_error(
                 "Error: Insufficient memory for clumping! Require "
-                + misc::to_string(malloc_size_mb) + " MB but detected only "
+                + misc::to_string(min_thread_byte / 1048576 + 1)
+                + " MB but detected only "
                 + misc::to_string(llxx) + " MB");
         }
         else
@@ -1005,63 +1213,335 @@ intptr_t Genotype::cal_avail_memory(const uintptr_t founder_ctv2)
     return malloc_size_mb;
 }
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define DECODE_PRS_AVX2
+// each byte of the genotype word contains the code of four samples
+template <bool add_score>
+__attribute__((target("avx2"))) static void
+decode_prs_avx2(const uintptr_t* genotype, const size_t num_word,
+                const double prs_lut[4], const uint32_t count_lut[4],
+                double* prs, uint32_t* num_snp)
+{
+    const __m256 prs_table = _mm256_castpd_ps(_mm256_loadu_pd(prs_lut));
+    const __m128 count_table = _mm_castsi128_ps(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(count_lut)));
+    const __m128i shift = _mm_setr_epi32(0, 2, 4, 6);
+    const __m128i code_mask = _mm_set1_epi32(3);
+    const __m256i high_one = _mm256_set1_epi64x(int64_t(1) << 32);
+    for (size_t i_word = 0; i_word < num_word; ++i_word)
+    {
+        const uintptr_t ulii = ~genotype[i_word];
+        for (size_t i_byte = 0; i_byte < sizeof(uintptr_t);
+             ++i_byte, prs += 4, num_snp += 4)
+        {
+            const int byte = static_cast<int>((ulii >> (i_byte * 8)) & 0xff);
+            const __m128i code = _mm_and_si128(
+                _mm_srlv_epi32(_mm_set1_epi32(byte), shift), code_mask);
+            // the double at code is stored in the 32-bit lanes 2 * code and
+            // 2 * code + 1 of the table
+            __m256i idx = _mm256_slli_epi64(_mm256_cvtepu32_epi64(code), 1);
+            idx = _mm256_add_epi64(
+                _mm256_or_si256(idx, _mm256_slli_epi64(idx, 32)), high_one);
+            const __m256d score =
+                _mm256_castps_pd(_mm256_permutevar8x32_ps(prs_table, idx));
+            const __m128i count =
+                _mm_castps_si128(_mm_permutevar_ps(count_table, code));
+            __m128i* num_snp_ptr = reinterpret_cast<__m128i*>(num_snp);
+            if (add_score)
+            {
+                _mm256_storeu_pd(prs,
+                                 _mm256_add_pd(_mm256_loadu_pd(prs), score));
+                _mm_storeu_si128(
+                    num_snp_ptr,
+                    _mm_add_epi32(_mm_loadu_si128(num_snp_ptr), count));
+            }
+            else
+            {
+                _mm256_storeu_pd(prs, score);
+                _mm_storeu_si128(num_snp_ptr, count);
+            }
+        }
+    }
+}
+#endif
+
+size_t Genotype::decode_prs_simd(const uintptr_t* genotype,
+                                 const size_t start_sample,
+                                 const size_t end_sample,
+                                 const double prs_lut[4],
+                                 const uint32_t count_lut[4],
+                                 const bool add_score)
+{
+#ifdef DECODE_PRS_AVX2
+    static const bool use_avx2 = __builtin_cpu_supports("avx2");
+    // only complete words are decoded, which never need the padding of the
+    // last word to be masked
+    const size_t num_word = (end_sample - start_sample) / BITCT2;
+    if (!use_avx2 || num_word == 0) return start_sample;
+    const uintptr_t* lbptr = genotype + start_sample / BITCT2;
+    if (add_score)
+    {
+        decode_prs_avx2<true>(lbptr, num_word, prs_lut, count_lut,
+                              &m_prs_score[start_sample],
+                              &m_prs_num_snp[start_sample]);
+    }
+    else
+    {
+        decode_prs_avx2<false>(lbptr, num_word, prs_lut, count_lut,
+                               &m_prs_score[start_sample],
+                               &m_prs_num_snp[start_sample]);
+    }
+    return start_sample + num_word * BITCT2;
+#else
+    return start_sample;
+#endif
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+// only use the fused kernel when the CPU has a popcnt instruction, otherwise
+// the SSE2 routine in genovec_3freq is faster. Even with popcnt, the scalar
+// fused kernel is only faster than three genovec_3freq passes for short
+// genotypes (around 1500 founders), the AVX2 kernel has no such limit
+#define FUSED_3X3_MAX_SCALAR_WORDS 48
+#define FUSED_3X3_TARGET __attribute__((target("popcnt")))
+#define FUSED_3X3_AVX2_TARGET __attribute__((target("avx2,popcnt")))
+#define FUSED_3X3_RUNTIME_CHECK
+#elif defined(__GNUC__)
+#define FUSED_3X3_MAX_SCALAR_WORDS 48
+#define FUSED_3X3_TARGET
+#endif
+
+#ifdef FUSED_3X3_TARGET
+// convert the popcounts of the fused kernels to the same output as
+// genovec_3freq
+static inline void fused_3x3_counts(const uint32_t acc[9], uint32_t* counts)
+{
+    for (size_t k = 0; k < 9; k += 3)
+    {
+        counts[k] = acc[k] - acc[k + 2];
+        counts[k + 1] = acc[k + 1] - acc[k + 2];
+        counts[k + 2] = acc[k + 2];
+    }
+}
+// all masked words only have the low bit of each 2-bit field set, therefore
+// the plain popcount equals to popcount2_long
+FUSED_3X3_TARGET static void
+fused_3x3freq(const uintptr_t* __restrict geno,
+              const uintptr_t* __restrict mask0,
+              const uintptr_t* __restrict mask1,
+              const uintptr_t* __restrict mask2, const uintptr_t founder_ctl2,
+              uint32_t* __restrict counts)
+{
+    uint32_t acc[9] = {0, 0, 0, 0, 0, 0, 0, 0, 0};
+    uintptr_t loader;
+    uintptr_t loader2;
+    uintptr_t loader3;
+    for (uintptr_t i = 0; i < founder_ctl2; ++i)
+    {
+        loader = geno[i];
+        loader2 = mask0[i];
+        loader3 = loader2 & (loader >> 1);
+        acc[0] += static_cast<uint32_t>(__builtin_popcountll(loader & loader2));
+        acc[1] += static_cast<uint32_t>(__builtin_popcountll(loader3));
+        acc[2] += static_cast<uint32_t>(__builtin_popcountll(loader & loader3));
+        loader2 = mask1[i];
+        loader3 = loader2 & (loader >> 1);
+        acc[3] += static_cast<uint32_t>(__builtin_popcountll(loader & loader2));
+        acc[4] += static_cast<uint32_t>(__builtin_popcountll(loader3));
+        acc[5] += static_cast<uint32_t>(__builtin_popcountll(loader & loader3));
+        loader2 = mask2[i];
+        loader3 = loader2 & (loader >> 1);
+        acc[6] += static_cast<uint32_t>(__builtin_popcountll(loader & loader2));
+        acc[7] += static_cast<uint32_t>(__builtin_popcountll(loader3));
+        acc[8] += static_cast<uint32_t>(__builtin_popcountll(loader & loader3));
+    }
+    fused_3x3_counts(acc, counts);
+}
+#endif
+
+#ifdef FUSED_3X3_AVX2_TARGET
+// popcount of each byte, by looking up each nibble with pshufb
+FUSED_3X3_AVX2_TARGET static inline __m256i
+popcount_epi8(const __m256i v, const __m256i nibble_lut,
+              const __m256i low_mask)
+{
+    const __m256i lo = _mm256_and_si256(v, low_mask);
+    const __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+    return _mm256_add_epi8(_mm256_shuffle_epi8(nibble_lut, lo),
+                           _mm256_shuffle_epi8(nibble_lut, hi));
+}
+
+// same as fused_3x3freq, but counts 256 bits of each mask at a time. The
+// per-byte counts are accumulated for up to 31 vectors (at most 8 per byte
+// each) before being summed into 64-bit lanes
+FUSED_3X3_AVX2_TARGET static void
+fused_3x3freq_avx2(const uintptr_t* __restrict geno,
+                   const uintptr_t* __restrict mask0,
+                   const uintptr_t* __restrict mask1,
+                   const uintptr_t* __restrict mask2,
+                   const uintptr_t founder_ctl2, uint32_t* __restrict counts)
+{
+    const size_t word_per_vec = sizeof(__m256i) / sizeof(uintptr_t);
+    const size_t num_vec = founder_ctl2 / word_per_vec;
+    const uintptr_t* masks[3] = {mask0, mask1, mask2};
+    const __m256i nibble_lut =
+        _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1,
+                         1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low_mask = _mm256_set1_epi8(0x0f);
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i acc[9];
+    __m256i byte_acc[9];
+    for (size_t k = 0; k < 9; ++k) acc[k] = zero;
+    size_t i_vec = 0;
+    while (i_vec < num_vec)
+    {
+        const size_t block_end = std::min<size_t>(num_vec, i_vec + 31);
+        for (size_t k = 0; k < 9; ++k) byte_acc[k] = zero;
+        for (; i_vec < block_end; ++i_vec)
+        {
+            const size_t offset = i_vec * word_per_vec;
+            const __m256i loader = _mm256_loadu_si256(
+                reinterpret_cast<const __m256i*>(geno + offset));
+            const __m256i loader_shift = _mm256_srli_epi64(loader, 1);
+            for (size_t k = 0; k < 3; ++k)
+            {
+                const __m256i loader2 = _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i*>(masks[k] + offset));
+                const __m256i loader3 = _mm256_and_si256(loader2, loader_shift);
+                byte_acc[3 * k] = _mm256_add_epi8(
+                    byte_acc[3 * k],
+                    popcount_epi8(_mm256_and_si256(loader, loader2),
+                                  nibble_lut, low_mask));
+                byte_acc[3 * k + 1] = _mm256_add_epi8(
+                    byte_acc[3 * k + 1],
+                    popcount_epi8(loader3, nibble_lut, low_mask));
+                byte_acc[3 * k + 2] = _mm256_add_epi8(
+                    byte_acc[3 * k + 2],
+                    popcount_epi8(_mm256_and_si256(loader, loader3),
+                                  nibble_lut, low_mask));
+            }
+        }
+        for (size_t k = 0; k < 9; ++k)
+        {
+            acc[k] =
+                _mm256_add_epi64(acc[k], _mm256_sad_epu8(byte_acc[k], zero));
+        }
+    }
+    uint32_t total[9];
+    for (size_t k = 0; k < 9; ++k)
+    {
+        alignas(32) uint64_t lanes[4];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), acc[k]);
+        total[k] = static_cast<uint32_t>(lanes[0] + lanes[1] + lanes[2]
+                                         + lanes[3]);
+    }
+    // the remaining words are counted one at a time
+    uintptr_t loader;
+    uintptr_t loader2;
+    uintptr_t loader3;
+    for (uintptr_t i = num_vec * word_per_vec; i < founder_ctl2; ++i)
+    {
+        loader = geno[i];
+        for (size_t k = 0; k < 3; ++k)
+        {
+            loader2 = masks[k][i];
+            loader3 = loader2 & (loader >> 1);
+            total[3 * k] += static_cast<uint32_t>(
+                __builtin_popcountll(loader & loader2));
+            total[3 * k + 1] +=
+                static_cast<uint32_t>(__builtin_popcountll(loader3));
+            total[3 * k + 2] += static_cast<uint32_t>(
+                __builtin_popcountll(loader & loader3));
+        }
+    }
+    fused_3x3_counts(total, counts);
+}
+#endif
+
+void Genotype::genovec_3x3freq(const uintptr_t* geno,
+                               const uintptr_t* index_data,
+                               const uintptr_t founder_ctl2,
+                               const uintptr_t founder_ctv2, uint32_t* counts)
+{
+#ifdef FUSED_3X3_TARGET
+#ifdef FUSED_3X3_RUNTIME_CHECK
+    static const bool use_fused = __builtin_cpu_supports("popcnt");
+#else
+    static const bool use_fused = true;
+#endif
+#ifdef FUSED_3X3_AVX2_TARGET
+    static const bool use_avx2 = __builtin_cpu_supports("avx2")
+                                 && __builtin_cpu_supports("popcnt");
+    if (use_avx2)
+    {
+        fused_3x3freq_avx2(geno, index_data, &(index_data[founder_ctv2]),
+                           &(index_data[2 * founder_ctv2]), founder_ctl2,
+                           counts);
+        return;
+    }
+#endif
+    if (use_fused && founder_ctl2 <= FUSED_3X3_MAX_SCALAR_WORDS)
+    {
+        fused_3x3freq(geno, index_data, &(index_data[founder_ctv2]),
+                      &(index_data[2 * founder_ctv2]), founder_ctl2, counts);
+        return;
+    }
+#endif
+    for (size_t k = 0; k < 3; ++k)
+    {
+        genovec_3freq(geno, &(index_data[k * founder_ctv2]), founder_ctl2,
+                      &(counts[3 * k]), &(counts[3 * k + 1]),
+                      &(counts[3 * k + 2]));
+    }
+}
+
 void Genotype::efficient_clumping(const Clumping& clump_info,
                                   Genotype& reference)
 {
     // the m_existed_snp must be sorted before coming into this equation
+    if (!clump_info.ld_store_out.empty())
+    { export_ld_store(clump_info, reference); }
     m_reporter->report("Start performing clumping");
-    // we want to initialize the vectors with size correspond to the sample in
-    // the reference panel. Need to use the unfiltered sample size
-    const uintptr_t unfiltered_sample_ctl =
-        BITCT_TO_WORDCT(reference.m_unfiltered_sample_ct);
-    // again, we want to initialize the vector containing the founder
-    // membership, which require us to know the number of founders in the
-    // reference panel
-    const uint32_t founder_ctv3 =
-        BITCT_TO_ALIGNED_WORDCT(static_cast<uint32_t>(reference.m_founder_ct));
-    const uint32_t founder_ctsplit = 3 * founder_ctv3;
-    const uintptr_t founder_ctl2 = QUATERCT_TO_WORDCT(reference.m_founder_ct);
+    if (!clump_info.ld_store.empty())
+    {
+        std::vector<char> remain_core(m_existed_snps.size(), false);
+        store_clumping(clump_info, reference, remain_core);
+        finish_clumping(remain_core);
+        return;
+    }
+    // we want to initialize the vector containing the founder membership,
+    // which require us to know the number of founders in the reference panel
     const uintptr_t founder_ctv2 =
         QUATERCT_TO_ALIGNED_WORDCT(reference.m_founder_ct);
-
-    // We only want to perform clumping if our R2 is higher than a minimum
-    // threshold. Depending on whethre we do proxy clumping or not, the minimum
-    // threshold can be the clump_p or clump_proxy parameter
-    const double min_r2 = (clump_info.use_proxy)
-                              ? std::min(clump_info.proxy, clump_info.r2)
-                              : clump_info.r2;
-
-    // when we read in the genotype, the genotype is stored in byte represented
-    // by uintptr_t. Then we will use the PLINK 2 functions to obtain the R2
-    // As this vector can be big, we will only initialize it once (memory
-    // allocation can be expensive)
-    std::vector<uintptr_t> genotype_vector(unfiltered_sample_ctl * 2);
-    // We need a vector to indicate which SNPs are remaining after clumping to
-    // remove any clumped SNPs. This is achieved by using this boolean vector
-    std::vector<bool> remain_core(m_existed_snps.size(), false);
-    // next few parameters are used to store the intermediate output from PLINK
-    // function, corresponding to the count of different genotypes
-
-    // and this is the storage to result R2
-    double r2 = -1.0;
-    // The following two vectors are used for storing the intermediate output.
-    // Again, put memory allocation at the beginning
-    std::vector<uintptr_t> index_data(3 * founder_ctsplit + founder_ctv3);
-    std::vector<uintptr_t> index_tots(6);
     // This is a data mask used by PLINK in the calculation of R2. Preallocate
     // to speed up
     std::vector<uintptr_t> founder_include2(founder_ctv2, 0);
     fill_quatervec_55(static_cast<uint32_t>(reference.m_founder_ct),
                       founder_include2.data());
+    // SNPs can only clump SNPs within their own window, so SNPs in different
+    // independent blocks (no window spanning across the block boundary) can
+    // be clumped concurrently while giving the same result as serial clumping
+    std::vector<std::vector<size_t>> block_snps;
+    build_clump_blocks(block_snps);
+    size_t max_block_size = 0;
+    for (auto&& block : block_snps)
+    { max_block_size = std::max(max_block_size, block.size()); }
+    // each thread need its own genotype cache. cal_avail_memory will reduce
+    // the number of thread if there isn't enough memory to support them
+    size_t num_thread =
+        static_cast<size_t>(std::max(1, m_prs_calculation.thread));
+    num_thread =
+        std::max<size_t>(1, std::min(num_thread, block_snps.size()));
     // one way to speed things up as in PLINK 2 is to pre-allocate the memory
     // space for what we need to do next. The following code did precisely that
     // (borrow from PLINK2)
-
-    intptr_t malloc_size_mb = cal_avail_memory(founder_ctv2);
+    intptr_t malloc_size_mb =
+        cal_avail_memory(founder_ctv2, max_block_size, num_thread);
     // now allocate the memory into a pointer
 
     // window data is the pointer walking through the allocated memory
-    size_t max_window_size, num_core_snps = 0;
+    size_t max_window_size;
     unsigned char* bigstack_ua = nullptr; // ua = unaligned
     unsigned char* bigstack_initial_base;
     bigstack_ua = reinterpret_cast<unsigned char*>(malloc(
@@ -1097,187 +1577,453 @@ void Genotype::efficient_clumping(const Clumping& clump_info,
         reinterpret_cast<uintptr_t*>(bigstack_initial_base);
     if (!max_window_size)
     { throw std::runtime_error("Error: Not enough memory for clumping!"); }
-    uintptr_t* window_data_ptr = nullptr;
+    // each thread cache as many SNPs as the memory allows
+    const size_t thread_cache_size = max_window_size / num_thread;
+    if (thread_cache_size == 0 || thread_cache_size < m_max_window_size)
+    { throw std::runtime_error("Error: Not enough memory for clumping!"); }
+    // We need a vector to indicate which SNPs are remaining after clumping to
+    // remove any clumped SNPs. Use char instead of bool so that threads can
+    // safely update different elements
+    std::vector<char> remain_core(m_existed_snps.size(), false);
+    std::atomic<size_t> next_block(0), processed(0);
+    std::mutex read_mutex;
+    std::vector<std::thread> workers;
+    for (size_t i_thread = 1; i_thread < num_thread; ++i_thread)
+    {
+        workers.push_back(std::thread(
+            &Genotype::clump_worker, this, std::cref(clump_info),
+            std::ref(reference), std::cref(block_snps), std::ref(next_block),
+            std::ref(processed), std::ref(read_mutex),
+            &(window_data[i_thread * thread_cache_size * founder_ctv2]),
+            thread_cache_size, std::ref(founder_include2),
+            std::ref(remain_core), false));
+    }
+    // main thread also do the clumping and is responsible for the progress
+    clump_worker(clump_info, reference, block_snps, next_block, processed,
+                 read_mutex, window_data, thread_cache_size, founder_include2,
+                 remain_core, true);
+    for (auto&& thread : workers) { thread.join(); }
+    fprintf(stderr, "\rClumping Progress: %03.2f%%\n\n", 100.0);
+    // now we release the memory stack
+    free(bigstack_ua);
+    window_data = nullptr;
+    bigstack_initial_base = nullptr;
+    bigstack_ua = nullptr;
+    finish_clumping(remain_core);
+}
 
-    // a counter to count how many windows have we read
-    uintptr_t cur_window_size = 0;
-    // if max_window size is 0, it means we don't have enough memory for
-    // clumping
+void Genotype::finish_clumping(const std::vector<char>& remain_core)
+{
+    const size_t num_core_snps = static_cast<size_t>(
+        std::count(remain_core.begin(), remain_core.end(), true));
+    if (num_core_snps != m_existed_snps.size())
+    {
+        shrink_snp_vector(
+            std::vector<bool>(remain_core.begin(), remain_core.end()));
+    }
+    // we no longer require the index. might as well clear it (and hope it will
+    // release the memory)
+    m_existed_snps_index.clear();
+    m_reporter->report("Number of variant(s) after clumping : "
+                       + misc::to_string(m_existed_snps.size()));
+}
 
-    double prev_progress = -1.0;
-    const auto num_snp = m_existed_snps.size();
+void Genotype::build_clump_blocks(std::vector<std::vector<size_t>>& block_snps)
+{
+    // m_existed_snps is sorted by coordinate, and the clump window of a SNP
+    // contains another SNP if and only if the window of the other SNP
+    // contains the SNP. Thus we can start a new block whenever none of the
+    // previous SNPs' window reaches the current SNP
+    const size_t num_snp = m_existed_snps.size();
+    std::vector<size_t> snp_block(num_snp, 0);
+    size_t max_up_bound = 0, cur_block = 0;
     for (size_t i_snp = 0; i_snp < num_snp; ++i_snp)
     {
-        // now start iterate through each SNP
-        double progress =
-            static_cast<double>(i_snp) / static_cast<double>(num_snp) * 100;
-        if (progress - prev_progress > 0.01)
-        {
-            fprintf(stderr, "\rClumping Progress: %03.2f%%", progress);
-            prev_progress = progress;
-        }
-        // get the index on target.m_existed_snp to the i_th most significant
-        // SNP
-        auto&& cur_snp_index = m_sort_by_p_index[i_snp];
-        // read in the current SNP
-        auto&& cur_target_snp = m_existed_snps[cur_snp_index];
-        if (cur_target_snp.clumped()
-            || cur_target_snp.p_value() > clump_info.pvalue)
-        {
-            // ignore any SNP that are clumped or that has a p-value higher than
-            // the clump-p threshold
-            continue;
-        }
-        // Any SNP with p-value less than clump-p will be ignored
-        // because they can never be an index SNP and thus are not of our
-        // interested
+        if (i_snp != 0 && max_up_bound <= i_snp) { ++cur_block; }
+        snp_block[i_snp] = cur_block;
+        max_up_bound = std::max(max_up_bound, m_existed_snps[i_snp].up_bound());
+    }
+    block_snps.clear();
+    block_snps.resize(num_snp == 0 ? 0 : cur_block + 1);
+    // within each block, we want to process the SNPs in the same order as
+    // they are in m_sort_by_p_index
+    for (auto&& snp_idx : m_sort_by_p_index)
+    { block_snps[snp_block[snp_idx]].push_back(snp_idx); }
+}
 
-        // this is the first SNP we should read from
-        const size_t start = cur_target_snp.low_bound();
-        // this is the first SNP we should ignore
-        const size_t end = cur_target_snp.up_bound();
-        // reset our pointer to the start of the memory stack as we are working
-        // on a new core SNP
-        window_data_ptr = window_data;
-        cur_window_size = 0;
-        // transversing on TARGET
-        // now we will transverse any SNP that comes before the index SNP in the
-        // file
-        for (size_t i_pair = start; i_pair < cur_snp_index; i_pair++)
+void Genotype::clump_worker(const Clumping& clump_info, Genotype& reference,
+                            const std::vector<std::vector<size_t>>& block_snps,
+                            std::atomic<size_t>& next_block,
+                            std::atomic<size_t>& processed,
+                            std::mutex& read_mutex, uintptr_t* cache_data,
+                            const size_t cache_size,
+                            std::vector<uintptr_t>& founder_include2,
+                            std::vector<char>& remain_core,
+                            const bool print_progress)
+{
+    const uint32_t founder_ctv3 =
+        BITCT_TO_ALIGNED_WORDCT(static_cast<uint32_t>(reference.m_founder_ct));
+    const uint32_t founder_ctsplit = 3 * founder_ctv3;
+    const uintptr_t founder_ctl2 = QUATERCT_TO_WORDCT(reference.m_founder_ct);
+    const uintptr_t founder_ctv2 =
+        QUATERCT_TO_ALIGNED_WORDCT(reference.m_founder_ct);
+    // We only want to perform clumping if our R2 is higher than a minimum
+    // threshold. Depending on whethre we do proxy clumping or not, the minimum
+    // threshold can be the clump_p or clump_proxy parameter
+    const double min_r2 = (clump_info.use_proxy)
+                              ? std::min(clump_info.proxy, clump_info.r2)
+                              : clump_info.r2;
+    // and this is the storage to result R2
+    double r2 = -1.0;
+    // The following two vectors are used for storing the intermediate output.
+    // Again, put memory allocation at the beginning
+    std::vector<uintptr_t> index_data(3 * founder_ctsplit + founder_ctv3);
+    std::vector<uintptr_t> index_tots(6);
+    // The decoded genotype of SNP i is cached in slot i % cache_size, and
+    // cache_owner tells us which SNP currently occupy the slot. As each window
+    // contains at most m_max_window_size consecutive SNPs and cache_size is
+    // at least that big, SNPs from the same window never evict each other.
+    // Each SNP is therefore only read again when it was evicted by a far away
+    // window
+    std::vector<size_t> cache_owner(cache_size, ~size_t(0));
+    auto get_genotype = [&](const SNP& snp, const size_t snp_idx) {
+        const size_t slot = snp_idx % cache_size;
+        uintptr_t* genotype = &(cache_data[slot * founder_ctv2]);
+        if (cache_owner[slot] != snp_idx)
         {
-
-            // the start and end correspond to index on m_existed_snps instead
-            // of m_sort_by_p, so we can skip reading from m_sort_by_p
-            // the current SNP
-            auto&& pair_target_snp = m_existed_snps[i_pair];
-            if (pair_target_snp.clumped()
-                || pair_target_snp.p_value() > clump_info.pvalue)
-            {
-                // ignore SNP that are clumped or that has higher p-value than
-                // threshold
-                continue;
-            }
             // Something PLINK does. I suspect this is to reset the content of
             // the pointer to 0
-            window_data_ptr[founder_ctv2 - 2] = 0;
-            window_data_ptr[founder_ctv2 - 1] = 0;
-            if (++cur_window_size == max_window_size)
-            { throw std::runtime_error("Error: Out of memory!"); }
+            genotype[founder_ctv2 - 2] = 0;
+            genotype[founder_ctv2 - 1] = 0;
             // read in the genotype data from the memory
             // this depends on the type of the reference.
             // Most important information is the ref_byte_pos (reference byte
             // position for reading) and ref_file_name (which reference file
-            // should we read from)
-            reference.read_genotype(window_data_ptr,
-                                    pair_target_snp.get_byte_pos(true),
-                                    pair_target_snp.get_file_idx(true));
-            // we then move the pointer forward to the next space in the memory
-            window_data_ptr = &(window_data_ptr[founder_ctv2]);
+            // should we read from). The reader is shared by all threads
+            std::lock_guard<std::mutex> lock(read_mutex);
+            reference.read_genotype(genotype, snp.get_byte_pos(true),
+                                    snp.get_file_idx(true));
+            cache_owner[slot] = snp_idx;
+        }
+        return genotype;
+    };
+    // Each worker advises the window of its index SNP before reading it.
+    // The advised range is kept per worker, as the workers read different
+    // blocks and the SNPs of a block are not visited in file order
+    size_t advised_start = 0, advised_end = 0;
+    auto advise_window = [&](const size_t start, const size_t end) {
+        const bool overlap = start >= advised_start && start < advised_end;
+        const size_t from = overlap ? advised_end : start;
+        if (from >= end) return;
+        std::lock_guard<std::mutex> lock(read_mutex);
+        advised_end = reference.advise_range(
+            from, end, true,
+            [this](size_t i) -> const SNP& { return m_existed_snps[i]; });
+        if (!overlap) advised_start = start;
+    };
+    double prev_progress = -1.0;
+    const auto num_snp = m_existed_snps.size();
+    size_t block_idx;
+    while ((block_idx = next_block++) < block_snps.size())
+    {
+        for (auto&& cur_snp_index : block_snps[block_idx])
+        {
+            ++processed;
+            if (print_progress)
+            {
+                // now start iterate through each SNP
+                double progress = static_cast<double>(processed)
+                                  / static_cast<double>(num_snp) * 100;
+                if (progress - prev_progress > 0.01)
+                {
+                    fprintf(stderr, "\rClumping Progress: %03.2f%%", progress);
+                    prev_progress = progress;
+                }
+            }
+            // read in the current SNP
+            auto&& cur_target_snp = m_existed_snps[cur_snp_index];
+            if (cur_target_snp.clumped()
+                || cur_target_snp.p_value() > clump_info.pvalue)
+            {
+                // ignore any SNP that are clumped or that has a p-value higher
+                // than the clump-p threshold
+                continue;
+            }
+            // Any SNP with p-value less than clump-p will be ignored
+            // because they can never be an index SNP and thus are not of our
+            // interested
+
+            // this is the first SNP we should read from
+            const size_t start = cur_target_snp.low_bound();
+            // this is the first SNP we should ignore
+            const size_t end = cur_target_snp.up_bound();
+            advise_window(start, end);
+            // now we want to read in the index / core SNP
+            // reset the index_data information
+            std::fill(index_data.begin(), index_data.end(), 0);
+            // generate the required data mask
+            // Disclaimer: For the next few lines, they are from PLINK and I
+            // don't fully understand what they are doing
+            // then populate the index_tots
+            update_index_tot(founder_ctl2, founder_ctv2, reference.m_founder_ct,
+                             index_data, index_tots, founder_include2,
+                             get_genotype(cur_target_snp, cur_snp_index));
+            // we have finished reading the index and stored the necessary
+            // inforamtion, we can now calculate the R2 between the index and
+            // all other SNPs within the window
+            for (size_t i_pair = start; i_pair < end; ++i_pair)
+            {
+                // the start and end correspond to index on m_existed_snps
+                // instead of m_sort_by_p
+                if (i_pair == cur_snp_index) continue;
+                auto&& pair_target_snp = m_existed_snps[i_pair];
+                if (pair_target_snp.clumped()
+                    || pair_target_snp.p_value() > clump_info.pvalue)
+                {
+                    // ignore SNP that are clumped or that has higher p-value
+                    // than threshold
+                    continue;
+                }
+                r2 = get_r2(founder_ctl2, founder_ctv2,
+                            get_genotype(pair_target_snp, i_pair), index_data,
+                            index_tots);
+                if (r2 >= min_r2)
+                {
+                    // if the R2 between two SNP is higher than the minim
+                    // threshold, we will perform clumping
+                    // use the core SNP to clump the pair_target_snp
+                    cur_target_snp.clump(pair_target_snp, r2,
+                                         clump_info.use_proxy,
+                                         clump_info.proxy);
+                }
+            }
+            // we set the core SNP to be "clumped" so that it will no longer be
+            // considered by other SNP
+            cur_target_snp.set_clumped();
+            // we set the remain_core to true so that we will keep it at the end
+            remain_core[cur_snp_index] = true;
         }
+    }
+}
 
-        if (++cur_window_size == max_window_size)
-        { throw std::runtime_error("Error: Out of memory!"); }
-        // now we want to read in the index / core SNP
-        // reset the content of the pointer again
-        window_data_ptr[founder_ctv2 - 2] = 0;
-        window_data_ptr[founder_ctv2 - 1] = 0;
-        // then we can read in the genotype from the reference panel
-        // note the use of cur_target_snp
-        reference.read_genotype(window_data_ptr,
-                                cur_target_snp.get_byte_pos(true),
-                                cur_target_snp.get_file_idx(true));
-        // reset the index_data information
+void Genotype::export_ld_store(const Clumping& clump_info,
+                               Genotype& reference)
+{
+    m_reporter->report("Writing LD store to " + clump_info.ld_store_out);
+    const uint32_t founder_ctv3 =
+        BITCT_TO_ALIGNED_WORDCT(static_cast<uint32_t>(reference.m_founder_ct));
+    const uint32_t founder_ctsplit = 3 * founder_ctv3;
+    const uintptr_t founder_ctl2 = QUATERCT_TO_WORDCT(reference.m_founder_ct);
+    const uintptr_t founder_ctv2 =
+        QUATERCT_TO_ALIGNED_WORDCT(reference.m_founder_ct);
+    std::vector<uintptr_t> founder_include2(founder_ctv2, 0);
+    fill_quatervec_55(static_cast<uint32_t>(reference.m_founder_ct),
+                      founder_include2.data());
+    std::vector<uintptr_t> index_data(3 * founder_ctsplit + founder_ctv3);
+    std::vector<uintptr_t> index_tots(6);
+    // each window contains at most m_max_window_size SNPs, and we only visit
+    // SNPs located after the index SNP. A ring buffer of that size therefore
+    // allow us to read each SNP exactly once
+    const size_t cache_size = m_max_window_size + 1;
+    std::vector<uintptr_t> cache(cache_size * founder_ctv2, 0);
+    size_t num_read = 0;
+    auto get_genotype = [&](const size_t snp_idx) {
+        for (; num_read <= snp_idx; ++num_read)
+        {
+            uintptr_t* genotype =
+                &(cache[(num_read % cache_size) * founder_ctv2]);
+            genotype[founder_ctv2 - 2] = 0;
+            genotype[founder_ctv2 - 1] = 0;
+            reference.read_ahead(num_read, m_existed_snps.size(), true,
+                                 [this](size_t i) -> const SNP& {
+                                     return m_existed_snps[i];
+                                 });
+            auto&& snp = m_existed_snps[num_read];
+            reference.read_genotype(genotype, snp.get_byte_pos(true),
+                                    snp.get_file_idx(true));
+        }
+        return &(cache[(snp_idx % cache_size) * founder_ctv2]);
+    };
+    LDStore store;
+    store.create(clump_info.ld_store_out, reference.m_founder_ct,
+                 reference.m_founder_hash, reference.m_variant_hash,
+                 clump_info.distance, std::max(0.0, clump_info.ld_store_r2));
+    const size_t num_snp = m_existed_snps.size();
+    double prev_progress = -1.0;
+    for (size_t i_snp = 0; i_snp < num_snp; ++i_snp)
+    {
+        double progress = static_cast<double>(i_snp)
+                          / static_cast<double>(num_snp) * 100;
+        if (progress - prev_progress > 0.01)
+        {
+            fprintf(stderr, "\rWriting LD Store: %03.2f%%", progress);
+            prev_progress = progress;
+        }
+        auto&& cur_snp = m_existed_snps[i_snp];
         std::fill(index_data.begin(), index_data.end(), 0);
-        // generate the required data mask
-        // Disclaimer: For the next few lines, they are from PLINK and I don't
-        // fully understand what they are doing
-        // then populate the index_tots
         update_index_tot(founder_ctl2, founder_ctv2, reference.m_founder_ct,
                          index_data, index_tots, founder_include2,
-                         window_data_ptr);
-        // we have finished reading the index and stored the necessary
-        // inforamtion, we can now calculate the R2 between the index and
-        // previous SNPs
-        // move back to the front of the memory (we don't need to read the SNP
-        // again as the info is stored in the memory)
-        window_data_ptr = window_data;
-        for (size_t i_pair = start; i_pair < cur_snp_index; i_pair++)
+                         get_genotype(i_snp));
+        for (size_t i_pair = i_snp + 1; i_pair < cur_snp.up_bound(); ++i_pair)
         {
-            auto&& pair_target_snp = m_existed_snps[i_pair];
-            if (pair_target_snp.clumped()
-                || pair_target_snp.p_value() > clump_info.pvalue)
-                // Again, ignore unwanted SNP
-                continue;
-            r2 = get_r2(founder_ctl2, founder_ctv2, window_data_ptr, index_data,
-                        index_tots);
-            if (r2 >= min_r2)
-            {
-                // if the R2 between two SNP is higher than the minim threshold,
-                // we will perform clumping
-                // use the core SNP to clump the pair_target_snp
-                cur_target_snp.clump(pair_target_snp, r2, clump_info.use_proxy,
-                                     clump_info.proxy);
-            }
-            // travel to the next snp
-            window_data_ptr = &(window_data_ptr[founder_ctv2]);
+            store.add_pair(i_pair,
+                           get_r2(founder_ctl2, founder_ctv2,
+                                  get_genotype(i_pair), index_data,
+                                  index_tots));
         }
-        // now we can read the SNPs that come after the index SNP in the file
+        store.add_snp(cur_snp.rs(), cur_snp.chr(), cur_snp.loc());
+    }
+    store.close();
+    fprintf(stderr, "\rWriting LD Store: %03.2f%%\n\n", 100.0);
+}
 
-        for (size_t i_pair = cur_snp_index + 1; i_pair < end; ++i_pair)
+void Genotype::store_clumping(const Clumping& clump_info,
+                              Genotype& reference,
+                              std::vector<char>& remain_core)
+{
+    LDStore store;
+    store.load(clump_info.ld_store);
+    const double min_r2 = (clump_info.use_proxy)
+                              ? std::min(clump_info.proxy, clump_info.r2)
+                              : clump_info.r2;
+    // the stored R2 are only valid if the same LD reference samples and a
+    // window at least as large as the current one were used
+    if (store.founder_ct() != reference.m_founder_ct
+        || store.founder_hash() != reference.m_founder_hash)
+    {
+        throw std::runtime_error(
+            "Error: LD store was generated from a different set of founders ("
+            + misc::to_string(store.founder_ct())
+            + " founder(s)) than those in the LD reference ("
+            + misc::to_string(reference.m_founder_ct) + " founder(s))!");
+    }
+    if (store.variant_hash() != reference.m_variant_hash)
+    {
+        throw std::runtime_error("Error: LD store was generated from a "
+                                 "different LD reference!");
+    }
+    if (clump_info.distance > store.distance())
+    {
+        throw std::runtime_error(
+            "Error: Clump distance is larger than the window used to "
+            "generate the LD store ("
+            + misc::to_string(store.distance() / 1000) + "kb)!");
+    }
+    if (min_r2 < store.r2_floor())
+    {
+        throw std::runtime_error(
+            "Error: Clumping R2 threshold is lower than the minimum R2 kept in "
+            "the LD store ("
+            + misc::to_string(store.r2_floor()) + ")!");
+    }
+    const size_t num_snp = m_existed_snps.size();
+    const size_t not_stored = ~size_t(0);
+    std::vector<size_t> store_idx(num_snp);
+    size_t num_missing = 0;
+    for (size_t i = 0; i < num_snp; ++i)
+    {
+        auto&& snp = m_existed_snps[i];
+        store_idx[i] = store.find(snp.rs());
+        if (store_idx[i] == not_stored)
         {
-            // we don't need to store the SNP information, as we can process
-            // each SNP immediately. Always reset the pointer to the beginning
-            // of the stack
-            window_data_ptr = window_data;
-            // read in the SNP information from teh target
+            ++num_missing;
+            continue;
+        }
+        if (store.chr(store_idx[i]) != snp.chr()
+            || store.loc(store_idx[i]) != snp.loc())
+        {
+            throw std::runtime_error("Error: " + snp.rs()
+                                     + " has a different coordinate in the "
+                                       "LD store!");
+        }
+    }
+    if (num_missing != 0)
+    {
+        m_reporter->report(
+            misc::to_string(num_missing)
+            + " variant(s) not found in the LD store. Their LD will be "
+              "calculated from the LD reference");
+    }
+    // the genotypes are only read for the SNPs not in the store and their
+    // partners. As in clump_worker, a window never evicts its own SNPs from
+    // the cache
+    const uint32_t founder_ctv3 =
+        BITCT_TO_ALIGNED_WORDCT(static_cast<uint32_t>(reference.m_founder_ct));
+    const uint32_t founder_ctsplit = 3 * founder_ctv3;
+    const uintptr_t founder_ctl2 = QUATERCT_TO_WORDCT(reference.m_founder_ct);
+    const uintptr_t founder_ctv2 =
+        QUATERCT_TO_ALIGNED_WORDCT(reference.m_founder_ct);
+    std::vector<uintptr_t> founder_include2, index_data, index_tots, cache;
+    const size_t cache_size = m_max_window_size + 1;
+    std::vector<size_t> cache_owner;
+    if (num_missing != 0)
+    {
+        founder_include2.assign(founder_ctv2, 0);
+        fill_quatervec_55(static_cast<uint32_t>(reference.m_founder_ct),
+                          founder_include2.data());
+        index_data.resize(3 * founder_ctsplit + founder_ctv3);
+        index_tots.resize(6);
+        cache.assign(cache_size * founder_ctv2, 0);
+        cache_owner.assign(cache_size, ~size_t(0));
+    }
+    auto get_genotype = [&](const size_t snp_idx) {
+        const size_t slot = snp_idx % cache_size;
+        uintptr_t* genotype = &(cache[slot * founder_ctv2]);
+        if (cache_owner[slot] != snp_idx)
+        {
+            genotype[founder_ctv2 - 2] = 0;
+            genotype[founder_ctv2 - 1] = 0;
+            auto&& snp = m_existed_snps[snp_idx];
+            reference.read_genotype(genotype, snp.get_byte_pos(true),
+                                    snp.get_file_idx(true));
+            cache_owner[slot] = snp_idx;
+        }
+        return genotype;
+    };
+    double r2;
+    for (auto&& cur_snp_index : m_sort_by_p_index)
+    {
+        auto&& cur_target_snp = m_existed_snps[cur_snp_index];
+        if (cur_target_snp.clumped()
+            || cur_target_snp.p_value() > clump_info.pvalue)
+        { continue; }
+        bool index_read = false;
+        for (size_t i_pair = cur_target_snp.low_bound();
+             i_pair < cur_target_snp.up_bound(); ++i_pair)
+        {
+            if (i_pair == cur_snp_index) continue;
             auto&& pair_target_snp = m_existed_snps[i_pair];
             if (pair_target_snp.clumped()
                 || pair_target_snp.p_value() > clump_info.pvalue)
-                // skip if not required
-                continue;
-            // reset data
-            window_data_ptr[founder_ctv2 - 2] = 0;
-            window_data_ptr[founder_ctv2 - 1] = 0;
-            // read in the genotype information
-            reference.read_genotype(window_data_ptr,
-                                    pair_target_snp.get_byte_pos(true),
-                                    pair_target_snp.get_file_idx(true));
-            r2 = get_r2(founder_ctl2, founder_ctv2, window_data_ptr, index_data,
-                        index_tots);
-            // now perform clumping if required
+            { continue; }
+            if (store_idx[cur_snp_index] != not_stored
+                && store_idx[i_pair] != not_stored)
+            { r2 = store.r2(store_idx[cur_snp_index], store_idx[i_pair]); }
+            else
+            {
+                if (!index_read)
+                {
+                    std::fill(index_data.begin(), index_data.end(), 0);
+                    update_index_tot(founder_ctl2, founder_ctv2,
+                                     reference.m_founder_ct, index_data,
+                                     index_tots, founder_include2,
+                                     get_genotype(cur_snp_index));
+                    index_read = true;
+                }
+                r2 = get_r2(founder_ctl2, founder_ctv2, get_genotype(i_pair),
+                            index_data, index_tots);
+            }
             if (r2 >= min_r2)
             {
-                cur_target_snp.clump(pair_target_snp, r2, clump_info.use_proxy,
-                                     clump_info.proxy);
+                cur_target_snp.clump(pair_target_snp, r2,
+                                     clump_info.use_proxy, clump_info.proxy);
             }
         }
-        // we set the core SNP to be "clumped" so that it will no longer be
-        // considered by other SNP
         cur_target_snp.set_clumped();
-        // we set the remain_core to true so that we will keep it at the end
         remain_core[cur_snp_index] = true;
-        ++num_core_snps;
-        // we also get the p-value threshold of the SNP so that we know what
-        // thresholds are included in our analysis. This information is vital
-        // for the generation of all score file
     }
-    fprintf(stderr, "\rClumping Progress: %03.2f%%\n\n", 100.0);
-    // now we release the memory stack
-    free(bigstack_ua);
-    window_data = nullptr;
-    window_data_ptr = nullptr;
-    bigstack_initial_base = nullptr;
-    bigstack_ua = nullptr;
-    if (num_core_snps != m_existed_snps.size())
-    { shrink_snp_vector(remain_core); }
-    // we no longer require the index. might as well clear it (and hope it will
-    // release the memory)
-    m_existed_snps_index.clear();
-    m_reporter->report("Number of variant(s) after clumping : "
-                       + misc::to_string(m_existed_snps.size()));
 }
 
-
 void Genotype::recalculate_categories(const PThresholding& p_info)
 { // need to loop through the SNPs to check
     std::sort(begin(m_existed_snps), end(m_existed_snps),
@@ -1473,22 +2219,28 @@ void Genotype::build_membership_matrix(
     }
 }
 void Genotype::standardize_prs()
+{
+    score_mean_sd(m_prs_score.data(), m_prs_num_snp.data(), m_mean_score,
+                  m_score_sd);
+}
+
+void Genotype::score_mean_sd(const double* prs, const uint32_t* num_snp,
+                             double& mean, double& sd) const
 {
     misc::RunningStat rs;
-    size_t num_prs = m_prs_info.size();
+    size_t num_prs = m_prs_score.size();
     for (size_t i = 0; i < num_prs; ++i)
     {
         if (!IS_SET(m_sample_include, i) || IS_SET(m_exclude_from_std, i))
             continue;
-        if (m_prs_info[i].num_snp == 0) { rs.push(0.0); }
+        if (num_snp[i] == 0) { rs.push(0.0); }
         else
         {
-            rs.push(m_prs_info[i].prs
-                    / static_cast<double>(m_prs_info[i].num_snp));
+            rs.push(prs[i] / static_cast<double>(num_snp[i]));
         }
     }
-    m_mean_score = rs.mean();
-    m_score_sd = rs.sd();
+    mean = rs.mean();
+    sd = rs.sd();
 }
 
 void Genotype::get_null_score(const size_t& set_size, const size_t& prev_size,
@@ -1512,6 +2264,102 @@ void Genotype::get_null_score(const size_t& set_size, const size_t& prev_size,
     { standardize_prs(); }
 }
 
+bool Genotype::cache_background(const std::vector<size_t>& background)
+{
+    if (background == m_bk_index) return true;
+    release_background();
+    const size_t num_bk = background.size();
+    const unsigned long long required =
+        static_cast<unsigned long long>(num_bk) * m_sample_ct
+        * (sizeof(double) + sizeof(uint8_t));
+    if (required > g_allowed_memory || required > misc::remain_memory())
+        return false;
+    try
+    {
+        m_bk_score.resize(num_bk * m_sample_ct);
+        m_bk_num_snp.resize(num_bk * m_sample_ct);
+    }
+    catch (const std::bad_alloc&)
+    {
+        release_background();
+        return false;
+    }
+    m_bk_valid.assign(num_bk, false);
+    read_background(background);
+    m_bk_index = background;
+    return true;
+}
+
+void Genotype::null_score_block(const std::vector<size_t>& col_start,
+                                const std::vector<size_t>& snp_pos,
+                                const size_t num_set_size,
+                                std::vector<double>& prs,
+                                std::vector<uint32_t>& num_snp,
+                                std::vector<double>& score) const
+{
+    assert(!col_start.empty() && num_set_size > 0);
+    const size_t num_col = col_start.size() - 1;
+    // the number of SNPs is only used by the average and standardized score
+    const bool count = m_prs_calculation.scoring_method != SCORING::SUM;
+    prs.resize(num_col * m_sample_ct);
+    num_snp.resize(count ? num_col * m_sample_ct : 0);
+    for (size_t tile_start = 0; tile_start < m_sample_ct;
+         tile_start += NULL_SCORE_TILE)
+    {
+        const size_t tile =
+            std::min<size_t>(NULL_SCORE_TILE, m_sample_ct - tile_start);
+        for (size_t col = 0; col < num_col; ++col)
+        {
+            const size_t offset = col * m_sample_ct + tile_start;
+            double* cur_prs = &prs[offset];
+            uint32_t* cur_num_snp = count ? &num_snp[offset] : nullptr;
+            if (col % num_set_size == 0)
+            {
+                std::fill(cur_prs, cur_prs + tile, 0.0);
+                if (count) std::fill(cur_num_snp, cur_num_snp + tile, 0);
+            }
+            else
+            {
+                std::copy(cur_prs - m_sample_ct, cur_prs - m_sample_ct + tile,
+                          cur_prs);
+                if (count)
+                {
+                    std::copy(cur_num_snp - m_sample_ct,
+                              cur_num_snp - m_sample_ct + tile, cur_num_snp);
+                }
+            }
+            // add the SNPs in the same order as read_score
+            for (size_t i = col_start[col]; i < col_start[col + 1]; ++i)
+            {
+                const size_t pos = snp_pos[i];
+                if (!m_bk_valid[pos]) continue;
+                const double* bk_score =
+                    &m_bk_score[pos * m_sample_ct + tile_start];
+                for (size_t j = 0; j < tile; ++j) cur_prs[j] += bk_score[j];
+                if (!count) continue;
+                const uint8_t* bk_num_snp =
+                    &m_bk_num_snp[pos * m_sample_ct + tile_start];
+                for (size_t j = 0; j < tile; ++j)
+                { cur_num_snp[j] += bk_num_snp[j]; }
+            }
+        }
+    }
+    score.resize(num_col * m_sample_ct);
+    for (size_t col = 0; col < num_col; ++col)
+    {
+        const size_t offset = col * m_sample_ct;
+        double mean = 0.0, sd = 0.0;
+        if (m_prs_calculation.scoring_method == SCORING::STANDARDIZE
+            || m_prs_calculation.scoring_method == SCORING::CONTROL_STD)
+        { score_mean_sd(&prs[offset], &num_snp[offset], mean, sd); }
+        for (size_t i = 0; i < m_sample_ct; ++i)
+        {
+            score[offset + i] = final_score(
+                prs[offset + i], count ? num_snp[offset + i] : 0u, mean, sd);
+        }
+    }
+}
+
 bool Genotype::get_score(std::vector<size_t>::const_iterator& start_index,
                          const std::vector<size_t>::const_iterator& end_index,
                          double& cur_threshold, uint32_t& num_snp_included,
@@ -1546,6 +2394,82 @@ bool Genotype::get_score(std::vector<size_t>::const_iterator& start_index,
     return true;
 }
 
+void Genotype::score_matrix(const std::string& out,
+                            const std::vector<std::string>& base_names)
+{
+    assert(base_names.size() == m_num_base);
+    // read the SNPs in the order they are stored in the genotype files
+    std::vector<size_t> snp_index(m_existed_snps.size());
+    std::iota(snp_index.begin(), snp_index.end(), 0);
+    std::sort(snp_index.begin(), snp_index.end(),
+              [this](const size_t& i, const size_t& j) {
+                  const SNP& a = m_existed_snps[i];
+                  const SNP& b = m_existed_snps[j];
+                  if (a.get_file_idx() == b.get_file_idx())
+                      return a.get_byte_pos() < b.get_byte_pos();
+                  return a.get_file_idx() < b.get_file_idx();
+              });
+    m_score_matrix.assign(m_sample_ct * m_num_base, 0.0);
+    m_score_matrix_num_snp.assign(m_sample_ct * m_num_base, 0);
+    read_score_matrix(snp_index);
+    const std::string out_name = out + ".score_matrix";
+    std::ofstream matrix_out(out_name.c_str());
+    if (!matrix_out.is_open())
+    {
+        throw std::runtime_error("Error: Cannot open file: " + out_name
+                                 + " to write");
+    }
+    // same as calculate_score, without phenotype, all samples are used for
+    // standardization
+    const bool use_sum = m_prs_calculation.scoring_method == SCORING::SUM;
+    // con_std is rejected with --score-base in Commander::misc_check
+    assert(m_prs_calculation.scoring_method != SCORING::CONTROL_STD);
+    const bool standardize =
+        m_prs_calculation.scoring_method == SCORING::STANDARDIZE;
+    for (size_t i = 0; i < m_score_matrix.size(); ++i)
+    {
+        if (use_sum) continue;
+        m_score_matrix[i] =
+            (m_score_matrix_num_snp[i] == 0)
+                ? 0.0
+                : m_score_matrix[i]
+                      / static_cast<double>(m_score_matrix_num_snp[i]);
+    }
+    std::vector<double> mean(m_num_base, 0.0), sd(m_num_base, 1.0);
+    if (standardize)
+    {
+        for (size_t i_base = 0; i_base < m_num_base; ++i_base)
+        {
+            misc::RunningStat rs;
+            for (size_t i = 0; i < m_sample_ct; ++i)
+            { rs.push(m_score_matrix[i * m_num_base + i_base]); }
+            mean[i_base] = rs.mean();
+            sd[i_base] = rs.sd();
+        }
+    }
+    // same precision as the .all_score file
+    matrix_out << std::setprecision(9) << "FID IID";
+    for (auto&& name : base_names) { matrix_out << " " << name; }
+    matrix_out << "\n";
+    for (size_t i = 0; i < m_sample_ct; ++i)
+    {
+        matrix_out << sample_id(i, " ");
+        for (size_t i_base = 0; i_base < m_num_base; ++i_base)
+        {
+            matrix_out << " "
+                       << (m_score_matrix[i * m_num_base + i_base]
+                           - mean[i_base])
+                              / sd[i_base];
+        }
+        matrix_out << "\n";
+    }
+    if (!matrix_out.good())
+    {
+        throw std::runtime_error("Error: Failed to write score matrix: "
+                                 + out_name);
+    }
+}
+
 /**
  * DON'T TOUCH AREA
  *
@@ -0,0 +1,165 @@
+// This file is part of PRSice-2, copyright (C) 2016-2019
+// Shing Wan Choi, Paul F. O’Reilly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "ldstore.hpp"
+#include <algorithm>
+#include <cstring>
+
+void LDStore::create(const std::string& file, const uint64_t founder_ct,
+                     const uint64_t founder_hash, const uint64_t variant_hash,
+                     const uint64_t distance, const double r2_floor)
+{
+    m_file_name = file;
+    m_out.open(file.c_str(), std::ios::binary | std::ios::trunc);
+    if (!m_out.is_open())
+    {
+        throw std::runtime_error("Error: Cannot open LD store to write: "
+                                 + file);
+    }
+    m_founder_ct = founder_ct;
+    m_founder_hash = founder_hash;
+    m_variant_hash = variant_hash;
+    m_distance = distance;
+    m_r2_floor = r2_floor;
+    m_num_snp = 0;
+    m_num_pair = 0;
+    m_write_offset.assign(1, 0);
+    m_rs.clear();
+    m_chr.clear();
+    m_loc.clear();
+    // reserve space for the header, which will be completed in close
+    write_header();
+}
+
+void LDStore::write_header()
+{
+    m_out.write(LD_STORE_MAGIC, LD_STORE_MAGIC_SIZE);
+    m_out.write(reinterpret_cast<const char*>(&m_num_snp), sizeof(uint64_t));
+    m_out.write(reinterpret_cast<const char*>(&m_founder_ct),
+                sizeof(uint64_t));
+    m_out.write(reinterpret_cast<const char*>(&m_founder_hash),
+                sizeof(uint64_t));
+    m_out.write(reinterpret_cast<const char*>(&m_variant_hash),
+                sizeof(uint64_t));
+    m_out.write(reinterpret_cast<const char*>(&m_distance), sizeof(uint64_t));
+    m_out.write(reinterpret_cast<const char*>(&m_r2_floor), sizeof(double));
+    m_out.write(reinterpret_cast<const char*>(&m_num_pair), sizeof(uint64_t));
+}
+
+void LDStore::add_snp(const std::string& rs, const size_t chr,
+                      const size_t loc)
+{
+    m_write_offset.push_back(m_num_pair);
+    m_rs.push_back(rs);
+    m_chr.push_back(chr);
+    m_loc.push_back(loc);
+    ++m_num_snp;
+}
+
+void LDStore::close()
+{
+    m_out.write(reinterpret_cast<const char*>(m_write_offset.data()),
+                static_cast<std::streamsize>(m_write_offset.size()
+                                             * sizeof(uint64_t)));
+    for (size_t i = 0; i < m_num_snp; ++i)
+    {
+        const uint32_t chr = static_cast<uint32_t>(m_chr[i]);
+        const uint32_t rs_length = static_cast<uint32_t>(m_rs[i].size());
+        const uint64_t loc = m_loc[i];
+        m_out.write(reinterpret_cast<const char*>(&chr), sizeof(uint32_t));
+        m_out.write(reinterpret_cast<const char*>(&rs_length),
+                    sizeof(uint32_t));
+        m_out.write(reinterpret_cast<const char*>(&loc), sizeof(uint64_t));
+        m_out.write(m_rs[i].data(), rs_length);
+    }
+    m_out.seekp(0);
+    write_header();
+    if (!m_out.good())
+    {
+        throw std::runtime_error("Error: Failed to write LD store: "
+                                 + m_file_name);
+    }
+    m_out.close();
+}
+
+void LDStore::load(const std::string& file)
+{
+    m_file_name = file;
+    std::error_code error;
+    m_memory_map.map(file, error);
+    if (error)
+    { throw std::runtime_error("Error: Failed to map LD store: " + file); }
+    const char* data = m_memory_map.data();
+    const size_t file_size = m_memory_map.size();
+    if (file_size < LD_STORE_HEADER_SIZE
+        || std::memcmp(data, LD_STORE_MAGIC, LD_STORE_MAGIC_SIZE) != 0)
+    { throw std::runtime_error("Error: Invalid LD store: " + file); }
+    size_t pos = LD_STORE_MAGIC_SIZE;
+    auto read_field = [&](void* target, size_t size) {
+        std::memcpy(target, &(data[pos]), size);
+        pos += size;
+    };
+    read_field(&m_num_snp, sizeof(uint64_t));
+    read_field(&m_founder_ct, sizeof(uint64_t));
+    read_field(&m_founder_hash, sizeof(uint64_t));
+    read_field(&m_variant_hash, sizeof(uint64_t));
+    read_field(&m_distance, sizeof(uint64_t));
+    read_field(&m_r2_floor, sizeof(double));
+    read_field(&m_num_pair, sizeof(uint64_t));
+    // the header is a multiple of 8 bytes and the map is page aligned, so the
+    // pairs and offsets can be accessed in place
+    const size_t table_start = LD_STORE_HEADER_SIZE + m_num_pair * sizeof(Pair)
+                               + (m_num_snp + 1) * sizeof(uint64_t);
+    if (table_start > file_size)
+    { throw std::runtime_error("Error: Truncated LD store: " + file); }
+    m_pairs = reinterpret_cast<const Pair*>(&(data[LD_STORE_HEADER_SIZE]));
+    m_offset = reinterpret_cast<const uint64_t*>(
+        &(data[LD_STORE_HEADER_SIZE + m_num_pair * sizeof(Pair)]));
+    m_snp_index.clear();
+    m_chr.resize(m_num_snp);
+    m_loc.resize(m_num_snp);
+    pos = table_start;
+    uint32_t chr, rs_length;
+    uint64_t loc;
+    for (size_t i = 0; i < m_num_snp; ++i)
+    {
+        if (pos + 2 * sizeof(uint32_t) + sizeof(uint64_t) > file_size)
+        { throw std::runtime_error("Error: Truncated LD store: " + file); }
+        read_field(&chr, sizeof(uint32_t));
+        read_field(&rs_length, sizeof(uint32_t));
+        read_field(&loc, sizeof(uint64_t));
+        if (pos + rs_length > file_size)
+        { throw std::runtime_error("Error: Truncated LD store: " + file); }
+        m_chr[i] = chr;
+        m_loc[i] = loc;
+        m_snp_index[std::string(&(data[pos]), rs_length)] = i;
+        pos += rs_length;
+    }
+}
+
+double LDStore::r2(const size_t a, const size_t b) const
+{
+    // pairs are only stored once, under the SNP that comes first
+    const size_t first = std::min(a, b);
+    const uint64_t second = std::max(a, b);
+    const Pair* start = &(m_pairs[m_offset[first]]);
+    const Pair* end = &(m_pairs[m_offset[first + 1]]);
+    const Pair* res = std::lower_bound(
+        start, end, second,
+        [](const Pair& p, const uint64_t idx) { return p.partner < idx; });
+    if (res == end || res->partner != second) return -1;
+    return res->r2;
+}
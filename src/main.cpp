@@ -90,6 +90,26 @@ int main(int argc, char* argv[])
                                    commander.get_base_qc(),
                                    commander.get_p_threshold(),
                                    exclusion_regions, commander.keep_ambig());
+            // the score base files are aligned to the SNPs of the base file
+            // and scored together with it
+            const std::vector<std::string> score_base = commander.score_base();
+            std::vector<std::string> score_names = {base_name};
+            if (!score_base.empty())
+            {
+                target_file->init_score_matrix(score_base.size() + 1);
+                BaseFile score_base_file = commander.get_base();
+                for (size_t i = 0; i < score_base.size(); ++i)
+                {
+                    score_base_file.file_name = score_base[i];
+                    score_names.push_back(
+                        misc::remove_extension<std::string>(
+                            misc::base_name<std::string>(score_base[i])));
+                    target_file->read_base(
+                        score_base_file, commander.get_base_qc(),
+                        commander.get_p_threshold(), exclusion_regions,
+                        commander.keep_ambig(), i + 1);
+                }
+            }
             // no longer need the exclusion region object
             // then we will read in the sample information
             message = "Loading Genotype info from target\n";
@@ -105,7 +125,8 @@ int main(int argc, char* argv[])
             target_file->init_memory();
             // now load the reference file
             // initialize the memory map file
-            if (commander.use_ref() && commander.need_ref())
+            if (commander.use_ref() && commander.need_ref()
+                && score_base.empty())
             {
                 message = "Start processing reference\n";
                 reporter.report(message);
@@ -135,6 +156,17 @@ int main(int argc, char* argv[])
             // i.e after clumping, to speed up the process
             target_file->calc_freqs_and_intermediate(commander.get_target_qc(),
                                                      commander.out(), true);
+            if (!score_base.empty())
+            {
+                reporter.report("Calculating score matrix of "
+                                + std::to_string(score_names.size())
+                                + " base files. Clumping, p-value "
+                                  "thresholding and regression are skipped");
+                target_file->score_matrix(commander.out(), score_names);
+                target_file->print_read_summary();
+                delete target_file;
+                return 0;
+            }
             if (init_ref)
             {
                 reference_file->set_thresholds(commander.get_ref_qc());
@@ -181,6 +213,8 @@ int main(int argc, char* argv[])
                 target_file->efficient_clumping(
                     commander.get_clump_info(),
                     commander.use_ref() ? *reference_file : *target_file);
+                if (commander.use_ref())
+                { reference_file->print_read_summary(); }
                 // immediately free the memory
             }
             if (init_ref) { delete reference_file; }
@@ -270,6 +304,7 @@ int main(int argc, char* argv[])
             }
             prsice.print_progress(true);
             fprintf(stderr, "\n");
+            target_file->print_read_summary();
             if (!commander.get_prs_instruction().no_regress)
                 // now generate the summary file
                 prsice.summarize();
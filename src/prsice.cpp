@@ -1102,13 +1102,28 @@ bool PRSice::run_prsice(const size_t pheno_index, const size_t region_index,
     // will then proceed to read in and calculate the PRS for the given
     // category (defined by the cur_index, which points to the first SNP of
     // the p-value threshold)
-
-
+    // The PRS of each threshold is stored as a column of m_score_matrix and
+    // the regressions are only performed once the batch is full. This way,
+    // all thresholds are obtained from a single streaming pass through the
+    // genotype and the regressions can be done together
+    const Eigen::Index batch_size =
+        score_batch_size(num_samples_included, target.num_threshold());
+    m_score_matrix.resize(static_cast<Eigen::Index>(num_samples_included),
+                          batch_size);
+    m_batch_threshold.clear();
+    m_batch_num_snp.clear();
+    Eigen::Index score_col;
     while (target.get_score(cur_start_idx, cur_end_idx, cur_threshold,
                             m_num_snp_included, first_run))
     {
         ++m_analysis_done;
         print_progress();
+        score_col = static_cast<Eigen::Index>(m_batch_threshold.size());
+        for (size_t sample = 0; sample < num_samples_included; ++sample)
+        {
+            m_score_matrix(static_cast<Eigen::Index>(sample), score_col) =
+                target.calculate_score(sample);
+        }
         if (print_all_scores && pheno_index == 0)
         {
             for (size_t sample = 0; sample < num_samples_included; ++sample)
@@ -1126,33 +1141,22 @@ bool PRSice::run_prsice(const size_t pheno_index, const size_t region_index,
                 m_all_out.seekp(loc);
                 // then we will output the score
                 m_all_out << std::setprecision(static_cast<int>(m_precision))
-                          << target.calculate_score(sample);
+                          << m_score_matrix(static_cast<Eigen::Index>(sample),
+                                            score_col);
             }
         }
         // we need to then tell the file that we have finish processing one
         // threshold. Next time we output another PRS, it should be output
         // in the column of the next threshold
         ++m_all_file.processed_threshold;
-        if (!m_prs_info.no_regress)
-        {
-            regress_score(target, cur_threshold, m_prs_info.thread, pheno_index,
-                          prs_result_idx);
-            if (m_perm_info.run_perm)
-            {
-                permutation(m_prs_info.thread,
-                            m_pheno_info.binary[pheno_index]);
-            }
-        }
-        else
-        {
-            prsice_result cur_result;
-            cur_result.threshold = cur_threshold;
-            cur_result.num_snp = m_num_snp_included;
-            m_prs_results[prs_result_idx] = cur_result;
-        }
-        ++prs_result_idx;
+        m_batch_threshold.push_back(cur_threshold);
+        m_batch_num_snp.push_back(m_num_snp_included);
+        if (static_cast<Eigen::Index>(m_batch_threshold.size()) == batch_size)
+        { regress_batch(pheno_index, prs_result_idx); }
         first_run = false;
     }
+    // process the remaining thresholds
+    regress_batch(pheno_index, prs_result_idx);
 
     // we need to process the permutation result if permutation is required
     if (m_perm_info.run_perm) process_permutations();
@@ -1246,7 +1250,62 @@ void PRSice::print_best(Genotype& target, const size_t pheno_index)
     ++m_best_file.processed_threshold;
 }
 
-void PRSice::regress_score(Genotype& target, const double threshold,
+void PRSice::regress_batch(const size_t pheno_index, size_t& prs_result_idx)
+{
+    // only the PRS column changes between thresholds, so we can factor the
+    // covariates once and regress the PRS of the whole batch together
+    if (!m_prs_info.no_regress && !m_pheno_info.binary[pheno_index]
+        && !m_batch_threshold.empty())
+    {
+        Regression::factor_covariates(m_phenotype, m_independent_variables,
+                                      m_covariate_qr, m_prs_info.thread);
+        const Eigen::Index num_regress_samples =
+            static_cast<Eigen::Index>(m_matrix_index.size());
+        const Eigen::Index num_col =
+            static_cast<Eigen::Index>(m_batch_threshold.size());
+        Eigen::MatrixXd prs(num_regress_samples, num_col);
+        for (Eigen::Index col = 0; col < num_col; ++col)
+        {
+            for (Eigen::Index sample_id = 0; sample_id < num_regress_samples;
+                 ++sample_id)
+            {
+                prs(sample_id, col) = m_score_matrix(
+                    static_cast<Eigen::Index>(
+                        m_matrix_index[static_cast<size_t>(sample_id)]),
+                    col);
+            }
+        }
+        Regression::fastLm_covariate_block(m_covariate_qr, prs,
+                                           m_covariate_fit);
+    }
+    for (size_t i = 0; i < m_batch_threshold.size(); ++i)
+    {
+        if (!m_prs_info.no_regress)
+        {
+            regress_score(static_cast<Eigen::Index>(i), m_batch_threshold[i],
+                          m_batch_num_snp[i], m_prs_info.thread, pheno_index,
+                          prs_result_idx);
+            if (m_perm_info.run_perm)
+            {
+                permutation(m_prs_info.thread,
+                            m_pheno_info.binary[pheno_index]);
+            }
+        }
+        else
+        {
+            prsice_result cur_result;
+            cur_result.threshold = m_batch_threshold[i];
+            cur_result.num_snp = m_batch_num_snp[i];
+            m_prs_results[prs_result_idx] = cur_result;
+        }
+        ++prs_result_idx;
+    }
+    m_batch_threshold.clear();
+    m_batch_num_snp.clear();
+}
+
+void PRSice::regress_score(const Eigen::Index score_col,
+                           const double threshold, const uint32_t num_snp,
                            const int thread, const size_t pheno_index,
                            const size_t prs_result_idx)
 {
@@ -1254,8 +1313,7 @@ void PRSice::regress_score(Genotype& target, const double threshold,
            se = 0.0;
     const Eigen::Index num_regress_samples =
         static_cast<Eigen::Index>(m_matrix_index.size());
-    if (m_num_snp_included == 0
-        || (m_num_snp_included == m_prs_results[prs_result_idx].num_snp))
+    if (num_snp == 0 || (num_snp == m_prs_results[prs_result_idx].num_snp))
     {
         // if we haven't read in any SNP, or that we have the same number of
         // SNP as the previous threshold, we will skip (normally this should
@@ -1269,8 +1327,10 @@ void PRSice::regress_score(Genotype& target, const double threshold,
     {
         // we can directly read in the matrix index from m_matrix_index
         // vector and assign the PRS directly to the indep variable matrix
-        m_independent_variables(sample_id, 1) = target.calculate_score(
-            m_matrix_index[static_cast<size_t>(sample_id)]);
+        m_independent_variables(sample_id, 1) = m_score_matrix(
+            static_cast<Eigen::Index>(
+                m_matrix_index[static_cast<size_t>(sample_id)]),
+            score_col);
     }
 
     if (m_pheno_info.binary[pheno_index])
@@ -1304,9 +1364,22 @@ void PRSice::regress_score(Genotype& target, const double threshold,
     }
     else
     {
-        // we can run the linear regression
-        Regression::fastLm(m_phenotype, m_independent_variables, p_value, r2,
-                           r2_adjust, coefficient, se, thread, true);
+        // the batch has already been regressed by regress_batch, unless the
+        // PRS is collinear with the covariates
+        const size_t fit_idx = static_cast<size_t>(score_col);
+        if (m_covariate_fit.estimable[fit_idx])
+        {
+            p_value = m_covariate_fit.p_value(score_col);
+            r2 = m_covariate_fit.r2(score_col);
+            r2_adjust = m_covariate_fit.r2_adjust(score_col);
+            coefficient = m_covariate_fit.coeff(score_col);
+            se = m_covariate_fit.standard_error(score_col);
+        }
+        else
+        {
+            Regression::fastLm(m_phenotype, m_independent_variables, p_value,
+                               r2, r2_adjust, coefficient, se, thread, true);
+        }
     }
     // If this is the best r2, then we will add it
     int best_index = m_best_index;
@@ -1314,14 +1387,15 @@ void PRSice::regress_score(Genotype& target, const double threshold,
         || m_prs_results[static_cast<size_t>(best_index)].r2 < r2)
     {
         m_best_index = static_cast<int>(prs_result_idx);
-        size_t num_include_samples = target.num_sample();
-        for (size_t s = 0; s < num_include_samples; ++s)
+        const Eigen::Index num_include_samples = m_score_matrix.rows();
+        for (Eigen::Index s = 0; s < num_include_samples; ++s)
         {
             // we will have to store the best scores. we cannot directly
             // copy from the m_independent_variable as some samples which
             // might have excluded from the regression model but we still
             // want their PRS.
-            m_best_sample_score[s] = target.calculate_score(s);
+            m_best_sample_score[static_cast<size_t>(s)] =
+                m_score_matrix(s, score_col);
         }
     }
     // we can now store the prsice_result
@@ -1332,7 +1406,7 @@ void PRSice::regress_score(Genotype& target, const double threshold,
     cur_result.coefficient = coefficient;
     cur_result.p = p_value;
     cur_result.emp_p = -1.0;
-    cur_result.num_snp = m_num_snp_included;
+    cur_result.num_snp = num_snp;
     cur_result.se = se;
     cur_result.competitive_p = -1.0;
     m_prs_results[prs_result_idx] = cur_result;
@@ -1355,8 +1429,6 @@ void PRSice::process_permutations()
 
 void PRSice::permutation(const int n_thread, const bool is_binary)
 {
-    Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic> perm_matrix(
-        m_phenotype.rows());
     Eigen::setNbThreads(n_thread);
     Eigen::Index rank = 0;
     // logit_perm can only be true if it is binary trait and user used the
@@ -1365,8 +1437,7 @@ void PRSice::permutation(const int n_thread, const bool is_binary)
     // 1. QT trait (!is_binary)
     // 2. Not require logit perm
     Eigen::ColPivHouseholderQR<Eigen::MatrixXd> PQR;
-    Eigen::ColPivHouseholderQR<Eigen::MatrixXd>::PermutationType Pmat;
-    Eigen::MatrixXd R;
+    Eigen::VectorXd se_base;
     bool run_glm = true;
     if (!is_binary || !m_perm_info.logit_perm)
     {
@@ -1374,259 +1445,97 @@ void PRSice::permutation(const int n_thread, const bool is_binary)
         // regression in our permutation, we will first decompose the
         // independent variable once, therefore speed up the other processes
         PQR.compute(m_independent_variables);
-        Pmat = PQR.colsPermutation();
+        const Eigen::Index p = m_independent_variables.cols();
         rank = PQR.rank();
-        if (rank != m_independent_variables.cols())
+        Eigen::MatrixXd Rinv;
+        if (rank != p)
         {
-            PQR.matrixQR()
-                .topLeftCorner(rank, rank)
-                .triangularView<Eigen::Upper>()
-                .solve(Eigen::MatrixXd::Identity(rank, rank));
+            Rinv = PQR.matrixQR()
+                       .topLeftCorner(rank, rank)
+                       .triangularView<Eigen::Upper>()
+                       .solve(Eigen::MatrixXd::Identity(rank, rank));
         }
+        // the SE only depends on the independent variables, so we only need
+        // to scale it by the residual standard deviation of each permutation
+        get_se_matrix(PQR, PQR.colsPermutation(), Rinv, p, rank, se_base);
         run_glm = false;
     }
-    if (n_thread == 1)
-    {
-        // we will run the single thread function to reduce overhead
-        run_null_perm_no_thread(PQR, Pmat, R, run_glm);
-    }
-    else
-    {
-        // we will run teh thread queue where one thread is responsible for
-        // generating the shuffled phenotype whereas other threads are
-        // responsible for calculating the t statistics
-        Thread_Queue<std::pair<Eigen::VectorXd, size_t>> set_perm_queue;
-        // For multi-threading we use the producer consumer pattern where
-        // the producer will keep random shuffle the phenotypes and the
-        // consumers will calculate the t-values All we need to provide to
-        // the producer is the number of consumers and the permutation queue
-        // use for
-        std::thread producer(&PRSice::gen_null_pheno, this,
-                             std::ref(set_perm_queue), n_thread - 1);
-        std::vector<std::thread> consume_store;
-        // we have used one thread as the producer, therefore we need to
-        // reduce the number of available thread by 1
-        for (int i = 0; i < n_thread - 1; ++i)
-        {
-            consume_store.push_back(std::thread(
-                &PRSice::consume_null_pheno, this, std::ref(set_perm_queue),
-                std::ref(PQR), std::ref(Pmat), std::ref(R), run_glm));
-        }
-        // wait for all the threads to complete their job
-        producer.join();
-        for (auto&& consume : consume_store) consume.join();
-    }
+    // without logistic regression, we regress a block of permuted phenotypes
+    // at once so that the work is done by matrix-matrix products
+    const size_t block_size = run_glm ? 1 : null_pheno_block_size();
+    const size_t num_perm = m_perm_info.num_permutation;
+    const size_t num_block = (num_perm + block_size - 1) / block_size;
+    // each block is a task, and the workers generate their own permuted
+    // phenotypes such that there is no single producer to wait for
+    Task_Scheduler scheduler(static_cast<size_t>(std::max(n_thread, 1)));
+    std::vector<Eigen::MatrixXd> null_pheno(scheduler.num_thread());
+    std::vector<Eigen::VectorXd> t_value(scheduler.num_thread());
+    scheduler.run(num_block, [&](size_t block, size_t worker) {
+        const size_t start = block * block_size;
+        const size_t num_pheno = std::min(block_size, num_perm - start);
+        shuffle_null_pheno(start, num_pheno, null_pheno[worker]);
+        null_pheno_t_value(null_pheno[worker], PQR, se_base, run_glm,
+                           t_value[worker]);
+        // blocks never overlap, so workers can update the result directly
+        for (size_t i = 0; i < num_pheno; ++i)
+        {
+            m_perm_result[start + i] =
+                std::max(t_value[worker](static_cast<Eigen::Index>(i)),
+                         m_perm_result[start + i]);
+        }
+        std::lock_guard<std::mutex> lock(lock_guard);
+        m_analysis_done += static_cast<uint32_t>(num_pheno);
+        print_progress();
+    });
 }
 
-void PRSice::run_null_perm_no_thread(
-    const Eigen::ColPivHouseholderQR<Eigen::MatrixXd>& PQR,
-    const Eigen::ColPivHouseholderQR<Eigen::MatrixXd>::PermutationType& Pmat,
-    const Eigen::MatrixXd& R, const bool run_glm)
+size_t PRSice::null_pheno_block_size() const
 {
-    // reset the seed for each new threshold such that we will always
-    // generate the same phenotpe for each threhsold without us needing to
-    // regenerate the PRS
-    std::mt19937 rand_gen {m_seed};
-    // we want to count the number of samples included in the analysis
-    const Eigen::Index num_regress_sample = m_phenotype.rows();
-    const Eigen::Index p = m_independent_variables.cols();
-    const Eigen::Index rank = PQR.rank();
-    // we will copy the phenotype into a new vector (Maybe not necessary,
-    // but better safe than sorry)
-    Eigen::VectorXd perm_pheno = m_phenotype;
-    // count the number of loop we've finished so far
-    size_t processed = 0;
-    // pre-initialize these parameters
-    double coefficient, standard_error, r2, obs_p;
-    double obs_t = -1;
-
-    Eigen::VectorXd beta, se, effects, fitted, resid;
-    Eigen::Index df;
-    while (processed < m_perm_info.num_permutation)
-    {
-        // for quantitative trait, we can directly compute the results
-        // without re-computing the decomposition
-        perm_pheno = m_phenotype;
-        std::shuffle(perm_pheno.data(), perm_pheno.data() + num_regress_sample,
-                     rand_gen);
-        m_analysis_done++;
-        print_progress();
-        if (run_glm)
-        {
-            Regression::glm(perm_pheno, m_independent_variables, obs_p, r2,
-                            coefficient, standard_error, 1);
-        }
-        else
-        {
-            // directly solve the current phenotype to obtain the required
-            // beta
-            if (p == rank)
-            {
-                beta = PQR.solve(perm_pheno);
-                fitted = m_independent_variables * beta;
-                se = Pmat
-                     * PQR.matrixQR()
-                           .topRows(p)
-                           .triangularView<Eigen::Upper>()
-                           .solve(lm::I_p(p))
-                           .rowwise()
-                           .norm();
-            }
-            else
-            {
-                effects = PQR.householderQ().adjoint() * perm_pheno;
-                beta = Eigen::VectorXd::Constant(
-                    p, std::numeric_limits<double>::quiet_NaN());
-                beta.head(rank) = R * effects.head(rank);
-                beta = Pmat * beta;
-                // create fitted values from effects
-                // (can't use X*m_coef if X is rank-deficient)
-                effects.tail(num_regress_sample - rank).setZero();
-                fitted = PQR.householderQ() * effects;
-                se = Eigen::VectorXd::Constant(
-                    p, std::numeric_limits<double>::quiet_NaN());
-                se.head(rank) = R.rowwise().norm();
-                se = Pmat * se;
-            }
-            // we take the absolute of the T-value as we only concern about
-            // the magnitude
-            resid = perm_pheno - fitted;
-            df = (rank >= 0) ? num_regress_sample - p
-                             : num_regress_sample - rank;
-            double s = resid.norm() / std::sqrt(double(df));
-            se = s * se;
-            coefficient = beta(1);
-            standard_error = se(1);
-        }
-        obs_t = std::fabs(coefficient / standard_error);
-        m_perm_result[processed] = std::max(obs_t, m_perm_result[processed]);
-        // we have finished the current analysis.
-        ++processed;
-    }
+    const size_t num_sample = static_cast<size_t>(m_phenotype.rows());
+    size_t block_size = MAX_PERM_BLOCK_BYTES / (sizeof(double) * num_sample);
+    block_size = std::min<size_t>(block_size, PERM_BLOCK_SIZE);
+    block_size = std::min(block_size, m_perm_info.num_permutation);
+    return std::max<size_t>(block_size, 1);
 }
 
-
-void PRSice::gen_null_pheno(Thread_Queue<std::pair<Eigen::VectorXd, size_t>>& q,
-                            size_t num_consumer)
+void PRSice::shuffle_null_pheno(const size_t start, const size_t num_pheno,
+                                Eigen::MatrixXd& null_pheno) const
 {
-    size_t processed = 0;
-    // we need to reset the seed for each threshold so that the phenotype
-    // generated should always be the same for each threshold. This help us
-    // avoid needing to repeat reading in the PRS for each permutation
-    std::mt19937 rand_gen {m_seed};
-    Eigen::setNbThreads(1);
     const Eigen::Index num_regress_sample = m_phenotype.rows();
-    // this matrix is use for storing the shuffle information
-    Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic> perm_matrix(
-        m_phenotype.rows());
-
-    while (processed < m_perm_info.num_permutation)
-    {
-        // I am not completely sure whether we pass by reference or pass by
-        // value to the queue (or if we move this out and cause undefined
-        // behaviour). To avoid the aforementioned problems, we reinitialize
-        // a new vector for each permutation
-        Eigen::VectorXd null_pheno = m_phenotype;
-        // then we shuffle it
-        std::shuffle(null_pheno.data(), null_pheno.data() + num_regress_sample,
-                     rand_gen);
-        // and the we will push it to the queue where the consumers will
-        // pick up and work on it
-        q.emplace(std::make_pair(null_pheno, processed), num_consumer);
-        m_analysis_done++;
-        print_progress();
-        processed++;
+    null_pheno.resize(num_regress_sample, static_cast<Eigen::Index>(num_pheno));
+    for (Eigen::Index i = 0; i < null_pheno.cols(); ++i)
+    {
+        // each permutation has its own random stream, so the permuted
+        // phenotypes do not depend on the block size or on which worker
+        // generate them. The same phenotypes are therefore generated for
+        // each threshold
+        Philox4x32 rand_gen(m_seed, start + static_cast<size_t>(i));
+        null_pheno.col(i) = m_phenotype;
+        std::shuffle(null_pheno.col(i).data(),
+                     null_pheno.col(i).data() + num_regress_sample, rand_gen);
     }
-    // send termination signal to the consumers
-    q.completed();
 }
 
-void PRSice::consume_null_pheno(
-    Thread_Queue<std::pair<Eigen::VectorXd, size_t>>& q,
+void PRSice::null_pheno_t_value(
+    const Eigen::MatrixXd& null_pheno,
     const Eigen::ColPivHouseholderQR<Eigen::MatrixXd>& PQR,
-    const Eigen::ColPivHouseholderQR<Eigen::MatrixXd>::PermutationType& Pmat,
-    const Eigen::MatrixXd& R, bool run_glm)
+    const Eigen::VectorXd& se_base, const bool run_glm,
+    Eigen::VectorXd& t_value) const
 {
-    const Eigen::Index n = m_phenotype.rows();
-    const Eigen::Index p = m_independent_variables.cols();
-    const Eigen::Index rank = PQR.rank();
-    // to avoid false sharing, all consumer will first store their
-    // permutation result in their own vector and only update the master
-    // vector at the end of permutation temp_store stores all the T-value
-    std::vector<double> temp_store;
-    // and temp_index indicate which permutation the T-value corresponse to
-    // it is important we don't mix up the permutation order as we're
-    // supposed to mimic re-running PRSice N times with different
-    // permutation
-    std::vector<size_t> temp_index;
-    Eigen::VectorXd beta, se, effects, fitted, resid;
-    Eigen::Index df;
-    std::pair<Eigen::VectorXd, size_t> input;
+    if (!run_glm)
+    {
+        Regression::fastLm_block(PQR, se_base, null_pheno, 1, t_value);
+        return;
+    }
     double coefficient, standard_error, r2, obs_p;
-    double obs_t = -1;
-    while (!q.pop(input))
+    t_value.resize(null_pheno.cols());
+    for (Eigen::Index i = 0; i < null_pheno.cols(); ++i)
     {
-        // as long as we have not received a termination signal, we will
-        // continue our processing and should read from the queue
-        if (run_glm)
-        {
-            // the first entry from the queue should be the permuted
-            // phenotype and the second entry is the index. We will pass the
-            // phenotype for GLM analysis if required
-            Regression::glm(std::get<0>(input), m_independent_variables, obs_p,
-                            r2, coefficient, standard_error, 1);
-        }
-        else
-        {
-            if (p == rank)
-            {
-                beta = PQR.solve(std::get<0>(input));
-                fitted = m_independent_variables * beta;
-                se = Pmat
-                     * PQR.matrixQR()
-                           .topRows(p)
-                           .triangularView<Eigen::Upper>()
-                           .solve(lm::I_p(p))
-                           .rowwise()
-                           .norm();
-            }
-            else
-            {
-                beta = Eigen::VectorXd::Constant(
-                    p, std::numeric_limits<double>::quiet_NaN());
-                effects = PQR.householderQ().adjoint() * std::get<0>(input);
-                beta.head(rank) = R * effects.head(rank);
-                beta = Pmat * beta;
-                // create fitted values from effects
-                // (can't use X*m_coef if X is rank-deficient)
-                effects.tail(n - rank).setZero();
-                fitted = PQR.householderQ() * effects;
-                se = Eigen::VectorXd::Constant(
-                    p, std::numeric_limits<double>::quiet_NaN());
-                se.head(rank) = R.rowwise().norm();
-                se = Pmat * se;
-            }
-            coefficient = beta(1);
-            resid = std::get<0>(input) - fitted;
-            df = (rank >= 0) ? n - p : n - rank;
-            double s = resid.norm() / std::sqrt(double(df));
-            se = s * se;
-            standard_error = se(1);
-        }
-        obs_t = std::fabs(coefficient / standard_error);
-        temp_store.push_back(obs_t);
-        temp_index.push_back(std::get<1>(input));
-    }
-    // once we received the termination signal, we can start propagating the
-    // master vector with out content
-    std::lock_guard<std::mutex> lock(lock_guard);
-    for (size_t i = 0; i < temp_store.size(); ++i)
-    {
-        double obs_t = temp_store[i];
-        auto&& index = temp_index[i];
-        // if the t-value in the master vector is lower than our observed t,
-        // update it
-        if (m_perm_result[index] < obs_t) { m_perm_result[index] = obs_t; }
+        Regression::glm(null_pheno.col(i), m_independent_variables, obs_p, r2,
+                        coefficient, standard_error, 1);
+        // we take the absolute of the T-value as we only concern about
+        // the magnitude
+        t_value(i) = std::fabs(coefficient / standard_error);
     }
 }
 
@@ -2100,257 +2009,211 @@ void PRSice::get_se_matrix(
     }
 }
 
-void PRSice::null_set_no_thread(
-    Genotype& target, const size_t num_background,
-    std::vector<size_t> background,
+void PRSice::null_set_perm(
+    Task_Scheduler& scheduler, Genotype& target,
+    const std::vector<size_t>& background,
     const std::map<size_t, std::vector<size_t>>& set_index,
-    const Eigen::MatrixXd& X,
     const Eigen::ColPivHouseholderQR<Eigen::MatrixXd>& PQR,
-    const Eigen::ColPivHouseholderQR<Eigen::MatrixXd>::PermutationType& Pmat,
-    const Eigen::MatrixXd& Rinv, std::vector<double>& obs_t_value,
-    std::vector<std::atomic<size_t>>& set_perm_res, const bool is_binary)
+    const Eigen::VectorXd& se_base, const std::vector<double>& obs_t_value,
+    std::vector<std::atomic<size_t>>& set_perm_res, const bool is_binary,
+    const bool cached)
 {
     // last key = largest set size
     const size_t max_size = set_index.rbegin()->first;
+    const size_t num_background = background.size();
     const Eigen::Index num_sample =
         static_cast<Eigen::Index>(m_matrix_index.size());
-    const Eigen::Index p = m_independent_variables.cols();
-    const Eigen::Index rank = PQR.rank();
-    Eigen::Index df;
-    double coefficient, standard_error, r2, obs_p, t_value;
-    size_t processed = 0;
-    std::mt19937 g(m_seed);
-    bool first_run = true;
-    Eigen::VectorXd beta, se, effects, resid, fitted, se_base,
-        prs = Eigen::VectorXd::Zero(num_sample);
-    get_se_matrix(PQR, Pmat, Rinv, p, rank, se_base);
-    while (processed < m_perm_info.num_permutation)
-    {
-        size_t begin = 0;
-        // we will shuffle n where n is the set with the largest size
-        // this is the Fisher-Yates shuffle algorithm for random selection
-        // without replacement
-        size_t num_snp = max_size;
-        while (num_snp--)
-        {
-            std::uniform_int_distribution<size_t> dist(begin,
-                                                       num_background - 1);
-            size_t advance_index = dist(g);
-            std::swap(background[begin], background[advance_index]);
-            ++begin;
-        }
-        //  we have now selected N SNPs from the background. We can then
-        //  construct the PRS based on these index
-        first_run = true;
-        size_t prev_size = 0;
-        for (auto&& set_size : set_index)
-        {
-            target.get_null_score(set_size.first, prev_size, background,
-                                  first_run);
-            first_run = false;
-            prev_size = set_size.first;
-            for (Eigen::Index sample_id = 0; sample_id < num_sample;
-                 ++sample_id)
+    const Eigen::Index num_set_size =
+        static_cast<Eigen::Index>(set_index.size());
+    const bool run_glm = is_binary && m_perm_info.logit_perm;
+    const size_t num_worker = scheduler.num_thread();
+    const size_t num_perm = m_perm_info.num_permutation;
+    // with the cached background, each task builds the null PRS of a block
+    // of permutations at once. Otherwise the SNP indices are passed to the
+    // genotype object, which keeps the PRS of one set at a time, so each task
+    // is one permutation and the construction of the null PRS is serialized
+    const size_t block_size =
+        cached ? null_set_block_size(static_cast<size_t>(num_set_size),
+                                     target.num_sample(),
+                                     m_matrix_index.size(), num_perm)
+               : 1;
+    const size_t num_block = (num_perm + block_size - 1) / block_size;
+    // each worker has its own selection of background positions, the null
+    // PRS of each permutation and set size (one per column) and the
+    // independent matrix for logistic regression
+    std::vector<std::vector<size_t>> selected(
+        num_worker, std::vector<size_t>(num_background));
+    for (auto&& select : selected)
+    { std::iota(select.begin(), select.end(), 0); }
+    // the swaps of the shuffle and the selected positions of a permutation
+    std::vector<std::vector<size_t>> swap_pos(num_worker,
+                                              std::vector<size_t>(max_size));
+    std::vector<std::vector<size_t>> chosen(num_worker,
+                                            std::vector<size_t>(max_size));
+    std::vector<Eigen::MatrixXd> prs(num_worker);
+    std::vector<Eigen::MatrixXd> independent(
+        num_worker, run_glm ? m_independent_variables : Eigen::MatrixXd());
+    std::vector<Eigen::VectorXd> t_value(num_worker);
+    // the sparse selection matrix, and the buffers of the cached null PRS
+    std::vector<std::vector<size_t>> col_start(num_worker);
+    std::vector<std::vector<size_t>> snp_pos(num_worker);
+    std::vector<std::vector<double>> raw_prs(num_worker);
+    std::vector<std::vector<uint32_t>> raw_num_snp(num_worker);
+    std::vector<std::vector<double>> score(num_worker);
+    std::vector<std::vector<size_t>> select_snp(
+        cached ? 0 : num_worker, std::vector<size_t>(max_size));
+    std::mutex target_mutex;
+    scheduler.run(num_block, [&](size_t block, size_t worker) {
+        const size_t start = block * block_size;
+        const size_t num_in_block = std::min(block_size, num_perm - start);
+        const Eigen::Index num_col =
+            static_cast<Eigen::Index>(num_in_block) * num_set_size;
+        Eigen::MatrixXd& null_prs = prs[worker];
+        null_prs.resize(num_sample, num_col);
+        std::vector<size_t>& select = selected[worker];
+        std::vector<size_t>& swaps = swap_pos[worker];
+        std::vector<size_t>& pick = chosen[worker];
+        col_start[worker].clear();
+        snp_pos[worker].clear();
+        for (size_t i_perm = 0; i_perm < num_in_block; ++i_perm)
+        {
+            Philox4x32 g(m_seed, start + i_perm);
+            // we will shuffle n where n is the set with the largest size
+            // this is the Fisher-Yates shuffle algorithm for random selection
+            // without replacement
+            for (size_t begin = 0; begin < max_size; ++begin)
             {
-                if (m_perm_info.logit_perm && is_binary)
-                {
-                    m_independent_variables(sample_id, 1) =
-                        target.calculate_score(
-                            m_matrix_index[static_cast<size_t>(sample_id)]);
-                }
-                else
-                {
-                    prs(sample_id) = target.calculate_score(
-                        m_matrix_index[static_cast<size_t>(sample_id)]);
-                }
+                std::uniform_int_distribution<size_t> dist(begin,
+                                                           num_background - 1);
+                swaps[begin] = dist(g);
+                std::swap(select[begin], select[swaps[begin]]);
             }
-            ++m_analysis_done;
-            print_progress();
-            //  we can now perform the glm or linear regression analysis
-            if (is_binary && m_perm_info.logit_perm)
+            std::copy(select.begin(),
+                      select.begin() + static_cast<long>(max_size),
+                      pick.begin());
+            // undo the swaps such that every permutation starts from the same
+            // background order without resetting the whole background, and
+            // the selected SNPs only depend on the permutation index
+            for (size_t begin = max_size; begin-- > 0;)
+            { std::swap(select[begin], select[swaps[begin]]); }
+            if (!cached) continue;
+            // each set size only adds the SNPs after the previous set size,
+            // in the order they are read from the genotype file
+            size_t prev_size = 0;
+            for (auto&& set_size : set_index)
             {
-                Regression::glm(m_phenotype, m_independent_variables, obs_p, r2,
-                                coefficient, standard_error, 1);
-                t_value = std::fabs(coefficient / standard_error);
+                std::sort(pick.begin() + static_cast<long>(prev_size),
+                          pick.begin() + static_cast<long>(set_size.first));
+                col_start[worker].push_back(snp_pos[worker].size());
+                snp_pos[worker].insert(
+                    snp_pos[worker].end(),
+                    pick.begin() + static_cast<long>(prev_size),
+                    pick.begin() + static_cast<long>(set_size.first));
+                prev_size = set_size.first;
             }
-            else
+        }
+        if (cached)
+        {
+            col_start[worker].push_back(snp_pos[worker].size());
+            target.null_score_block(col_start[worker], snp_pos[worker],
+                                    static_cast<size_t>(num_set_size),
+                                    raw_prs[worker], raw_num_snp[worker],
+                                    score[worker]);
+            const size_t num_all_sample =
+                score[worker].size() / static_cast<size_t>(num_col);
+            for (Eigen::Index col = 0; col < num_col; ++col)
             {
-                // we will directly use the existing decomposition
-                if (p == rank)
+                const double* cur_score =
+                    &score[worker][static_cast<size_t>(col) * num_all_sample];
+                for (Eigen::Index sample_id = 0; sample_id < num_sample;
+                     ++sample_id)
                 {
-                    beta = PQR.solve(prs);
-                    fitted = X * beta;
+                    null_prs(sample_id, col) = cur_score
+                        [m_matrix_index[static_cast<size_t>(sample_id)]];
                 }
-                else
-                {
-                    beta = Eigen::VectorXd::Constant(
-                        p, std::numeric_limits<double>::quiet_NaN());
-                    effects = PQR.householderQ().adjoint() * prs;
-                    beta.head(rank) = Rinv * effects.head(rank);
-                    beta = Pmat * beta;
-                    effects.tail(num_sample - rank).setZero();
-                    fitted = PQR.householderQ() * effects;
-                }
-                resid = prs - fitted;
-                df = (rank >= 0) ? num_sample - p : num_sample - rank;
-                double s = resid.norm() / std::sqrt(double(df));
-                se = s * se_base;
-                standard_error = se(1);
-                t_value = std::fabs(beta(1) / standard_error);
             }
-            // set_size second contain the indexs to each set with this size
-            for (auto&& set_index : set_size.second)
-            { set_perm_res[set_index] += (obs_t_value[set_index] < t_value); }
         }
-        ++processed;
-    }
-}
-
-void PRSice::produce_null_prs(
-    Thread_Queue<std::pair<std::vector<double>, size_t>>& q, Genotype& target,
-    const size_t& num_background, std::vector<size_t> background,
-    size_t num_consumer, std::map<size_t, std::vector<size_t>>& set_index)
-{
-    // we need to know the size of the biggest set
-    const size_t max_size = set_index.rbegin()->first;
-    const size_t num_sample = m_matrix_index.size();
-    const size_t num_regress_sample =
-        static_cast<size_t>(m_independent_variables.rows());
-    size_t processed = 0;
-    size_t prev_size = 0;
-    size_t r;
-    // we seed the random number generator
-    std::mt19937 g(m_seed);
-    bool first_run = true;
-    std::vector<size_t>::size_type advance_index, begin;
-    while (processed < m_perm_info.num_permutation)
-    {
-        // here we perform random sampling without replacement using the
-        // Fisher-Yates shuffle algorithm
-        begin = 0;
-        size_t num_snp = max_size;
-        while (num_snp--)
-        {
-            std::uniform_int_distribution<int> dist(
-                static_cast<int>(begin), static_cast<int>(num_background) - 1);
-            r = background[begin];
-            advance_index = static_cast<size_t>(dist(g));
-            background[begin] = background[advance_index];
-            background[advance_index] = r;
-            ++begin;
-        }
-        first_run = true;
-        prev_size = 0;
-        for (auto&& set_size : set_index)
-        {
-            // for each gene sets size, we calculate the PRS
-            target.get_null_score(set_size.first, prev_size, background,
-                                  first_run);
-            first_run = false;
-            // we need to know how many SNPs we have already read, such that
-            // we can skip reading this number of SNPs for the next set
-            prev_size = set_size.first;
-            // we store the PRS in a new vector to avoid crazy error with
-            // move semetics and stuff which I have not fully understand
-            std::vector<double> prs(num_regress_sample, 0);
-            for (size_t sample_id = 0; sample_id < num_sample; ++sample_id)
+        else
+        {
+            std::vector<size_t>& snp = select_snp[worker];
+            for (size_t i = 0; i < max_size; ++i)
+            { snp[i] = background[pick[i]]; }
+            std::lock_guard<std::mutex> lock(target_mutex);
+            bool first_run = true;
+            size_t prev_size = 0;
+            Eigen::Index col = 0;
+            for (auto&& set_size : set_index)
             {
-                // propagate the prs vector
-                prs[sample_id] =
-                    target.calculate_score(m_matrix_index[sample_id]);
+                target.get_null_score(set_size.first, prev_size, snp,
+                                      first_run);
+                first_run = false;
+                prev_size = set_size.first;
+                for (Eigen::Index sample_id = 0; sample_id < num_sample;
+                     ++sample_id)
+                {
+                    null_prs(sample_id, col) = target.calculate_score(
+                        m_matrix_index[static_cast<size_t>(sample_id)]);
+                }
+                ++col;
             }
-            // then we push the result prs to the queue, which can then
-            // picked up by the consumers
-            q.emplace(std::make_pair(prs, set_size.first), num_consumer);
-            ++m_analysis_done;
+        }
+        {
+            std::lock_guard<std::mutex> lock(target_mutex);
+            m_analysis_done +=
+                static_cast<uint32_t>(num_in_block * set_index.size());
             print_progress();
         }
-        ++processed;
-    }
-    // send termination signal to the consumers
-    q.completed();
-}
-
-
-void PRSice::consume_prs(
-    Thread_Queue<std::pair<std::vector<double>, size_t>>& q,
-    const Eigen::MatrixXd& X,
-    const Eigen::ColPivHouseholderQR<Eigen::MatrixXd>& PQR,
-    const Eigen::ColPivHouseholderQR<Eigen::MatrixXd>::PermutationType& Pmat,
-    const Eigen::MatrixXd& Rinv,
-    std::map<size_t, std::vector<size_t>>& set_index,
-    std::vector<double>& obs_t_value,
-    std::vector<std::atomic<size_t>>& set_perm_res, const bool is_binary)
-{
-    const Eigen::Index num_regress_sample =
-        static_cast<Eigen::Index>(m_matrix_index.size());
-    const Eigen::Index p = m_independent_variables.cols();
-    const Eigen::Index rank = PQR.rank();
-    Eigen::MatrixXd independent;
-    if (m_perm_info.logit_perm && is_binary)
-        independent = m_independent_variables;
-    Eigen::VectorXd beta, se, effects, prs, fitted, resid, se_base;
-    get_se_matrix(PQR, Pmat, Rinv, p, rank, se_base);
-    Eigen::Index df;
-    // to avoid false sharing and frequent lock, we wil first store all
-    // permutation results within a temporary vector
-    double coefficient, standard_error, r2;
-    double obs_p = 2.0; // for safety reason, make sure it is out bound
-    // results from queue will be stored in the prs_info
-    std::pair<std::vector<double>, size_t> prs_info;
-    // now listen for producer
-    while (!q.pop(prs_info))
-    {
-        // update the independent variable matrix with the new PRS
-        if (is_binary && m_perm_info.logit_perm)
-        {
-            for (Eigen::Index i_sample = 0; i_sample < num_regress_sample;
-                 ++i_sample)
+        //  we can now perform the glm or linear regression analysis
+        Eigen::VectorXd& t = t_value[worker];
+        if (run_glm)
+        {
+            double coefficient, standard_error, r2, obs_p;
+            t.resize(num_col);
+            for (Eigen::Index i = 0; i < num_col; ++i)
             {
-                independent(i_sample, 1) =
-                    std::get<0>(prs_info)[static_cast<size_t>(i_sample)];
+                independent[worker].col(1) = null_prs.col(i);
+                Regression::glm(m_phenotype, independent[worker], obs_p, r2,
+                                coefficient, standard_error, 1);
+                t(i) = std::fabs(coefficient / standard_error);
             }
-            Regression::glm(m_phenotype, independent, obs_p, r2, coefficient,
-                            standard_error, 1);
         }
         else
         {
-            prs = Eigen::Map<Eigen::VectorXd>(
-                std::get<0>(prs_info).data(),
-                static_cast<Eigen::Index>(num_regress_sample));
-            if (p == rank)
-            {
-                beta = PQR.solve(prs);
-                fitted = X * beta;
-            }
-            else
-            {
-                effects = PQR.householderQ().adjoint() * prs;
-                beta = Eigen::VectorXd::Constant(
-                    p, std::numeric_limits<double>::quiet_NaN());
-                beta.head(rank) = Rinv * effects.head(rank);
-                beta = Pmat * beta;
-                effects.tail(num_regress_sample - rank).setZero();
-                fitted = PQR.householderQ() * effects;
-            }
-            resid = prs - fitted;
-            df = (rank >= 0) ? num_regress_sample - p
-                             : num_regress_sample - rank;
-            double s = resid.norm() / std::sqrt(double(df));
-            se = s * se_base;
-            standard_error = se(1);
-            coefficient = beta(1);
+            // all permutations and set sizes of the block are regressed on
+            // the same decomposition at once
+            Regression::fastLm_block(PQR, se_base, null_prs, 1, t);
         }
-        double t_value = std::fabs(coefficient / standard_error);
-        auto&& index = set_index[std::get<1>(prs_info)];
-        // we register the number of time a more significant / bigger
-        // t-value is obtained when compared to the observed t-value
-        for (auto&& ref : index)
+        Eigen::Index col = 0;
+        for (size_t i_perm = 0; i_perm < num_in_block; ++i_perm)
         {
-            // in theory because set_perm_res is now atomic, it should be ok
-            if (obs_t_value[ref] < t_value) set_perm_res[ref]++;
+            for (auto&& set_size : set_index)
+            {
+                // set_size second contain the indexs to each set with this
+                // size
+                for (auto&& idx : set_size.second)
+                { set_perm_res[idx] += (obs_t_value[idx] < t(col)); }
+                ++col;
+            }
         }
-    }
+    });
+}
+
+size_t PRSice::null_set_block_size(const size_t num_set_size,
+                                   const size_t num_target_sample,
+                                   const size_t num_regress_sample,
+                                   const size_t num_perm)
+{
+    // the block holds the raw and final null PRS of all target samples, and
+    // the null PRS of the regression samples
+    const size_t bytes_per_perm =
+        num_set_size
+        * ((2 * sizeof(double) + sizeof(uint32_t)) * num_target_sample
+           + sizeof(double) * num_regress_sample);
+    size_t block_size =
+        MAX_PERM_BLOCK_BYTES / std::max<size_t>(bytes_per_perm, 1);
+    block_size = std::min<size_t>(block_size, PERM_BLOCK_SIZE);
+    block_size = std::min(block_size, num_perm);
+    return std::max<size_t>(block_size, 1);
 }
 
 void PRSice::run_competitive(
@@ -2405,17 +2268,15 @@ void PRSice::run_competitive(
         }
     }
     Eigen::ColPivHouseholderQR<Eigen::MatrixXd> PQR;
-    Eigen::ColPivHouseholderQR<Eigen::MatrixXd>::PermutationType Pmat;
     Eigen::Index rank;
     const Eigen::Index p = m_independent_variables.cols();
     Eigen::MatrixXd Rinv;
-    Eigen::MatrixXd YCov;
-    if (!m_perm_info.logit_perm)
+    Eigen::VectorXd se_base;
+    if (!is_binary || !m_perm_info.logit_perm)
     {
-        YCov = m_independent_variables;
+        Eigen::MatrixXd YCov = m_independent_variables;
         YCov.col(1) = m_phenotype;
         PQR.compute(YCov);
-        Pmat = PQR.colsPermutation();
         rank = PQR.rank();
         if (rank != p)
         {
@@ -2424,6 +2285,7 @@ void PRSice::run_competitive(
                        .triangularView<Eigen::Upper>()
                        .solve(Eigen::MatrixXd::Identity(rank, rank));
         }
+        get_se_matrix(PQR, PQR.colsPermutation(), Rinv, p, rank, se_base);
     }
     m_printed_warning = true;
     for (size_t i = 0; i < num_prs_res; ++i)
@@ -2469,13 +2331,27 @@ void PRSice::run_competitive(
     const uintptr_t num_regress_sample =
         static_cast<uintptr_t>(m_independent_variables.rows());
 
+    // score each background SNP once, such that the null PRS no longer
+    // require reading the genotypes in every permutation. The cache is
+    // allocated before checking the memory available to the workers
+    const std::vector<size_t> background(bk_start_idx, bk_end_idx);
+    const bool cached = target.cache_background(background);
+    if (!cached)
+    {
+        m_reporter->report("Insufficient memory to cache the background SNPs, "
+                           "will read the genotypes in every permutation");
+    }
     // This is a rough estimate, we might be using more memory than
-    // indicated here
+    // indicated here. Every worker also keeps a copy of the background and
+    // the null PRS of each set size, and with the cache, the buffers of a
+    // block of permutations
     const uintptr_t basic_memory_required_per_thread =
-        m_perm_info.logit_perm ? (
-            4 * num_regress_sample + 2ULL * static_cast<unsigned long long>(p)
-            + 1ULL + num_regress_sample * static_cast<unsigned long long>(p))
-                               : num_regress_sample;
+        (m_perm_info.logit_perm ? (
+             4 * num_regress_sample + 2ULL * static_cast<unsigned long long>(p)
+             + 1ULL + num_regress_sample * static_cast<unsigned long long>(p))
+                                : num_regress_sample)
+        + num_regress_sample * set_index.size() + num_bk_snps
+        + (cached ? MAX_PERM_BLOCK_BYTES / sizeof(double) : 0);
 
     for (; num_thread > 0; --num_thread)
     {
@@ -2493,6 +2369,7 @@ void PRSice::run_competitive(
     }
     if (num_thread == 0)
     {
+        target.release_background();
         fprintf(stderr, "\n");
         throw std::runtime_error(
             "(DEBUG) Error: Not enough memory left for permutation. "
@@ -2502,41 +2379,11 @@ void PRSice::run_competitive(
     }
     m_reporter->report("Running permutation with " + misc::to_string(num_thread)
                        + " threads");
-    if (num_thread > 1)
-    {
-        //  similar to permutation for empirical p-value calculation, we
-        //  employ the producer consumer pattern where one thread is
-        //  responsible for reading in the PRS and construct the required
-        //  independent variable and other threads are responsible for the
-        //  calculation
-        Thread_Queue<std::pair<std::vector<double>, size_t>> set_perm_queue;
-        std::thread producer(&PRSice::produce_null_prs, this,
-                             std::ref(set_perm_queue), std::ref(target),
-                             std::cref(num_bk_snps),
-                             std::vector<size_t>(bk_start_idx, bk_end_idx),
-                             num_thread - 1, std::ref(set_index));
-        std::vector<std::thread> consumer_store;
-        for (int i_thread = 0; i_thread < num_thread - 1; ++i_thread)
-        {
-            consumer_store.push_back(std::thread(
-                &PRSice::consume_prs, this, std::ref(set_perm_queue),
-                std::cref(YCov), std::cref(PQR), std::cref(Pmat),
-                std::cref(Rinv), std::ref(set_index), std::ref(obs_t_value),
-                std::ref(set_perm_res), is_binary));
-        }
-
-        producer.join();
-        for (auto&& thread : consumer_store) thread.join();
-    }
-    else
-    {
-        // alternatively, if we only got one thread, we will use the no
-        // thread function to reduce threading overhead
-        null_set_no_thread(target, num_bk_snps,
-                           std::vector<size_t>(bk_start_idx, bk_end_idx),
-                           set_index, YCov, PQR, Pmat, Rinv, obs_t_value,
-                           set_perm_res, is_binary);
-    }
+    // each permutation is a task, which selects its own background SNPs
+    Task_Scheduler scheduler(static_cast<size_t>(num_thread));
+    null_set_perm(scheduler, target, background, set_index, PQR, se_base,
+                  obs_t_value, set_perm_res, is_binary, cached);
+    target.release_background();
     // start_index is the index of m_prs_summary[i], not the actual index
     // on set_perm_res.
     // this will iterate all sets from beginning of current phenotype
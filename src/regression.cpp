@@ -66,4 +66,117 @@ void fastLm(const Eigen::VectorXd& y, const Eigen::MatrixXd& X, double& p_value,
     p_value = misc::calc_tprob(tval, n);
 }
 
+void factor_covariates(const Eigen::VectorXd& y, const Eigen::MatrixXd& X,
+                       CovariateQR& cov_qr, int thread)
+{
+    Eigen::setNbThreads(thread);
+    const Eigen::Index n = X.rows();
+    if (n != y.rows()) { throw std::runtime_error("Error: Size mismatch"); }
+    // the covariate block contains the intercept (column 0) and all
+    // covariates (column 2 onward)
+    Eigen::MatrixXd Z(n, X.cols() - 1);
+    Z.col(0) = X.col(0);
+    if (X.cols() > 2) { Z.rightCols(X.cols() - 2) = X.rightCols(X.cols() - 2); }
+    Eigen::ColPivHouseholderQR<Eigen::MatrixXd> PQR(Z);
+    const Eigen::Index rank = PQR.rank();
+    cov_qr.Q = PQR.householderQ() * Eigen::MatrixXd::Identity(n, rank);
+    cov_qr.resid_y = y - cov_qr.Q * (cov_qr.Q.transpose() * y);
+    cov_qr.tss = (y.array() - y.mean()).square().sum();
+    cov_qr.num_col = X.cols();
+}
+
+void fastLm_covariate_block(const CovariateQR& cov_qr,
+                            const Eigen::MatrixXd& prs, CovariateFit& fit)
+{
+    const Eigen::Index n = prs.rows();
+    const Eigen::Index num_prs = prs.cols();
+    if (n != cov_qr.resid_y.rows())
+    { throw std::runtime_error("Error: Size mismatch"); }
+    // by Frisch-Waugh-Lovell, the PRS coefficient of the full model equals
+    // the coefficient from regressing the residualized phenotype on the
+    // residualized PRS
+    const Eigen::MatrixXd resid_x =
+        prs - cov_qr.Q * (cov_qr.Q.transpose() * prs);
+    const Eigen::VectorXd sxy = resid_x.transpose() * cov_qr.resid_y;
+    const Eigen::Index df = n - cov_qr.num_col;
+    fit.p_value.resize(num_prs);
+    fit.r2.resize(num_prs);
+    fit.r2_adjust.resize(num_prs);
+    fit.coeff.resize(num_prs);
+    fit.standard_error.resize(num_prs);
+    fit.estimable.assign(static_cast<size_t>(num_prs), false);
+    for (Eigen::Index i = 0; i < num_prs; ++i)
+    {
+        const double sxx = resid_x.col(i).squaredNorm();
+        // also reject non-finite PRS, leaving them to the full regression
+        if (!(sxx
+              > std::numeric_limits<double>::epsilon()
+                    * prs.col(i).squaredNorm()))
+        { continue; }
+        fit.estimable[static_cast<size_t>(i)] = true;
+        const double coeff = sxy(i) / sxx;
+        const double rss =
+            (cov_qr.resid_y - coeff * resid_x.col(i)).squaredNorm();
+        const double se = std::sqrt(rss / static_cast<double>(df) / sxx);
+        fit.coeff(i) = coeff;
+        fit.standard_error(i) = se;
+        fit.r2(i) = 1.0 - rss / cov_qr.tss;
+        fit.r2_adjust(i) =
+            1.0 - (1.0 - fit.r2(i)) * (static_cast<double>(n - 1) / df);
+        fit.p_value(i) = misc::calc_tprob(coeff / se, n);
+    }
+}
+
+bool fastLm_covariate(const CovariateQR& cov_qr, const Eigen::VectorXd& prs,
+                      double& p_value, double& r2, double& r2_adjust,
+                      double& coeff, double& standard_error)
+{
+    CovariateFit fit;
+    fastLm_covariate_block(cov_qr, prs, fit);
+    if (!fit.estimable.front()) return false;
+    p_value = fit.p_value(0);
+    r2 = fit.r2(0);
+    r2_adjust = fit.r2_adjust(0);
+    coeff = fit.coeff(0);
+    standard_error = fit.standard_error(0);
+    return true;
+}
+
+void fastLm_block(const Eigen::ColPivHouseholderQR<Eigen::MatrixXd>& PQR,
+                  const Eigen::VectorXd& se_base, const Eigen::MatrixXd& Y,
+                  const Eigen::Index coeff_idx, Eigen::VectorXd& t_value)
+{
+    const Eigen::Index n = PQR.rows();
+    const Eigen::Index p = PQR.cols();
+    const Eigen::Index rank = PQR.rank();
+    if (n != Y.rows()) { throw std::runtime_error("Error: Size mismatch"); }
+    t_value.resize(Y.cols());
+    // locate the coefficient within the pivoted decomposition. It is not
+    // estimable if it was pivoted out of the leading rank columns
+    const auto& indices = PQR.colsPermutation().indices();
+    Eigen::Index pivot = 0;
+    while (pivot < p && indices(pivot) != coeff_idx) ++pivot;
+    if (pivot >= rank)
+    {
+        t_value.setConstant(std::numeric_limits<double>::quiet_NaN());
+        return;
+    }
+    // the householder reflectors are applied in blocks, which turns this into
+    // a matrix-matrix product over all phenotypes
+    const Eigen::MatrixXd effects = PQR.householderQ().adjoint() * Y;
+    const Eigen::MatrixXd coef = PQR.matrixQR()
+                                     .topLeftCorner(rank, rank)
+                                     .triangularView<Eigen::Upper>()
+                                     .solve(effects.topRows(rank));
+    // Q is orthogonal, so the residual norm is the norm of the effects that
+    // are not explained by the independent variables
+    const double df = static_cast<double>(n - p);
+    for (Eigen::Index i = 0; i < Y.cols(); ++i)
+    {
+        const double s =
+            std::sqrt(effects.col(i).tail(n - rank).squaredNorm() / df);
+        t_value(i) = std::fabs(coef(pivot, i) / (s * se_base(coeff_idx)));
+    }
+}
+
 }
@@ -16,8 +16,6 @@
 
 #include "snp.hpp"
 
-SNP::~SNP() {}
-
 std::vector<size_t> SNP::sort_by_p_chr(const std::vector<SNP>& input)
 {
     std::vector<size_t> idx(input.size());
@@ -36,7 +34,7 @@ std::vector<size_t> SNP::sort_by_p_chr(const std::vector<SNP>& input)
                 // but as they are double, there might be problem
                 // (have tried to use stat and that cause seg fault)
                 if (input[i1].m_loc == input[i2].m_loc)
-                    return input[i1].m_rs < input[i2].m_rs;
+                    return std::strcmp(input[i1].m_rs, input[i2].m_rs) < 0;
                 return input[i1].m_loc < input[i2].m_loc;
             }
             else
@@ -0,0 +1,136 @@
+// This file is part of PRSice-2, copyright (C) 2016-2019
+// Shing Wan Choi, Paul F. O’Reilly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Benchmark of the genotype decoding used by Genotype::read_prs, comparing
+// the scalar kernel against the dispatched (AVX2 when available) kernel.
+// Usage: decodePRSBenchmark [number of genotypes per run, default 200000000]
+#include "genotype.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace
+{
+double seconds_since(const std::chrono::steady_clock::time_point& start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now()
+                                         - start)
+        .count();
+}
+
+class DecodeBenchmark : public Genotype
+{
+public:
+    DecodeBenchmark(const size_t sample_ct, const double miss_rate,
+                    const size_t num_snp)
+    {
+        m_sample_ct = sample_ct;
+        m_unfiltered_sample_ct = sample_ct;
+        m_prs_score.assign(sample_ct, 0.0);
+        m_prs_num_snp.assign(sample_ct, 0);
+        const size_t num_word = QUATERCT_TO_WORDCT(sample_ct);
+        // a small pool of SNPs is cycled through, so that the genotype stays
+        // in cache and only the decoding is measured
+        const size_t pool = std::min<size_t>(num_snp, 16);
+        m_genotype.assign(pool * num_word, 0);
+        std::mt19937 rand_gen(1234);
+        std::uniform_real_distribution<double> unif(0.0, 1.0);
+        // PLINK code of hom common, het and hom rare. 1 is missing
+        const uintptr_t plink_code[3] = {3, 2, 0};
+        for (size_t i_snp = 0; i_snp < pool; ++i_snp)
+        {
+            uintptr_t* geno = &m_genotype[i_snp * num_word];
+            for (size_t i = 0; i < sample_ct; ++i)
+            {
+                uintptr_t code = 1;
+                if (unif(rand_gen) >= miss_rate)
+                { code = plink_code[static_cast<size_t>(unif(rand_gen) * 3)]; }
+                geno[i / BITCT2] |= code << ((i % BITCT2) * 2);
+            }
+        }
+        m_num_word = num_word;
+        m_pool = pool;
+    }
+    double run(const size_t num_snp, const bool simd)
+    {
+        const double prs_lut[4] = {0.0, 0.12, 0.05, 0.24};
+        const uint32_t count_lut[4] = {2, 2, 1, 2};
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i_snp = 0; i_snp < num_snp; ++i_snp)
+        {
+            const uintptr_t* geno =
+                &m_genotype[(i_snp % m_pool) * m_num_word];
+            if (simd)
+            {
+                read_prs(geno, 0, m_sample_ct, 2, 0.12, 0.0, 0.05, 1, 0, 1, 2,
+                         i_snp != 0);
+            }
+            else if (i_snp != 0)
+            {
+                decode_prs<true>(geno, 0, m_sample_ct, prs_lut, count_lut);
+            }
+            else
+            {
+                decode_prs<false>(geno, 0, m_sample_ct, prs_lut, count_lut);
+            }
+        }
+        return seconds_since(start);
+    }
+    double checksum() const
+    {
+        double sum = 0;
+        for (size_t i = 0; i < m_sample_ct; ++i)
+        { sum += m_prs_score[i] + m_prs_num_snp[i]; }
+        return sum;
+    }
+
+private:
+    std::vector<uintptr_t> m_genotype;
+    size_t m_num_word = 0;
+    size_t m_pool = 0;
+};
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    size_t num_genotype = 200000000;
+    if (argc > 1) num_genotype = std::strtoull(argv[1], nullptr, 10);
+    fprintf(stderr, "%10s %8s %12s %12s %8s\n", "Samples", "Missing",
+            "Scalar(G/s)", "SIMD(G/s)", "Speedup");
+    int mismatch = 0;
+    for (auto&& sample_ct : {1000, 10000, 100000, 1000000})
+    {
+        for (auto&& miss_rate : {0.0, 0.05, 0.5})
+        {
+            const size_t num_snp =
+                std::max<size_t>(1, num_genotype / sample_ct);
+            DecodeBenchmark bench(sample_ct, miss_rate, num_snp);
+            const double scalar_time = bench.run(num_snp, false);
+            const double scalar_sum = bench.checksum();
+            const double simd_time = bench.run(num_snp, true);
+            // both kernels add the same values in the same order
+            mismatch += (scalar_sum != bench.checksum());
+            const double total = static_cast<double>(num_snp)
+                                 * static_cast<double>(sample_ct) / 1e9;
+            fprintf(stderr, "%10d %8.2f %12.3f %12.3f %8.2f\n", sample_ct,
+                    miss_rate, total / scalar_time, total / simd_time,
+                    scalar_time / simd_time);
+        }
+    }
+    return mismatch;
+}
@@ -0,0 +1,123 @@
+// This file is part of PRSice-2, copyright (C) 2016-2019
+// Shing Wan Choi, Paul F. O’Reilly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Benchmark of the 3x3 genotype count used by the LD calculation, comparing
+// one genovec_3freq pass per index genotype mask against the dispatched
+// Genotype::genovec_3x3freq (AVX2 or popcnt when available).
+// Usage: ldCountBenchmark [number of founder genotypes per run,
+//                          default 2000000000]
+#include "genotype.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+namespace
+{
+double seconds_since(const std::chrono::steady_clock::time_point& start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now()
+                                         - start)
+        .count();
+}
+
+class CountBenchmark : public Genotype
+{
+public:
+    explicit CountBenchmark(const size_t founder_ct)
+        : m_founder_ctl2(QUATERCT_TO_WORDCT(founder_ct))
+        , m_founder_ctv2(QUATERCT_TO_ALIGNED_WORDCT(founder_ct))
+    {
+        std::mt19937 rand_gen(1357);
+        std::uniform_int_distribution<uintptr_t> dist;
+        std::vector<uintptr_t> founder_include2(m_founder_ctv2, 0);
+        fill_quatervec_55(static_cast<uint32_t>(founder_ct),
+                          founder_include2.data());
+        std::vector<uintptr_t> index_geno(m_founder_ctv2, 0);
+        // a small pool of window SNPs is cycled through, so that the
+        // genotype stays in cache and only the counting is measured
+        m_window.assign(POOL * m_founder_ctv2, 0);
+        for (size_t i = 0; i < m_founder_ctl2; ++i)
+        {
+            index_geno[i] = dist(rand_gen);
+            for (size_t j = 0; j < POOL; ++j)
+            { m_window[j * m_founder_ctv2 + i] = dist(rand_gen); }
+        }
+        m_index_data.assign(3 * m_founder_ctv2, 0);
+        std::vector<uintptr_t> index_tots(6, 0);
+        update_index_tot(m_founder_ctl2, m_founder_ctv2,
+                         static_cast<uintptr_t>(founder_ct), m_index_data,
+                         index_tots, founder_include2, index_geno.data());
+    }
+    double run(const size_t num_snp, const bool fused, uint64_t& checksum)
+    {
+        uint32_t counts[9];
+        checksum = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i_snp = 0; i_snp < num_snp; ++i_snp)
+        {
+            const uintptr_t* geno = &m_window[(i_snp % POOL) * m_founder_ctv2];
+            if (fused)
+            {
+                genovec_3x3freq(geno, m_index_data.data(), m_founder_ctl2,
+                                m_founder_ctv2, counts);
+            }
+            else
+            {
+                for (size_t k = 0; k < 3; ++k)
+                {
+                    genovec_3freq(geno, &(m_index_data[k * m_founder_ctv2]),
+                                  m_founder_ctl2, &(counts[3 * k]),
+                                  &(counts[3 * k + 1]), &(counts[3 * k + 2]));
+                }
+            }
+            for (size_t k = 0; k < 9; ++k) checksum += counts[k];
+        }
+        return seconds_since(start);
+    }
+
+private:
+    static const size_t POOL = 16;
+    std::vector<uintptr_t> m_window;
+    std::vector<uintptr_t> m_index_data;
+    uintptr_t m_founder_ctl2;
+    uintptr_t m_founder_ctv2;
+};
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    size_t num_genotype = 2000000000;
+    if (argc > 1) num_genotype = std::strtoull(argv[1], nullptr, 10);
+    fprintf(stderr, "%10s %14s %14s %8s\n", "Founders", "3 pass(G/s)",
+            "Fused(G/s)", "Speedup");
+    int mismatch = 0;
+    for (auto&& founder_ct : {500, 5000, 50000, 500000})
+    {
+        const size_t num_snp = std::max<size_t>(1, num_genotype / founder_ct);
+        CountBenchmark bench(founder_ct);
+        uint64_t expected, checksum;
+        const double pass_time = bench.run(num_snp, false, expected);
+        const double fused_time = bench.run(num_snp, true, checksum);
+        mismatch += (expected != checksum);
+        const double total = static_cast<double>(num_snp)
+                             * static_cast<double>(founder_ct) / 1e9;
+        fprintf(stderr, "%10d %14.3f %14.3f %8.2f\n", founder_ct,
+                total / pass_time, total / fused_time, pass_time / fused_time);
+    }
+    return mismatch;
+}
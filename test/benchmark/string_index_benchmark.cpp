@@ -0,0 +1,92 @@
+// This file is part of PRSice-2, copyright (C) 2016-2019
+// Shing Wan Choi, Paul F. O’Reilly
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Benchmark of the StringIndex used for m_existed_snps_index.
+// Usage: stringIndexBenchmark [number of IDs, default 20000000]
+#include "arena.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace
+{
+double seconds_since(const std::chrono::steady_clock::time_point& start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now()
+                                         - start)
+        .count();
+}
+// mix rsIDs with chr:bp:a1:a2 IDs, as found in most base files
+std::string make_id(const size_t i)
+{
+    if (i % 4 == 3)
+    {
+        return std::to_string(i % 22 + 1) + ":" + std::to_string(i * 7)
+               + ":A:G";
+    }
+    return "rs" + std::to_string(i);
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    size_t num_id = 20000000;
+    if (argc > 1) num_id = std::strtoull(argv[1], nullptr, 10);
+    std::vector<std::string> ids;
+    ids.reserve(num_id);
+    for (size_t i = 0; i < num_id; ++i) ids.push_back(make_id(i));
+
+    StringIndex index;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < num_id; ++i) index.insert(ids[i], i);
+    const double build_time = seconds_since(start);
+
+    // look up in a different order than the insertion to avoid measuring
+    // only the cache friendly case
+    size_t found = 0;
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0, j = 0; i < num_id; ++i)
+    {
+        found += (index.find(ids[j]) == j);
+        j += 7919;
+        if (j >= num_id) j -= num_id;
+    }
+    const double hit_time = seconds_since(start);
+    // IDs that are not in the index, e.g. target variants missing from base
+    size_t missed = 0;
+    std::string miss_id;
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < num_id; ++i)
+    {
+        miss_id = ids[i];
+        miss_id.push_back('x');
+        missed += (index.find(miss_id) == ~size_t(0));
+    }
+    const double miss_time = seconds_since(start);
+
+    fprintf(stderr, "IDs:              %zu\n", num_id);
+    fprintf(stderr, "Build:            %.3f s\n", build_time);
+    fprintf(stderr, "Lookup (hit):     %.2f M/s (%zu found)\n",
+            static_cast<double>(num_id) / hit_time / 1e6, found);
+    fprintf(stderr, "Lookup (miss):    %.2f M/s (%zu missed)\n",
+            static_cast<double>(num_id) / miss_time / 1e6, missed);
+    fprintf(stderr, "Bytes per entry:  %.1f\n",
+            static_cast<double>(index.memory_usage())
+                / static_cast<double>(index.size()));
+    return (found == num_id && missed == num_id) ? 0 : 1;
+}
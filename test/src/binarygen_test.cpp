@@ -4,6 +4,7 @@
 #include "global.hpp"
 #include "gtest/gtest.h"
 #include <string>
+#include <vector>
 
 
 TEST(SAMPLE_FILE_CHECK, CHECK_SAMPLE_FILE)
@@ -26,4 +27,80 @@ TEST(SAMPLE_FILE_CHECK, CHECK_SAMPLE_FILE)
     ASSERT_FALSE(BinaryGen::check_is_sample_format(
         std::string(path + "invalid.sample.unknown")));
 }
+// only use the per sample functions, so that the bit by bit parser is used
+struct Generic_Probability
+{
+    void initialise(std::size_t, std::size_t) {}
+    bool set_sample(std::size_t) { return true; }
+    void set_number_of_entries(std::size_t, std::size_t, genfile::OrderType,
+                               genfile::ValueType)
+    {
+    }
+    void set_value(uint32_t geno, double value)
+    {
+        if (geno < 2) prob.push_back(value);
+    }
+    void set_value(uint32_t geno, genfile::MissingValue)
+    {
+        if (geno == 0) prob.push_back(-1);
+    }
+    void sample_completed() {}
+    std::vector<double> prob;
+};
+
+struct Diploid_Probability : public Generic_Probability
+{
+    void set_diploid_probabilities(uint32_t num_sample,
+                                   const genfile::byte_t* ploidy,
+                                   const genfile::byte_t* data, int bits)
+    {
+        std::vector<double> homcom(num_sample), het(num_sample);
+        genfile::bgen::v12::decode_diploid_probabilities(
+            data, bits, num_sample, homcom.data(), het.data());
+        for (uint32_t i = 0; i < num_sample; ++i)
+        {
+            if (ploidy[i] & 0x80)
+            {
+                prob.push_back(-1);
+                continue;
+            }
+            prob.push_back(homcom[i]);
+            prob.push_back(het[i]);
+        }
+        ++num_call;
+    }
+    size_t num_call = 0;
+};
+
+TEST(BGEN_V12, DIPLOID_PROBABILITY)
+{
+    genfile::bgen::Context context;
+    context.number_of_samples = 3;
+    context.flags = genfile::bgen::e_Layout2;
+    for (int bits : {8, 16})
+    {
+        // number of sample, number of allele, min and max ploidy, ploidy of
+        // each sample (the second is missing), phased and bits
+        std::vector<genfile::byte_t> block = {3, 0,    0, 0, 2, 0, 2,
+                                              2, 2, 0x82, 2, 0};
+        block.push_back(genfile::byte_t(bits));
+        const std::vector<uint32_t> value = {0, 255, 0, 0, 17, 200};
+        for (auto&& v : value)
+        {
+            const uint32_t scaled = (bits == 8) ? v : v * 257 + 3;
+            block.push_back(genfile::byte_t(scaled & 0xFF));
+            if (bits == 16) block.push_back(genfile::byte_t(scaled >> 8));
+        }
+        Generic_Probability generic;
+        Diploid_Probability diploid;
+        genfile::bgen::v12::parse_probability_data(
+            block.data(), block.data() + block.size(), context, generic);
+        genfile::bgen::v12::parse_probability_data(
+            block.data(), block.data() + block.size(), context, diploid);
+        ASSERT_EQ(diploid.num_call, 1);
+        ASSERT_EQ(generic.prob.size(), 5);
+        // must be identical to the bit by bit parser
+        ASSERT_EQ(diploid.prob, generic.prob);
+    }
+}
 #endif
@@ -61,4 +61,41 @@ TEST(COMMANDER_BASIC, NO_ARG)
         SUCCEED();
     }
 }
+
+TEST(COMMANDER_BASIC, SCORE_BASE_CON_STD)
+{
+    // the score matrix has no phenotype, so con_std must be rejected instead
+    // of silently standardizing on all samples
+    Commander commander;
+    Reporter reporter(std::string(path + "LOG"));
+    const std::string base_name = path + "score_base.txt";
+    std::ofstream base(base_name.c_str());
+    base << "CHR BP SNP A1 A2 P OR\n1 1 rs1 A C 0.05 1.2\n";
+    base.close();
+    std::vector<std::string> args = {"PRSice",
+                                     "--base",
+                                     base_name,
+                                     "--target",
+                                     path + "target",
+                                     "--out",
+                                     path + "score_base",
+                                     "--score-base",
+                                     base_name,
+                                     "--score",
+                                     "con_std"};
+    std::vector<char*> argv;
+    for (auto&& arg : args) argv.push_back(&arg[0]);
+    // getopt keeps its position from earlier tests
+    optind = 0;
+    try
+    {
+        commander.init(static_cast<int>(argv.size()), argv.data(), reporter);
+        FAIL();
+    }
+    catch (const std::runtime_error& e)
+    {
+        ASSERT_NE(std::string(e.what()).find("--score con_std"),
+                  std::string::npos);
+    }
+}
 #endif // COMMANDER_TEST_H
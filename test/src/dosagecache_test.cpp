@@ -0,0 +1,99 @@
+#ifndef DOSAGECACHE_TEST_HPP
+#define DOSAGECACHE_TEST_HPP
+#include "dosagecache.hpp"
+#include "gtest/gtest.h"
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+struct Cache_Probability
+{
+    void initialise(std::size_t, std::size_t) {}
+    void set_included_probabilities(size_t num_sample, const double* homcom,
+                                    const double* het, const char* missing)
+    {
+        for (size_t i = 0; i < num_sample; ++i)
+        {
+            prob.push_back(missing[i] ? -1 : homcom[i]);
+            prob.push_back(missing[i] ? -1 : het[i]);
+        }
+    }
+    void finalise() {}
+    std::vector<double> prob;
+};
+
+// genotype block of 3 diploid samples, where the second one is missing
+std::vector<genfile::byte_t>
+cache_test_block(int bits, const std::vector<uint32_t>& value, bool phased)
+{
+    std::vector<genfile::byte_t> block = {3, 0, 0, 0, 2, 0, 2, 2, 2, 0x82, 2};
+    block.push_back(phased);
+    block.push_back(genfile::byte_t(bits));
+    for (auto&& v : value)
+    {
+        block.push_back(genfile::byte_t(v & 0xFF));
+        if (bits == 16) block.push_back(genfile::byte_t(v >> 8));
+    }
+    return block;
+}
+
+TEST(DOSAGECACHE, ROUND_TRIP)
+{
+    {
+        std::ofstream bgen("DEBUG.bgen");
+        bgen << "Not a bgen file" << std::endl;
+    }
+    genfile::bgen::Context context;
+    context.number_of_samples = 3;
+    context.flags = genfile::bgen::e_Layout2;
+    // exclude the first sample
+    std::vector<uintptr_t> sample_include = {6};
+    const std::vector<DosageCache::Source> sources = {
+        DosageCache::source_info("DEBUG.bgen")};
+    {
+        DosageCache cache;
+        cache.create("DEBUG.dcache", sources, sample_include, 3, 2);
+        ASSERT_TRUE(cache.add_variant(
+            0, 100, context,
+            cache_test_block(8, {255, 0, 0, 0, 51, 102}, false)));
+        ASSERT_FALSE(cache.add_variant(
+            0, 200, context, cache_test_block(8, {255, 0, 0, 0, 0, 0}, true)));
+        ASSERT_TRUE(cache.add_variant(
+            1, 50, context,
+            cache_test_block(16, {0, 65535, 0, 0, 13107, 0}, false)));
+        cache.close();
+    }
+    DosageCache cache;
+    ASSERT_TRUE(cache.load("DEBUG.dcache", sources, sample_include, 3, 2));
+    ASSERT_EQ(cache.num_variant(), 2);
+    ASSERT_EQ(cache.find(0, 200), nullptr);
+    ASSERT_EQ(cache.find(1, 100), nullptr);
+    const DosageCache::Entry* entry = cache.find(0, 100);
+    ASSERT_NE(entry, nullptr);
+    Cache_Probability setter;
+    cache.parse(*entry, setter);
+    entry = cache.find(1, 50);
+    ASSERT_NE(entry, nullptr);
+    cache.parse(*entry, setter);
+    const std::vector<double> expected = {-1, -1, 51.0 / 255.0, 102.0 / 255.0,
+                                          -1, -1, 13107.0 / 65535.0, 0};
+    ASSERT_EQ(setter.prob.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i)
+    { ASSERT_DOUBLE_EQ(setter.prob[i], expected[i]); }
+    // cache is not used for different samples or a modified bgen file
+    std::vector<uintptr_t> other_include = {5};
+    ASSERT_FALSE(cache.load("DEBUG.dcache", sources, other_include, 3, 2));
+    {
+        std::ofstream bgen("DEBUG.bgen", std::ios::app);
+        bgen << "Modified" << std::endl;
+    }
+    const std::vector<DosageCache::Source> modified = {
+        DosageCache::source_info("DEBUG.bgen")};
+    ASSERT_FALSE(cache.load("DEBUG.dcache", modified, sample_include, 3, 2));
+    ASSERT_FALSE(cache.loaded());
+    ASSERT_FALSE(cache.load("DEBUG.missing", sources, sample_include, 3, 2));
+    std::remove("DEBUG.dcache");
+    std::remove("DEBUG.bgen");
+}
+#endif // DOSAGECACHE_TEST_HPP
@@ -117,6 +117,24 @@ TEST_F(GENOTYPE_BASIC, CATEGORY)
     ASSERT_EQ(category, 1);
     ASSERT_DOUBLE_EQ(pthres, 0.06);
 }
+TEST_F(GENOTYPE_BASIC, INIT_MEMORY_MMAP)
+{
+    // memory mapping is only used by the genotype reader when requested
+    std::ofstream out("DEBUG.bed", std::ios::binary);
+    for (size_t i = 0; i < 2500; ++i) out.put(static_cast<char>(i % 251));
+    out.close();
+    m_data_size = 100;
+    Genotype::set_memory(1000, false);
+    init_memory();
+    ASSERT_TRUE(m_genotype_file.view("DEBUG.bed", 0, 100) == nullptr);
+    Genotype::set_memory(1000, true);
+    init_memory();
+    const char* data = m_genotype_file.view("DEBUG.bed", 300, 100);
+    ASSERT_TRUE(data != nullptr);
+    ASSERT_EQ(data[0], static_cast<char>(300 % 251));
+    Genotype::set_memory(static_cast<unsigned long long>(1e10), false);
+    std::remove("DEBUG.bed");
+}
 TEST_F(GENOTYPE_BASIC, BAR_LEVELS)
 {
     unsigned long long category;
@@ -136,4 +154,561 @@ TEST_F(GENOTYPE_BASIC, BAR_LEVELS)
     ASSERT_EQ(category, 7);
     ASSERT_DOUBLE_EQ(pthres, 1);
 }
+TEST_F(GENOTYPE_BASIC, CLUMP_BLOCKS)
+{
+    // SNPs should only be put into a new block when no previous clump window
+    // reaches it, and SNPs within a block keep the p-value order
+    std::vector<size_t> chr = {1, 1, 1, 1, 2, 2};
+    std::vector<size_t> loc = {1, 100, 1000, 1050, 1, 2};
+    std::vector<double> p = {0.5, 0.1, 0.01, 0.2, 0.3, 0.05};
+    for (size_t i = 0; i < chr.size(); ++i)
+    {
+        m_existed_snps.emplace_back(SNP("SNP" + std::to_string(i), chr[i],
+                                        loc[i], "A", "C", 0, p[i], 0, 1,
+                                        m_id_arena, m_allele_table));
+    }
+    build_clump_windows(200);
+    m_sort_by_p_index = SNP::sort_by_p_chr(m_existed_snps);
+    std::vector<std::vector<size_t>> block_snps;
+    build_clump_blocks(block_snps);
+    std::vector<std::vector<size_t>> expected = {{1, 0}, {2, 3}, {5, 4}};
+    ASSERT_EQ(block_snps, expected);
+}
+TEST_F(GENOTYPE_BASIC, READ_PRS_LOOKUP)
+{
+    // the lookup table kernel should match the per-sample genotype decoding
+    // for different sample size and missingness rate
+    const size_t ploidy = 2;
+    const double stat = 0.37, adj_score = 0.05, miss_score = 0.11;
+    const size_t miss_count = 1;
+    std::mt19937 rand_gen(4321);
+    std::uniform_real_distribution<double> unif(0.0, 1.0);
+    for (auto&& sample_ct : {1, 31, 32, 33, 1001})
+    {
+        for (auto&& miss_rate : {0.0, 0.1, 0.9})
+        {
+            m_sample_ct = static_cast<size_t>(sample_ct);
+            m_unfiltered_sample_ct = m_sample_ct;
+            std::vector<uintptr_t> genotype(QUATERCT_TO_WORDCT(m_sample_ct),
+                                            0);
+            std::vector<double> expected_prs(m_sample_ct, 0.0);
+            std::vector<uint32_t> expected_num(m_sample_ct, 0);
+            for (size_t i = 0; i < m_sample_ct; ++i)
+            {
+                // PLINK code: 0 = hom rare, 1 = missing, 2 = het, 3 = hom
+                // common
+                uintptr_t code = 1;
+                double weight = 0;
+                if (unif(rand_gen) >= miss_rate)
+                {
+                    const size_t dosage =
+                        static_cast<size_t>(unif(rand_gen) * 3);
+                    code = (dosage == 0) ? 3 : (dosage == 1 ? 2 : 0);
+                    weight = static_cast<double>(dosage);
+                    expected_prs[i] = 2 * (weight * stat - adj_score);
+                    expected_num[i] = 2 * ploidy;
+                }
+                else
+                {
+                    expected_prs[i] = 2 * miss_score;
+                    expected_num[i] = 2 * miss_count;
+                }
+                genotype[i / BITCT2] |= code << ((i % BITCT2) * 2);
+            }
+            m_prs_score.assign(m_sample_ct, 0.0);
+            m_prs_num_snp.assign(m_sample_ct, 0);
+            read_prs(genotype, ploidy, stat, adj_score, miss_score, miss_count,
+                     0, 1, 2, false);
+            read_prs(genotype, ploidy, stat, adj_score, miss_score, miss_count,
+                     0, 1, 2, true);
+            for (size_t i = 0; i < m_sample_ct; ++i)
+            {
+                ASSERT_DOUBLE_EQ(m_prs_score[i], expected_prs[i]);
+                ASSERT_EQ(m_prs_num_snp[i], expected_num[i]);
+            }
+        }
+    }
+}
+TEST_F(GENOTYPE_BASIC, THREADED_BLOCK_SCORE)
+{
+    // multi-threaded block scoring should give identical score as scoring
+    // each SNP one by one
+    m_sample_ct = 10000;
+    m_unfiltered_sample_ct = m_sample_ct;
+    const size_t word_ct = QUATERCT_TO_WORDCT(m_sample_ct);
+    const size_t num_snp = 37;
+    const size_t ploidy = 2;
+    std::mt19937 rand_gen(1234);
+    std::uniform_int_distribution<uintptr_t> dist;
+    std::vector<uintptr_t> block(word_ct * num_snp);
+    for (auto&& w : block) { w = dist(rand_gen); }
+    std::vector<SNPScoreWeight> weights;
+    std::uniform_real_distribution<double> stat_dist(-1.0, 1.0);
+    for (size_t i = 0; i < num_snp; ++i)
+    {
+        weights.push_back(SNPScoreWeight {stat_dist(rand_gen), 0.1, 0.3, 0, 1,
+                                          2, ploidy, i != 0});
+    }
+    m_prs_score.assign(m_sample_ct, 0.0);
+    m_prs_num_snp.assign(m_sample_ct, 0);
+    std::vector<uintptr_t> genotype(word_ct);
+    for (size_t i = 0; i < num_snp; ++i)
+    {
+        std::copy(block.begin() + static_cast<long>(i * word_ct),
+                  block.begin() + static_cast<long>((i + 1) * word_ct),
+                  genotype.begin());
+        auto&& w = weights[i];
+        read_prs(genotype, ploidy, w.stat, w.adj_score, w.miss_score,
+                 w.miss_count, w.homcom_weight, w.het_weight, w.homrar_weight,
+                 w.not_first);
+    }
+    std::vector<double> expected_prs = m_prs_score;
+    std::vector<uint32_t> expected_num = m_prs_num_snp;
+    m_prs_score.assign(m_sample_ct, 0.0);
+    m_prs_num_snp.assign(m_sample_ct, 0);
+    m_prs_calculation.thread = 3;
+    score_block(block, weights, word_ct, ploidy);
+    for (size_t i = 0; i < m_sample_ct; ++i)
+    {
+        ASSERT_EQ(m_prs_score[i], expected_prs[i]);
+        ASSERT_EQ(m_prs_num_snp[i], expected_num[i]);
+    }
+}
+TEST_F(GENOTYPE_BASIC, GATHER_BLOCK_SCORE)
+{
+    // scoring the unfiltered genotype through the gather table should give
+    // identical score as scoring the sample subsetted genotype
+    m_unfiltered_sample_ct = 30001;
+    const size_t unfiltered_word_ct =
+        QUATERCT_TO_WORDCT(m_unfiltered_sample_ct);
+    const size_t num_snp = 23;
+    const size_t ploidy = 2;
+    std::mt19937 rand_gen(5678);
+    std::uniform_int_distribution<uintptr_t> dist;
+    std::uniform_real_distribution<double> unif(0.0, 1.0);
+    m_sample_include.assign(BITCT_TO_WORDCT(m_unfiltered_sample_ct), 0);
+    m_sample_ct = 0;
+    for (size_t i = 0; i < m_unfiltered_sample_ct; ++i)
+    {
+        if (unif(rand_gen) < 0.4)
+        {
+            SET_BIT(i, m_sample_include.data());
+            ++m_sample_ct;
+        }
+    }
+    init_sample_gather();
+    ASSERT_EQ(m_sample_gather.size(), m_sample_ct);
+    std::vector<uintptr_t> block(unfiltered_word_ct * num_snp);
+    for (auto&& w : block) { w = dist(rand_gen); }
+    std::vector<SNPScoreWeight> weights;
+    std::uniform_real_distribution<double> stat_dist(-1.0, 1.0);
+    for (size_t i = 0; i < num_snp; ++i)
+    {
+        weights.push_back(SNPScoreWeight {stat_dist(rand_gen), 0.1, 0.3, 0, 1,
+                                          2, ploidy, i != 0});
+    }
+    m_prs_score.assign(m_sample_ct, 0.0);
+    m_prs_num_snp.assign(m_sample_ct, 0);
+    std::vector<uintptr_t> genotype(QUATERCT_TO_WORDCT(m_sample_ct) + 1);
+    for (size_t i = 0; i < num_snp; ++i)
+    {
+        copy_quaterarr_nonempty_subset(
+            &(block[i * unfiltered_word_ct]), m_sample_include.data(),
+            static_cast<uint32_t>(m_unfiltered_sample_ct),
+            static_cast<uint32_t>(m_sample_ct), genotype.data());
+        auto&& w = weights[i];
+        read_prs(genotype, ploidy, w.stat, w.adj_score, w.miss_score,
+                 w.miss_count, w.homcom_weight, w.het_weight, w.homrar_weight,
+                 w.not_first);
+    }
+    std::vector<double> expected_prs = m_prs_score;
+    std::vector<uint32_t> expected_num = m_prs_num_snp;
+    for (auto&& thread : {1, 3})
+    {
+        m_prs_score.assign(m_sample_ct, 0.0);
+        m_prs_num_snp.assign(m_sample_ct, 0);
+        m_prs_calculation.thread = thread;
+        score_block(block, weights, unfiltered_word_ct, ploidy, true);
+        for (size_t i = 0; i < m_sample_ct; ++i)
+        {
+            ASSERT_EQ(m_prs_score[i], expected_prs[i]);
+            ASSERT_EQ(m_prs_num_snp[i], expected_num[i]);
+        }
+    }
+}
+TEST_F(GENOTYPE_BASIC, SCORE_MATRIX_BLOCK)
+{
+    // each column of the score matrix should equal to the score of the base
+    // file calculated on its own
+    m_sample_ct = 9001;
+    m_unfiltered_sample_ct = m_sample_ct;
+    m_num_base = 3;
+    const size_t word_ct = QUATERCT_TO_WORDCT(m_sample_ct);
+    const size_t num_snp = 17;
+    const size_t ploidy = 2;
+    m_prs_calculation.missing_score = MISSING_SCORE::MEAN_IMPUTE;
+    std::mt19937 rand_gen(4321);
+    std::uniform_int_distribution<uintptr_t> dist;
+    std::uniform_real_distribution<double> unif(0.0, 1.0);
+    std::vector<uintptr_t> block(word_ct * num_snp);
+    for (auto&& w : block) { w = dist(rand_gen); }
+    std::vector<ScoreBaseStat> base_stat(num_snp * m_num_base);
+    std::vector<double> maf(num_snp);
+    std::vector<bool> flipped(num_snp);
+    for (size_t i = 0; i < base_stat.size(); ++i)
+    {
+        // the third base file does not contain every third SNPs
+        base_stat[i].stat = (i % (3 * m_num_base) == 2)
+                                ? std::numeric_limits<double>::quiet_NaN()
+                                : unif(rand_gen) - 0.5;
+        base_stat[i].flipped = unif(rand_gen) < 0.5;
+    }
+    std::vector<double> prs_lut;
+    std::vector<uint32_t> count_lut;
+    for (size_t i = 0; i < num_snp; ++i)
+    {
+        maf[i] = unif(rand_gen);
+        flipped[i] = unif(rand_gen) < 0.5;
+        add_score_matrix_lut(&base_stat[i * m_num_base], maf[i], flipped[i],
+                             ploidy, prs_lut, count_lut);
+    }
+    m_score_matrix.assign(m_sample_ct * m_num_base, 0.0);
+    m_score_matrix_num_snp.assign(m_sample_ct * m_num_base, 0);
+    m_prs_calculation.thread = 3;
+    score_matrix_block(block, prs_lut, count_lut, num_snp, word_ct, false);
+    m_prs_calculation.thread = 1;
+    m_prs_score.assign(m_sample_ct, 0.0);
+    m_prs_num_snp.assign(m_sample_ct, 0);
+    for (size_t i_base = 0; i_base < m_num_base; ++i_base)
+    {
+        std::vector<uintptr_t> base_block;
+        std::vector<SNPScoreWeight> weights;
+        for (size_t i = 0; i < num_snp; ++i)
+        {
+            auto&& stat = base_stat[i * m_num_base + i_base];
+            if (std::isnan(stat.stat)) continue;
+            base_block.insert(base_block.end(), &block[i * word_ct],
+                              &block[(i + 1) * word_ct]);
+            weights.push_back(score_weight(stat.stat, maf[i],
+                                           flipped[i] != stat.flipped, ploidy,
+                                           !weights.empty()));
+        }
+        score_block(base_block, weights, word_ct, ploidy);
+        for (size_t i = 0; i < m_sample_ct; ++i)
+        {
+            ASSERT_DOUBLE_EQ(m_score_matrix[i * m_num_base + i_base],
+                             m_prs_score[i]);
+            ASSERT_EQ(m_score_matrix_num_snp[i * m_num_base + i_base],
+                      m_prs_num_snp[i]);
+        }
+    }
+}
+TEST_F(GENOTYPE_BASIC, R2_3X3_COUNTS)
+{
+    // the fused count kernel should give the same counts as calling
+    // genovec_3freq on each of the index genotype mask
+    std::mt19937 rand_gen(2468);
+    std::uniform_int_distribution<uintptr_t> dist;
+    for (auto&& founder_ct : {1, 31, 32, 33, 1001, 7777})
+    {
+        const uintptr_t founder_ctl2 = QUATERCT_TO_WORDCT(founder_ct);
+        const uintptr_t founder_ctv2 = QUATERCT_TO_ALIGNED_WORDCT(founder_ct);
+        std::vector<uintptr_t> founder_include2(founder_ctv2, 0);
+        fill_quatervec_55(static_cast<uint32_t>(founder_ct),
+                          founder_include2.data());
+        std::vector<uintptr_t> index_geno(founder_ctv2, 0);
+        std::vector<uintptr_t> window_geno(founder_ctv2, 0);
+        for (size_t i = 0; i < founder_ctl2; ++i)
+        {
+            index_geno[i] = dist(rand_gen);
+            window_geno[i] = dist(rand_gen);
+        }
+        std::vector<uintptr_t> index_data(3 * founder_ctv2, 0);
+        std::vector<uintptr_t> index_tots(6, 0);
+        update_index_tot(founder_ctl2, founder_ctv2,
+                         static_cast<uintptr_t>(founder_ct), index_data,
+                         index_tots, founder_include2, index_geno.data());
+        uint32_t expected[9];
+        for (size_t k = 0; k < 3; ++k)
+        {
+            genovec_3freq(window_geno.data(), &(index_data[k * founder_ctv2]),
+                          founder_ctl2, &(expected[3 * k]),
+                          &(expected[3 * k + 1]), &(expected[3 * k + 2]));
+        }
+        uint32_t counts[9];
+        genovec_3x3freq(window_geno.data(), index_data.data(), founder_ctl2,
+                        founder_ctv2, counts);
+        for (size_t i = 0; i < 9; ++i) { ASSERT_EQ(counts[i], expected[i]); }
+    }
+}
+TEST_F(GENOTYPE_BASIC, PARSE_BASE_BLOCK)
+{
+    BaseFile base_file;
+    base_file.column_index[+BASE_INDEX::RS] = 0;
+    base_file.column_index[+BASE_INDEX::BP] = 1;
+    base_file.column_index[+BASE_INDEX::STAT] = 2;
+    base_file.column_index[+BASE_INDEX::P] = 3;
+    base_file.column_index[+BASE_INDEX::MAX] = 3;
+    base_file.has_column[+BASE_INDEX::RS] = true;
+    base_file.has_column[+BASE_INDEX::BP] = true;
+    base_file.has_column[+BASE_INDEX::STAT] = true;
+    base_file.has_column[+BASE_INDEX::P] = true;
+    const std::string block = "rs1 100\t0.5 0.01 extra\n"
+                              "  \t \r\n"
+                              "\trs2  x  -1  NA\r\n"
+                              "rs3 300\n"
+                              "rs4 +4 1e-3 1";
+    std::vector<BaseLine> lines;
+    for (auto&& thread : {1, 4})
+    {
+        m_prs_calculation.thread = thread;
+        parse_base_block(block.data(), block.data() + block.size(), base_file,
+                         lines);
+        ASSERT_EQ(lines.size(), 4);
+        ASSERT_TRUE(lines[0].enough_column);
+        ASSERT_EQ(lines[0].get(BASE_INDEX::RS), "rs1");
+        ASSERT_EQ(lines[0].loc, 100);
+        ASSERT_DOUBLE_EQ(lines[0].stat, 0.5);
+        ASSERT_DOUBLE_EQ(lines[0].pvalue, 0.01);
+        ASSERT_TRUE(lines[0].valid_pvalue && lines[0].valid_stat);
+        ASSERT_EQ(lines[1].get(BASE_INDEX::RS), "rs2");
+        ASSERT_FALSE(lines[1].valid_loc);
+        ASSERT_TRUE(lines[1].valid_stat);
+        ASSERT_FALSE(lines[1].valid_pvalue);
+        ASSERT_EQ(std::string(lines[2].line, lines[2].length), "rs3 300");
+        ASSERT_FALSE(lines[2].enough_column);
+        ASSERT_EQ(lines[3].loc, 4);
+        ASSERT_DOUBLE_EQ(lines[3].pvalue, 1);
+    }
+}
+// scores a block of random genotypes in read_score, such that the null PRS
+// built from the background cache can be compared to those from read_score
+class GENOTYPE_NULL_SCORE : public Genotype, public ::testing::Test
+{
+protected:
+    const size_t m_ploidy = 2;
+    size_t m_word_ct = 0;
+    std::vector<uintptr_t> m_block;
+    std::vector<SNPScoreWeight> m_weights;
+    std::vector<bool> m_skip;
+    std::vector<size_t> m_background;
+    void SetUp() override
+    {
+        // not a multiple of NULL_SCORE_TILE
+        m_sample_ct = 301;
+        m_unfiltered_sample_ct = m_sample_ct;
+        m_word_ct = QUATERCT_TO_WORDCT(m_sample_ct);
+        const size_t num_snp = 40;
+        m_sample_include.assign(BITCT_TO_WORDCT(m_sample_ct), 0);
+        m_exclude_from_std.assign(BITCT_TO_WORDCT(m_sample_ct), 0);
+        for (size_t i = 0; i < m_sample_ct; ++i)
+        {
+            SET_BIT(i, m_sample_include.data());
+            if (i % 7 == 0) SET_BIT(i, m_exclude_from_std.data());
+        }
+        m_prs_score.assign(m_sample_ct, 0.0);
+        m_prs_num_snp.assign(m_sample_ct, 0);
+        m_existed_snps.resize(num_snp);
+        std::mt19937 rand_gen(2468);
+        std::uniform_int_distribution<uintptr_t> dist;
+        std::uniform_real_distribution<double> stat_dist(-1.0, 1.0);
+        m_block.resize(m_word_ct * num_snp);
+        for (auto&& w : m_block) { w = dist(rand_gen); }
+        for (size_t i = 0; i < num_snp; ++i)
+        {
+            m_weights.push_back(SNPScoreWeight {stat_dist(rand_gen), 0.1, 0.3,
+                                                0, 1, 2, m_ploidy, false});
+            // every fourth SNP is not part of the background
+            if (i % 4 != 3) m_background.push_back(i);
+        }
+        // SNPs that read_score skip, e.g. because of their MAF
+        m_skip.assign(num_snp, false);
+        m_skip[5] = true;
+        m_skip[17] = true;
+    }
+    void read_score(const std::vector<size_t>::const_iterator& start,
+                    const std::vector<size_t>::const_iterator& end,
+                    bool reset_zero) override
+    {
+        bool not_first = !reset_zero;
+        std::vector<uintptr_t> block;
+        std::vector<SNPScoreWeight> weights;
+        for (auto it = start; it != end; ++it)
+        {
+            if (m_skip[*it]) continue;
+            block.insert(block.end(), &m_block[(*it) * m_word_ct],
+                         &m_block[(*it + 1) * m_word_ct]);
+            weights.push_back(m_weights[*it]);
+            weights.back().not_first = not_first;
+            not_first = true;
+        }
+        score_block(block, weights, m_word_ct, m_ploidy);
+    }
+    // same as BinaryPlink::read_background, with blocks of a few SNPs
+    void read_background(const std::vector<size_t>& background) override
+    {
+        const size_t block_size = 8;
+        std::vector<uintptr_t> block;
+        std::vector<double> prs_lut;
+        std::vector<uint8_t> count_lut;
+        std::vector<size_t> bk_pos;
+        for (size_t i = 0; i < background.size(); ++i)
+        {
+            const size_t snp = background[i];
+            if (m_skip[snp]) continue;
+            block.insert(block.end(), &m_block[snp * m_word_ct],
+                         &m_block[(snp + 1) * m_word_ct]);
+            add_background_lut(m_weights[snp], m_ploidy, prs_lut, count_lut);
+            bk_pos.push_back(i);
+            m_bk_valid[i] = true;
+            if (bk_pos.size() == block_size)
+            {
+                background_block(block, prs_lut, count_lut, bk_pos, m_word_ct,
+                                 false);
+                block.clear();
+                prs_lut.clear();
+                count_lut.clear();
+                bk_pos.clear();
+            }
+        }
+        background_block(block, prs_lut, count_lut, bk_pos, m_word_ct, false);
+    }
+    // build the selection matrix of the nested set sizes of a permutation,
+    // where select contains the selected positions within the background
+    void add_selection(const std::vector<size_t>& select,
+                       const std::vector<size_t>& set_size,
+                       std::vector<size_t>& col_start,
+                       std::vector<size_t>& snp_pos)
+    {
+        size_t prev_size = 0;
+        for (auto&& size : set_size)
+        {
+            col_start.push_back(snp_pos.size());
+            std::vector<size_t> add(
+                select.begin() + static_cast<long>(prev_size),
+                select.begin() + static_cast<long>(size));
+            std::sort(add.begin(), add.end());
+            snp_pos.insert(snp_pos.end(), add.begin(), add.end());
+            prev_size = size;
+        }
+    }
+};
+TEST_F(GENOTYPE_NULL_SCORE, CACHED_NULL_SCORE)
+{
+    // null PRS from the background cache should be the same as those read
+    // through get_null_score, including when the skipped SNPs are selected
+    ASSERT_TRUE(cache_background(m_background));
+    ASSERT_FALSE(m_bk_valid[4]);
+    ASSERT_FALSE(m_bk_valid[13]);
+    const std::vector<size_t> set_size = {3, 7, 12};
+    std::mt19937 rand_gen(1357);
+    std::vector<double> prs, score;
+    std::vector<uint32_t> num_snp;
+    for (auto&& method :
+         {SCORING::SUM, SCORING::AVERAGE, SCORING::STANDARDIZE})
+    {
+        m_prs_calculation.scoring_method = method;
+        for (size_t i_perm = 0; i_perm < 20; ++i_perm)
+        {
+            std::vector<size_t> select(m_background.size());
+            std::iota(select.begin(), select.end(), 0);
+            std::shuffle(select.begin(), select.end(), rand_gen);
+            // always select a skipped SNP in the first permutations
+            if (i_perm < 3)
+            {
+                std::swap(*std::find(select.begin(), select.end(), 4),
+                          select[i_perm]);
+            }
+            std::vector<size_t> col_start, snp_pos;
+            add_selection(select, set_size, col_start, snp_pos);
+            col_start.push_back(snp_pos.size());
+            null_score_block(col_start, snp_pos, set_size.size(), prs,
+                             num_snp, score);
+            std::vector<size_t> snp_list(set_size.back());
+            for (size_t i = 0; i < snp_list.size(); ++i)
+            { snp_list[i] = m_background[select[i]]; }
+            size_t prev_size = 0;
+            for (size_t col = 0; col < set_size.size(); ++col)
+            {
+                get_null_score(set_size[col], prev_size, snp_list, col == 0);
+                prev_size = set_size[col];
+                for (size_t i = 0; i < m_sample_ct; ++i)
+                {
+                    ASSERT_DOUBLE_EQ(score[col * m_sample_ct + i],
+                                     calculate_score(i));
+                }
+            }
+        }
+    }
+    release_background();
+    ASSERT_TRUE(m_bk_score.empty());
+    ASSERT_TRUE(m_bk_index.empty());
+}
+TEST_F(GENOTYPE_NULL_SCORE, NULL_SCORE_BLOCK)
+{
+    // a block of permutations should give the same null PRS as summing the
+    // cached columns of each permutation on its own
+    ASSERT_TRUE(cache_background(m_background));
+    const std::vector<size_t> set_size = {1, 4, 9, 15};
+    const size_t num_perm = 13;
+    std::mt19937 rand_gen(97531);
+    std::vector<std::vector<size_t>> selections;
+    std::vector<size_t> col_start, snp_pos;
+    for (size_t i_perm = 0; i_perm < num_perm; ++i_perm)
+    {
+        std::vector<size_t> select(m_background.size());
+        std::iota(select.begin(), select.end(), 0);
+        std::shuffle(select.begin(), select.end(), rand_gen);
+        add_selection(select, set_size, col_start, snp_pos);
+        selections.push_back(select);
+    }
+    col_start.push_back(snp_pos.size());
+    const size_t num_col = num_perm * set_size.size();
+    std::vector<double> prs, score, single_prs, single_score;
+    std::vector<uint32_t> num_snp, single_num_snp;
+    for (auto&& method :
+         {SCORING::SUM, SCORING::AVERAGE, SCORING::STANDARDIZE})
+    {
+        m_prs_calculation.scoring_method = method;
+        null_score_block(col_start, snp_pos, set_size.size(), prs, num_snp,
+                         score);
+        ASSERT_EQ(score.size(), num_col * m_sample_ct);
+        for (size_t i_perm = 0; i_perm < num_perm; ++i_perm)
+        {
+            auto&& select = selections[i_perm];
+            std::vector<size_t> single_start, single_pos;
+            add_selection(select, set_size, single_start, single_pos);
+            single_start.push_back(single_pos.size());
+            null_score_block(single_start, single_pos, set_size.size(),
+                             single_prs, single_num_snp, single_score);
+            for (size_t i_size = 0; i_size < set_size.size(); ++i_size)
+            {
+                const size_t col = i_perm * set_size.size() + i_size;
+                for (size_t i = 0; i < m_sample_ct; ++i)
+                {
+                    // sum of the cached columns of the selected SNPs
+                    double expected_prs = 0;
+                    uint32_t expected_num_snp = 0;
+                    for (size_t k = 0; k < set_size[i_size]; ++k)
+                    {
+                        if (!m_bk_valid[select[k]]) continue;
+                        expected_prs +=
+                            m_bk_score[select[k] * m_sample_ct + i];
+                        expected_num_snp +=
+                            m_bk_num_snp[select[k] * m_sample_ct + i];
+                    }
+                    ASSERT_NEAR(prs[col * m_sample_ct + i], expected_prs,
+                                1e-10);
+                    if (method != SCORING::SUM)
+                    {
+                        ASSERT_EQ(num_snp[col * m_sample_ct + i],
+                                  expected_num_snp);
+                    }
+                    ASSERT_EQ(score[col * m_sample_ct + i],
+                              single_score[i_size * m_sample_ct + i]);
+                }
+            }
+        }
+    }
+}
 #endif // GENOTYPE_TEST_HPP
@@ -0,0 +1,67 @@
+#ifndef LDSTORE_TEST_HPP
+#define LDSTORE_TEST_HPP
+#include "ldstore.hpp"
+#include "gtest/gtest.h"
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+TEST(LDSTORE, ROUND_TRIP)
+{
+    {
+        LDStore store;
+        store.create("DEBUG.ldstore", 503, 42, 1234567890123ULL, 250000, 0.1);
+        store.add_pair(1, 0.5);
+        store.add_pair(2, 0.05);
+        store.add_pair(3, 0.25);
+        store.add_snp("rs1", 1, 100);
+        // R2 just above the clumping threshold must not be rounded down
+        store.add_pair(2, 0.1 + 1e-12);
+        store.add_snp("rs2", 1, 200);
+        store.add_pair(3, 1.0);
+        store.add_snp("rs3", 1, 300);
+        store.add_snp("rs4", 2, 100);
+        store.close();
+    }
+    LDStore store;
+    store.load("DEBUG.ldstore");
+    ASSERT_EQ(store.num_snp(), 4);
+    ASSERT_EQ(store.founder_ct(), 503);
+    ASSERT_EQ(store.founder_hash(), 42);
+    ASSERT_EQ(store.variant_hash(), 1234567890123ULL);
+    ASSERT_EQ(store.distance(), 250000);
+    ASSERT_DOUBLE_EQ(store.r2_floor(), 0.1);
+    ASSERT_EQ(store.find("rs3"), 2);
+    ASSERT_EQ(store.find("rs5"), ~size_t(0));
+    ASSERT_EQ(store.chr(3), 2);
+    ASSERT_EQ(store.loc(2), 300);
+    // pairs are symmetric and those below the floor are not stored
+    ASSERT_DOUBLE_EQ(store.r2(0, 1), 0.5);
+    ASSERT_DOUBLE_EQ(store.r2(1, 0), 0.5);
+    ASSERT_DOUBLE_EQ(store.r2(0, 2), -1);
+    ASSERT_DOUBLE_EQ(store.r2(3, 0), 0.25);
+    ASSERT_DOUBLE_EQ(store.r2(2, 3), 1.0);
+    ASSERT_EQ(store.r2(1, 2), 0.1 + 1e-12);
+    ASSERT_GT(store.r2(2, 1), 0.1);
+    std::remove("DEBUG.ldstore");
+}
+
+TEST(LDSTORE, INVALID_FILE)
+{
+    std::ofstream test;
+    test.open("DEBUG.ldstore");
+    test << "Not an LD store" << std::endl;
+    test.close();
+    LDStore store;
+    try
+    {
+        store.load("DEBUG.ldstore");
+        FAIL();
+    }
+    catch (const std::runtime_error&)
+    {
+        SUCCEED();
+    }
+    std::remove("DEBUG.ldstore");
+}
+#endif // LDSTORE_TEST_HPP
@@ -0,0 +1,66 @@
+#ifndef MEMORYREAD_TEST_HPP
+#define MEMORYREAD_TEST_HPP
+#include "memoryread.hpp"
+#include "gtest/gtest.h"
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+void write_memory_file(const std::string& name, const size_t size)
+{
+    std::ofstream out(name.c_str(), std::ios::binary);
+    for (size_t i = 0; i < size; ++i) out.put(static_cast<char>(i % 251));
+    out.close();
+}
+
+void check_view(const char* data, const size_t byte_pos, const size_t size)
+{
+    ASSERT_TRUE(data != nullptr);
+    for (size_t i = 0; i < size; ++i)
+    { ASSERT_EQ(data[i], static_cast<char>((byte_pos + i) % 251)); }
+}
+
+TEST(MEMORYREAD, VIEW_WITHOUT_MMAP)
+{
+    // without memory mapping, view is unavailable and read must be used
+    write_memory_file("DEBUG.memoryread", 2500);
+    MemoryRead reader;
+    ASSERT_TRUE(reader.view("DEBUG.memoryread", 0, 100) == nullptr);
+    std::vector<char> buffer(100);
+    reader.read("DEBUG.memoryread", 1200, 100, buffer.data());
+    check_view(buffer.data(), 1200, 100);
+    std::remove("DEBUG.memoryread");
+}
+
+TEST(MEMORYREAD, VIEW_MAPPED)
+{
+    write_memory_file("DEBUG.memoryread", 2500);
+    MemoryRead reader;
+    reader.use_mmap();
+    // map 10 blocks of 100 byte at a time
+    reader.init_memory_map(1000, 100);
+    check_view(reader.view("DEBUG.memoryread", 0, 100), 0, 100);
+    check_view(reader.view("DEBUG.memoryread", 900, 100), 900, 100);
+    // crossing the end of the current mapping will remap the file
+    check_view(reader.view("DEBUG.memoryread", 950, 100), 950, 100);
+    // going backward also remap the file
+    check_view(reader.view("DEBUG.memoryread", 10, 100), 10, 100);
+    // the last byte of the file are still available
+    check_view(reader.view("DEBUG.memoryread", 2400, 100), 2400, 100);
+    check_view(reader.view("DEBUG.memoryread", 2499, 1), 2499, 1);
+    // but not beyond the end of file
+    ASSERT_TRUE(reader.view("DEBUG.memoryread", 2450, 100) == nullptr);
+    ASSERT_TRUE(reader.view("DEBUG.memoryread", 2499, 2) == nullptr);
+    std::vector<char> buffer(100);
+    ASSERT_ANY_THROW(
+        reader.read("DEBUG.memoryread", 2450, 100, buffer.data()));
+    // read and view can be mixed
+    reader.read("DEBUG.memoryread", 1500, 100, buffer.data());
+    check_view(buffer.data(), 1500, 100);
+    check_view(reader.view("DEBUG.memoryread", 1550, 100), 1550, 100);
+    ASSERT_EQ(reader.num_read(), 8);
+    std::remove("DEBUG.memoryread");
+}
+
+#endif // MEMORYREAD_TEST_HPP
@@ -160,4 +160,46 @@ TEST(UTILITY, IS_GZ_FILE)
     ASSERT_FALSE(misc::is_gz_file("DEBUG.gz"));
     std::remove("DEBUG.gz");
 }
+TEST(UTILITY, CONVERT_DOUBLE)
+{
+    // convert_double should accept exactly what convert<double> accepts
+    for (std::string input :
+         {"0.05", "1", "-2.5", "+3", ".5", "5.", "1e-5", "1E+300", "1e-320",
+          "1e400", "-1e400", "inf", "nan", "NA", "0x1p3", "1e", "1e+", "-",
+          ".", "1.2.3", "1-2", "1e5e5", "e5", "12abc", "--1", "1,5"})
+    {
+        double expected = 0, value = 0;
+        bool valid = true;
+        try
+        {
+            expected = misc::convert<double>(input);
+        }
+        catch (const std::runtime_error&)
+        {
+            valid = false;
+        }
+        ASSERT_EQ(misc::convert_double(input.data(),
+                                       input.data() + input.size(), value),
+                  valid)
+            << input;
+        if (valid) { ASSERT_EQ(value, expected) << input; }
+    }
+}
+TEST(UTILITY, SPLIT_RANGE)
+{
+    const std::string input = " \t1 rs1\t0  100 A C extra \r";
+    const char* begin = input.data();
+    const char* end = input.data() + input.size();
+    misc::trim(begin, end);
+    ASSERT_EQ(std::string(begin, end), "1 rs1\t0  100 A C extra");
+    std::vector<std::pair<const char*, const char*>> token;
+    misc::split(token, begin, end, 6);
+    // empty tokens are skipped, same as misc::split on string
+    std::vector<std::string> expected = misc::split(std::string(begin, end));
+    ASSERT_EQ(token.size(), 6);
+    for (size_t i = 0; i < token.size(); ++i)
+    {
+        ASSERT_EQ(std::string(token[i].first, token[i].second), expected[i]);
+    }
+}
 #endif // MISC_TEST_HPP
@@ -0,0 +1,55 @@
+#ifndef PHILOX_TEST_HPP
+#define PHILOX_TEST_HPP
+#include "gtest/gtest.h"
+#include "philox.hpp"
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+TEST(PHILOX, KNOWN_ANSWER)
+{
+    // known answer tests from the Random123 distribution
+    std::array<uint32_t, 4> res = Philox4x32::block({{0, 0, 0, 0}}, {{0, 0}});
+    ASSERT_EQ(res[0], 0x6627e8d5);
+    ASSERT_EQ(res[1], 0xe169c58d);
+    ASSERT_EQ(res[2], 0xbc57ac4c);
+    ASSERT_EQ(res[3], 0x9b00dbd8);
+    res = Philox4x32::block({{0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}},
+                            {{0xffffffff, 0xffffffff}});
+    ASSERT_EQ(res[0], 0x408f276d);
+    ASSERT_EQ(res[1], 0x41c83b0e);
+    ASSERT_EQ(res[2], 0xa20bc7c6);
+    ASSERT_EQ(res[3], 0x6d5451fd);
+    res = Philox4x32::block({{0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}},
+                            {{0xa4093822, 0x299f31d0}});
+    ASSERT_EQ(res[0], 0xd16cfe09);
+    ASSERT_EQ(res[1], 0x94fdcceb);
+    ASSERT_EQ(res[2], 0x5001e420);
+    ASSERT_EQ(res[3], 0x24126ea1);
+}
+
+TEST(PHILOX, STREAM)
+{
+    // the stream only depends on the seed and stream index
+    Philox4x32 first(42, 7), second(42, 7), other(42, 8);
+    std::vector<uint32_t> a(10), b(10), c(10);
+    for (auto&& v : a) v = first();
+    for (auto&& v : b) v = second();
+    for (auto&& v : c) v = other();
+    ASSERT_EQ(a, b);
+    ASSERT_NE(a, c);
+    // the first block is the bijection of counter 0 of the stream
+    std::array<uint32_t, 4> res = Philox4x32::block({{0, 0, 7, 0}}, {{42, 0}});
+    for (size_t i = 0; i < 4; ++i) ASSERT_EQ(a[i], res[i]);
+    res = Philox4x32::block({{1, 0, 7, 0}}, {{42, 0}});
+    for (size_t i = 0; i < 4; ++i) ASSERT_EQ(a[i + 4], res[i]);
+    // can be used by the standard algorithms
+    std::vector<int> x(100), y(100);
+    std::iota(x.begin(), x.end(), 0);
+    std::iota(y.begin(), y.end(), 0);
+    Philox4x32 g1(1, 2), g2(1, 2);
+    std::shuffle(x.begin(), x.end(), g1);
+    std::shuffle(y.begin(), y.end(), g2);
+    ASSERT_EQ(x, y);
+}
+#endif // PHILOX_TEST_HPP
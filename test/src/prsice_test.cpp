@@ -187,4 +187,24 @@ TEST(PRSICE, PHENO_CHECK)
 }
 
 
+TEST(PRSICE, NULL_SET_BLOCK_SIZE)
+{
+    // never more than the number of permutations or PERM_BLOCK_SIZE
+    ASSERT_EQ(PRSice::null_set_block_size(2, 100, 80, 10), 10);
+    ASSERT_EQ(PRSice::null_set_block_size(2, 100, 80, 100000),
+              PERM_BLOCK_SIZE);
+    // a block of large sets must fit within MAX_PERM_BLOCK_BYTES
+    const size_t num_set_size = 10, num_sample = 100000;
+    const size_t block_size = PRSice::null_set_block_size(
+        num_set_size, num_sample, num_sample, 100000);
+    const size_t bytes_per_perm =
+        num_set_size
+        * ((2 * sizeof(double) + sizeof(uint32_t)) + sizeof(double))
+        * num_sample;
+    ASSERT_LE(block_size * bytes_per_perm, MAX_PERM_BLOCK_BYTES);
+    ASSERT_GT((block_size + 1) * bytes_per_perm, MAX_PERM_BLOCK_BYTES);
+    // but always contains at least one permutation
+    ASSERT_EQ(PRSice::null_set_block_size(1000, 10000000, 10000000, 100), 1);
+}
+
 #endif
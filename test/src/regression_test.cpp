@@ -0,0 +1,183 @@
+#ifndef REGRESSION_TEST_HPP
+#define REGRESSION_TEST_HPP
+#include "regression.hpp"
+#include "gtest/gtest.h"
+#include <Eigen/Dense>
+#include <cmath>
+#include <random>
+
+// standard error of each coefficient when the residual standard deviation is
+// 1, computed the same way as PRSice::get_se_matrix
+Eigen::VectorXd
+block_se_base(const Eigen::ColPivHouseholderQR<Eigen::MatrixXd>& PQR)
+{
+    const Eigen::Index p = PQR.cols();
+    const Eigen::Index rank = PQR.rank();
+    Eigen::VectorXd se_base =
+        Eigen::VectorXd::Constant(p, std::numeric_limits<double>::quiet_NaN());
+    se_base.head(rank) = PQR.matrixQR()
+                             .topLeftCorner(rank, rank)
+                             .triangularView<Eigen::Upper>()
+                             .solve(Eigen::MatrixXd::Identity(rank, rank))
+                             .rowwise()
+                             .norm();
+    return PQR.colsPermutation() * se_base;
+}
+
+// intercept, PRS and two covariates, with random phenotypes
+void random_design(const Eigen::Index n, const Eigen::Index num_pheno,
+                   Eigen::MatrixXd& X, Eigen::MatrixXd& Y)
+{
+    std::mt19937 rand_gen(1357);
+    std::normal_distribution<double> norm(0, 1);
+    X.resize(n, 4);
+    Y.resize(n, num_pheno);
+    for (Eigen::Index i = 0; i < n; ++i)
+    {
+        X(i, 0) = 1;
+        for (Eigen::Index j = 1; j < X.cols(); ++j) X(i, j) = norm(rand_gen);
+        for (Eigen::Index j = 0; j < num_pheno; ++j)
+        { Y(i, j) = 0.3 * X(i, 1) - 0.2 * X(i, 2) + norm(rand_gen); }
+    }
+}
+
+void check_fastlm_block(const Eigen::MatrixXd& X, const Eigen::MatrixXd& Y)
+{
+    Eigen::ColPivHouseholderQR<Eigen::MatrixXd> PQR(X);
+    Eigen::VectorXd t_value;
+    Regression::fastLm_block(PQR, block_se_base(PQR), Y, 1, t_value);
+    ASSERT_EQ(t_value.rows(), Y.cols());
+    double p_value, r2, r2_adjust, coeff, se;
+    for (Eigen::Index i = 0; i < Y.cols(); ++i)
+    {
+        Regression::fastLm(Y.col(i), X, p_value, r2, r2_adjust, coeff, se, 1,
+                           true);
+        const double expected = std::fabs(coeff / se);
+        ASSERT_NEAR(t_value(i), expected, 1e-9 * expected);
+    }
+}
+
+TEST(REGRESSION, FASTLM_BLOCK_FULL_RANK)
+{
+    Eigen::MatrixXd X, Y;
+    random_design(200, 17, X, Y);
+    check_fastlm_block(X, Y);
+}
+
+TEST(REGRESSION, FASTLM_BLOCK_RANK_DEFICIENT)
+{
+    // a duplicated covariate is pivoted out, but the PRS stays estimable
+    Eigen::MatrixXd X, Y;
+    random_design(200, 17, X, Y);
+    X.col(3) = X.col(2);
+    Eigen::ColPivHouseholderQR<Eigen::MatrixXd> PQR(X);
+    ASSERT_EQ(PQR.rank(), 3);
+    check_fastlm_block(X, Y);
+}
+
+TEST(REGRESSION, FASTLM_BLOCK_INESTIMABLE)
+{
+    // the PRS is a multiple of a covariate with a larger norm, so it is the
+    // column pivoted out of the decomposition
+    Eigen::MatrixXd X, Y;
+    random_design(200, 5, X, Y);
+    X.col(1) = 0.5 * X.col(3);
+    Eigen::ColPivHouseholderQR<Eigen::MatrixXd> PQR(X);
+    ASSERT_EQ(PQR.rank(), 3);
+    Eigen::VectorXd t_value;
+    Regression::fastLm_block(PQR, block_se_base(PQR), Y, 1, t_value);
+    ASSERT_EQ(t_value.rows(), Y.cols());
+    for (Eigen::Index i = 0; i < Y.cols(); ++i)
+    { ASSERT_TRUE(std::isnan(t_value(i))); }
+}
+
+TEST(REGRESSION, FASTLM_COVARIATE)
+{
+    // the covariates are factored once and reused for different PRS
+    Eigen::MatrixXd X, Y;
+    random_design(300, 1, X, Y);
+    Regression::CovariateQR cov_qr;
+    Regression::factor_covariates(Y.col(0), X, cov_qr, 1);
+    std::mt19937 rand_gen(2468);
+    std::normal_distribution<double> norm(0, 1);
+    double p, r2, r2_adjust, coeff, se;
+    double exp_p, exp_r2, exp_r2_adjust, exp_coeff, exp_se;
+    for (size_t iter = 0; iter < 10; ++iter)
+    {
+        for (Eigen::Index i = 0; i < X.rows(); ++i)
+        { X(i, 1) = 0.2 * X(i, 2) + norm(rand_gen); }
+        ASSERT_TRUE(Regression::fastLm_covariate(cov_qr, X.col(1), p, r2,
+                                                 r2_adjust, coeff, se));
+        Regression::fastLm(Y.col(0), X, exp_p, exp_r2, exp_r2_adjust,
+                           exp_coeff, exp_se, 1, true);
+        ASSERT_NEAR(coeff, exp_coeff, 1e-10);
+        ASSERT_NEAR(se, exp_se, 1e-10);
+        ASSERT_NEAR(p, exp_p, 1e-10 * exp_p);
+        ASSERT_NEAR(r2, exp_r2, 1e-10);
+        ASSERT_NEAR(r2_adjust, exp_r2_adjust, 1e-10);
+    }
+}
+
+TEST(REGRESSION, FASTLM_COVARIATE_COLLINEAR)
+{
+    // PRS that are explained by the covariates are left to fastLm
+    Eigen::MatrixXd X, Y;
+    random_design(300, 1, X, Y);
+    Regression::CovariateQR cov_qr;
+    Regression::factor_covariates(Y.col(0), X, cov_qr, 1);
+    double p, r2, r2_adjust, coeff, se;
+    const Eigen::VectorXd constant = Eigen::VectorXd::Constant(X.rows(), 3.5);
+    ASSERT_FALSE(Regression::fastLm_covariate(cov_qr, constant, p, r2,
+                                              r2_adjust, coeff, se));
+    const Eigen::VectorXd combined = 2 * X.col(2) - X.col(3);
+    ASSERT_FALSE(Regression::fastLm_covariate(cov_qr, combined, p, r2,
+                                              r2_adjust, coeff, se));
+    Eigen::VectorXd missing = X.col(2);
+    missing(5) = std::numeric_limits<double>::quiet_NaN();
+    ASSERT_FALSE(Regression::fastLm_covariate(cov_qr, missing, p, r2,
+                                              r2_adjust, coeff, se));
+}
+
+TEST(REGRESSION, FASTLM_COVARIATE_BLOCK)
+{
+    // all PRS of a batch are regressed together, and the collinear or
+    // non-finite ones are flagged without affecting the other columns
+    Eigen::MatrixXd X, Y;
+    random_design(300, 1, X, Y);
+    Regression::CovariateQR cov_qr;
+    Regression::factor_covariates(Y.col(0), X, cov_qr, 1);
+    std::mt19937 rand_gen(97531);
+    std::normal_distribution<double> norm(0, 1);
+    const Eigen::Index num_prs = 8;
+    Eigen::MatrixXd prs(X.rows(), num_prs);
+    for (Eigen::Index i = 0; i < X.rows(); ++i)
+    {
+        for (Eigen::Index j = 0; j < num_prs; ++j)
+        { prs(i, j) = 0.2 * X(i, 2) + norm(rand_gen); }
+    }
+    prs.col(3) = 2 * X.col(2) - X.col(3);
+    prs(5, 5) = std::numeric_limits<double>::quiet_NaN();
+    Regression::CovariateFit fit;
+    Regression::fastLm_covariate_block(cov_qr, prs, fit);
+    ASSERT_EQ(fit.estimable.size(), static_cast<size_t>(num_prs));
+    double exp_p, exp_r2, exp_r2_adjust, exp_coeff, exp_se;
+    for (Eigen::Index j = 0; j < num_prs; ++j)
+    {
+        if (j == 3 || j == 5)
+        {
+            ASSERT_FALSE(fit.estimable[static_cast<size_t>(j)]);
+            continue;
+        }
+        ASSERT_TRUE(fit.estimable[static_cast<size_t>(j)]);
+        X.col(1) = prs.col(j);
+        Regression::fastLm(Y.col(0), X, exp_p, exp_r2, exp_r2_adjust,
+                           exp_coeff, exp_se, 1, true);
+        ASSERT_NEAR(fit.coeff(j), exp_coeff, 1e-10);
+        ASSERT_NEAR(fit.standard_error(j), exp_se, 1e-10);
+        ASSERT_NEAR(fit.p_value(j), exp_p, 1e-10 * exp_p);
+        ASSERT_NEAR(fit.r2(j), exp_r2, 1e-10);
+        ASSERT_NEAR(fit.r2_adjust(j), exp_r2_adjust, 1e-10);
+    }
+}
+
+#endif // REGRESSION_TEST_HPP
@@ -11,6 +11,8 @@
 class SNP_INIT_TEST : public ::testing::Test
 {
 protected:
+    StringArena id_arena;
+    AlleleTable allele_table;
     SNP snp;
     std::string rs = "Test";
     std::string ref = "A";
@@ -22,7 +24,8 @@ protected:
     unsigned long long category = 1;
     void SetUp() override
     {
-        snp = SNP(rs, chr, loc, ref, alt, stat, p, category, p_threshold);
+        snp = SNP(rs, chr, loc, ref, alt, stat, p, category, p_threshold,
+                  id_arena, allele_table);
     }
     void TearDown() override {}
 };
@@ -32,8 +35,8 @@ TEST_F(SNP_INIT_TEST, INIT_TEST)
     // check if the initialization sets all the parameters correctly
     size_t homcom, het, homrar, missing;
     ASSERT_STREQ(snp.rs().c_str(), rs.c_str());
-    ASSERT_STREQ(snp.ref().c_str(), ref.c_str());
-    ASSERT_STREQ(snp.alt().c_str(), alt.c_str());
+    ASSERT_STREQ(snp.ref(allele_table).c_str(), ref.c_str());
+    ASSERT_STREQ(snp.alt(allele_table).c_str(), alt.c_str());
     ASSERT_EQ(snp.chr(), chr);
     ASSERT_EQ(snp.loc(), loc);
     bool is_ref = true;
@@ -80,7 +83,8 @@ TEST_F(SNP_INIT_TEST, ADD_REF)
     bool flipping = true;
     std::string ref = "";
     std::string alt = "";
-    snp.add_snp_info(file_idx, byte_pos, chr, loc, ref, alt, flipping, is_ref);
+    snp.add_snp_info(file_idx, byte_pos, chr, loc, ref, alt, flipping, is_ref,
+                     allele_table);
 
     ASSERT_EQ(snp.get_file_idx(is_ref), file_idx);
     ASSERT_EQ(snp.get_byte_pos(is_ref), byte_pos);
@@ -91,13 +95,15 @@ TEST_F(SNP_INIT_TEST, ADD_REF)
     ASSERT_FALSE(snp.is_flipped());
     ASSERT_TRUE(snp.is_ref_flipped());
     flipping = false;
-    snp.add_snp_info(file_idx, byte_pos, chr, loc, ref, alt, flipping, is_ref);
+    snp.add_snp_info(file_idx, byte_pos, chr, loc, ref, alt, flipping, is_ref,
+                     allele_table);
     ASSERT_EQ(snp.get_file_idx(is_ref), file_idx);
     ASSERT_EQ(snp.get_byte_pos(is_ref), byte_pos);
     ASSERT_FALSE(snp.is_flipped());
     ASSERT_FALSE(snp.is_ref_flipped());
     byte_pos = 13789560123;
-    snp.add_snp_info(file_idx, byte_pos, chr, loc, ref, alt, flipping, is_ref);
+    snp.add_snp_info(file_idx, byte_pos, chr, loc, ref, alt, flipping, is_ref,
+                     allele_table);
     ASSERT_EQ(snp.get_byte_pos(is_ref), 13789560123);
 }
 
@@ -115,14 +121,16 @@ TEST_F(SNP_INIT_TEST, UPDATE_REF)
     long long byte_pos = 3;
     std::string ref, alt;
     // we also need to know if we are flipping
-    snp.add_snp_info(file_idx, byte_pos, chr, loc, ref, alt, flipped, is_ref);
+    snp.add_snp_info(file_idx, byte_pos, chr, loc, ref, alt, flipped, is_ref,
+                     allele_table);
     ASSERT_EQ(snp.get_file_idx(is_ref), file_idx);
     ASSERT_EQ(snp.get_byte_pos(is_ref), byte_pos);
     // should not touch target's flip flag
     ASSERT_FALSE(snp.is_flipped());
     ASSERT_TRUE(snp.is_ref_flipped());
     byte_pos = 13789560123;
-    snp.add_snp_info(file_idx, byte_pos, chr, loc, ref, alt, !flipped, is_ref);
+    snp.add_snp_info(file_idx, byte_pos, chr, loc, ref, alt, !flipped, is_ref,
+                     allele_table);
     ASSERT_EQ(snp.get_byte_pos(is_ref), byte_pos);
     ASSERT_FALSE(snp.is_flipped());
     ASSERT_FALSE(snp.is_ref_flipped());
@@ -154,7 +162,7 @@ TEST_F(SNP_INIT_TEST, ADD_TARGET)
     std::string target_name = "Target";
     long long new_pos = 1;
     snp.add_snp_info(file_idx, new_pos, new_chr, new_loc, new_ref, new_alt,
-                     flipped, !is_ref);
+                     flipped, !is_ref, allele_table);
     // check if the names are updated correctly
     ASSERT_EQ(snp.get_file_idx(!is_ref), file_idx);
     ASSERT_EQ(snp.get_byte_pos(!is_ref), new_pos);
@@ -163,19 +171,19 @@ TEST_F(SNP_INIT_TEST, ADD_TARGET)
     ASSERT_EQ(snp.get_byte_pos(is_ref), new_pos);
     ASSERT_EQ(snp.chr(), new_chr);
     ASSERT_EQ(snp.loc(), new_loc);
-    ASSERT_STREQ(snp.ref().c_str(), new_ref.c_str());
-    ASSERT_STREQ(snp.alt().c_str(), new_alt.c_str());
+    ASSERT_STREQ(snp.ref(allele_table).c_str(), new_ref.c_str());
+    ASSERT_STREQ(snp.alt(allele_table).c_str(), new_alt.c_str());
     ASSERT_TRUE(snp.is_flipped());
     ASSERT_FALSE(snp.is_ref_flipped());
     // check none-flip
     file_idx = 0;
     snp.add_snp_info(file_idx, new_pos, new_chr, new_loc, new_ref, new_alt,
-                     !flipped, !is_ref);
+                     !flipped, !is_ref, allele_table);
     ASSERT_FALSE(snp.is_flipped());
     ASSERT_FALSE(snp.is_ref_flipped());
     new_pos = 189560123;
     snp.add_snp_info(file_idx, new_pos, new_chr, new_loc, new_ref, new_alt,
-                     flipped, !is_ref);
+                     flipped, !is_ref, allele_table);
     ASSERT_EQ(snp.get_byte_pos(is_ref), new_pos);
 }
 
@@ -198,7 +206,7 @@ TEST_F(SNP_INIT_TEST, UPDATE_TARGET)
 
     size_t file_idx = 1;
     snp.add_snp_info(file_idx, new_pos, new_chr, new_loc, new_ref, new_alt,
-                     flipped, !is_ref);
+                     flipped, !is_ref, allele_table);
     // check if the names are updated correctly
     ASSERT_EQ(snp.get_file_idx(!is_ref), file_idx);
     ASSERT_EQ(snp.get_byte_pos(!is_ref), new_pos);
@@ -207,8 +215,8 @@ TEST_F(SNP_INIT_TEST, UPDATE_TARGET)
     ASSERT_EQ(snp.get_byte_pos(!is_ref), new_pos);
     ASSERT_EQ(snp.chr(), new_chr);
     ASSERT_EQ(snp.loc(), new_loc);
-    ASSERT_STREQ(snp.ref().c_str(), new_ref.c_str());
-    ASSERT_STREQ(snp.alt().c_str(), new_alt.c_str());
+    ASSERT_STREQ(snp.ref(allele_table).c_str(), new_ref.c_str());
+    ASSERT_STREQ(snp.alt(allele_table).c_str(), new_alt.c_str());
     ASSERT_TRUE(snp.is_flipped());
     ASSERT_FALSE(snp.is_ref_flipped());
     // check update
@@ -226,6 +234,8 @@ TEST_F(SNP_INIT_TEST, UPDATE_TARGET)
 
 TEST(SNP_MATCHING, FLIPPING_AC)
 {
+    StringArena id_arena;
+    AlleleTable allele_table;
     std::string rs = "Test";
     std::string ref = "A";
     std::string alt = "C";
@@ -234,34 +244,37 @@ TEST(SNP_MATCHING, FLIPPING_AC)
     double p_threshold = 1;
     unsigned long long category = 1;
     size_t chr = 1, loc = 1;
-    SNP snp(rs, chr, loc, ref, alt, stat, p, category, p_threshold);
+    SNP snp(rs, chr, loc, ref, alt, stat, p, category, p_threshold, id_arena,
+            allele_table);
     // Flipping occurrs
     bool flipped = false;
-    ASSERT_TRUE(snp.matching(chr, loc, alt, ref, flipped));
+    ASSERT_TRUE(snp.matching(chr, loc, alt, ref, flipped, allele_table));
     // the flipped boolean should change to true
     ASSERT_TRUE(flipped);
     flipped = false;
-    ASSERT_TRUE(snp.matching(chr, loc, ref, alt, flipped));
+    ASSERT_TRUE(snp.matching(chr, loc, ref, alt, flipped, allele_table));
     ASSERT_FALSE(flipped);
     flipped = false;
     // we should get the same result if we have complements
     ref = "T";
     alt = "G";
-    ASSERT_TRUE(snp.matching(chr, loc, alt, ref, flipped));
+    ASSERT_TRUE(snp.matching(chr, loc, alt, ref, flipped, allele_table));
     // the flipped boolean should change to true
     ASSERT_TRUE(flipped);
     flipped = false;
-    ASSERT_TRUE(snp.matching(chr, loc, ref, alt, flipped));
+    ASSERT_TRUE(snp.matching(chr, loc, ref, alt, flipped, allele_table));
     ASSERT_FALSE(flipped);
     ref = "G";
     alt = "A";
     // should be a mismatch
-    ASSERT_FALSE(snp.matching(chr, loc, ref, alt, flipped));
+    ASSERT_FALSE(snp.matching(chr, loc, ref, alt, flipped, allele_table));
 }
 
 
 TEST(SNP_MATCHING, INDEL)
 {
+    StringArena id_arena;
+    AlleleTable allele_table;
     std::string rs = "Test";
     std::string ref = "ACC";
     std::string alt = "CAA";
@@ -270,24 +283,27 @@ TEST(SNP_MATCHING, INDEL)
     double p_threshold = 1;
     unsigned long long category = 1;
     size_t chr = 1, loc = 1;
-    SNP snp(rs, chr, loc, ref, alt, stat, p, category, p_threshold);
+    SNP snp(rs, chr, loc, ref, alt, stat, p, category, p_threshold, id_arena,
+            allele_table);
     // Flipping occurrs
     bool flipped = false;
-    ASSERT_TRUE(snp.matching(chr, loc, ref, alt, flipped));
+    ASSERT_TRUE(snp.matching(chr, loc, ref, alt, flipped, allele_table));
     // the flipped boolean should change to true
     ASSERT_FALSE(flipped);
     // we should be able to do exact match
-    ASSERT_TRUE(snp.matching(chr, loc, alt, ref, flipped));
+    ASSERT_TRUE(snp.matching(chr, loc, alt, ref, flipped, allele_table));
     // the flipped boolean should change to true
     ASSERT_TRUE(flipped);
     // but not if there is complementary
     ref = "TGG";
     alt = "GTT";
-    ASSERT_FALSE(snp.matching(chr, loc, ref, alt, flipped));
-    ASSERT_FALSE(snp.matching(chr, loc, alt, ref, flipped));
+    ASSERT_FALSE(snp.matching(chr, loc, ref, alt, flipped, allele_table));
+    ASSERT_FALSE(snp.matching(chr, loc, alt, ref, flipped, allele_table));
 }
 TEST(SNP_MATCHING, FLIPPING_GT)
 {
+    StringArena id_arena;
+    AlleleTable allele_table;
     // Flipping occurrs
     bool flipped = false;
     std::string ref = "G", alt = "T";
@@ -297,28 +313,31 @@ TEST(SNP_MATCHING, FLIPPING_GT)
     double p_threshold = 1;
     unsigned long long category = 1;
     size_t chr = 1, loc = 1;
-    SNP snp(rs, chr, loc, ref, alt, stat, p, category, p_threshold);
+    SNP snp(rs, chr, loc, ref, alt, stat, p, category, p_threshold, id_arena,
+            allele_table);
     // change referenace and alt using add_target function
-    ASSERT_TRUE(snp.matching(chr, loc, alt, ref, flipped));
+    ASSERT_TRUE(snp.matching(chr, loc, alt, ref, flipped, allele_table));
     // the flipped boolean should change to true
     ASSERT_TRUE(flipped);
     flipped = false;
-    ASSERT_TRUE(snp.matching(chr, loc, ref, alt, flipped));
+    ASSERT_TRUE(snp.matching(chr, loc, ref, alt, flipped, allele_table));
     ASSERT_FALSE(flipped);
     flipped = false;
     // we should get the same result if we have complements
     ref = "C";
     alt = "A";
-    ASSERT_TRUE(snp.matching(chr, loc, alt, ref, flipped));
+    ASSERT_TRUE(snp.matching(chr, loc, alt, ref, flipped, allele_table));
     // the flipped boolean should change to true
     ASSERT_TRUE(flipped);
     flipped = false;
-    ASSERT_TRUE(snp.matching(chr, loc, ref, alt, flipped));
+    ASSERT_TRUE(snp.matching(chr, loc, ref, alt, flipped, allele_table));
     ASSERT_FALSE(flipped);
 }
 
 TEST(SNP_MATCHING, NO_ALT_AC)
 {
+    StringArena id_arena;
+    AlleleTable allele_table;
     std::string rs = "Test";
     std::string ref = "A";
     std::string alt = "";
@@ -327,36 +346,39 @@ TEST(SNP_MATCHING, NO_ALT_AC)
     double p_threshold = 1;
     unsigned long long category = 1;
     size_t chr = 1, loc = 1;
-    SNP snp(rs, chr, loc, ref, alt, stat, p, category, p_threshold);
+    SNP snp(rs, chr, loc, ref, alt, stat, p, category, p_threshold, id_arena,
+            allele_table);
     bool flipped = false;
     alt = "C";
     // should still return true
-    ASSERT_TRUE(snp.matching(chr, loc, ref, alt, flipped));
+    ASSERT_TRUE(snp.matching(chr, loc, ref, alt, flipped, allele_table));
     ASSERT_FALSE(flipped);
     flipped = false;
     // as the original alt is "" and ref is A
     // and the input is ref C alt A we will consider this mismatch
     // as we are not comfortable in flipping it
-    ASSERT_FALSE(snp.matching(chr, loc, alt, ref, flipped));
+    ASSERT_FALSE(snp.matching(chr, loc, alt, ref, flipped, allele_table));
     ref = "T";
     // now we have A"" and TC and we will allow this to match
     flipped = false;
-    ASSERT_TRUE(snp.matching(chr, loc, ref, alt, flipped));
+    ASSERT_TRUE(snp.matching(chr, loc, ref, alt, flipped, allele_table));
     ASSERT_FALSE(flipped);
     // but again, we don't allow A"" and CT to match
     flipped = false;
-    ASSERT_FALSE(snp.matching(chr, loc, alt, ref, flipped));
+    ASSERT_FALSE(snp.matching(chr, loc, alt, ref, flipped, allele_table));
     ASSERT_FALSE(flipped);
     // similarly, we don't allow A"" and GT to match
     ref = "G";
     alt = "T";
     flipped = false;
-    ASSERT_FALSE(snp.matching(chr, loc, ref, alt, flipped));
+    ASSERT_FALSE(snp.matching(chr, loc, ref, alt, flipped, allele_table));
     ASSERT_FALSE(flipped);
 }
 
 TEST(SNP_MATCHING, CHR_POS_MATCHING)
 {
+    StringArena id_arena;
+    AlleleTable allele_table;
     // we assume we always got the chr and loc information when we
     // initialize our SNP object (as we are either reading from bim or from
     // bgen which contain those information as part of the file
@@ -370,15 +392,16 @@ TEST(SNP_MATCHING, CHR_POS_MATCHING)
     double p_threshold = 1;
     unsigned long long category = 1;
     size_t chr = 1, loc = 1;
-    SNP snp(rs, chr, loc, ref, alt, stat, p, category, p_threshold);
+    SNP snp(rs, chr, loc, ref, alt, stat, p, category, p_threshold, id_arena,
+            allele_table);
     bool flipped = false;
     // chromosome mismatch
-    ASSERT_FALSE(snp.matching(chr + 1, loc, ref, alt, flipped));
+    ASSERT_FALSE(snp.matching(chr + 1, loc, ref, alt, flipped, allele_table));
     // the flipped boolean should remain the same
     ASSERT_FALSE(flipped);
     flipped = false;
     // base pair mismatch
-    ASSERT_FALSE(snp.matching(chr, loc + 1, ref, alt, flipped));
+    ASSERT_FALSE(snp.matching(chr, loc + 1, ref, alt, flipped, allele_table));
     // the flipped boolean should remain the same
     ASSERT_FALSE(flipped);
     flipped = false;
@@ -386,6 +409,8 @@ TEST(SNP_MATCHING, CHR_POS_MATCHING)
 
 TEST(SNP_MATCHING, NO_CHR_MATCHING)
 {
+    StringArena id_arena;
+    AlleleTable allele_table;
     // we assume we always got the chr and loc information when we
     // initialize our SNP object (as we are either reading from bim or from
     // bgen which contain those information as part of the file
@@ -399,17 +424,20 @@ TEST(SNP_MATCHING, NO_CHR_MATCHING)
     double p_threshold = 1;
     unsigned long long category = 1;
     size_t chr = ~size_t(0), loc = 1;
-    SNP snp(rs, chr, loc, ref, alt, stat, p, category, p_threshold);
+    SNP snp(rs, chr, loc, ref, alt, stat, p, category, p_threshold, id_arena,
+            allele_table);
     bool flipped = false;
     // When chr is -1, we don't care if it is different as we assume it is
     // missing
-    ASSERT_TRUE(snp.matching(chr + 10, loc, ref, alt, flipped));
+    ASSERT_TRUE(snp.matching(chr + 10, loc, ref, alt, flipped, allele_table));
     // the flipped boolean should remain the same
     ASSERT_FALSE(flipped);
     flipped = false;
 }
 TEST(SNP_MATCHING, NO_BP_MATCHING)
 {
+    StringArena id_arena;
+    AlleleTable allele_table;
     // we assume we always got the chr and loc information when we
     // initialize our SNP object (as we are either reading from bim or from
     // bgen which contain those information as part of the file
@@ -423,11 +451,12 @@ TEST(SNP_MATCHING, NO_BP_MATCHING)
     double p_threshold = 1;
     unsigned long long category = 1;
     size_t chr = 1, loc = ~size_t(0);
-    SNP snp(rs, chr, loc, ref, alt, stat, p, category, p_threshold);
+    SNP snp(rs, chr, loc, ref, alt, stat, p, category, p_threshold, id_arena,
+            allele_table);
     bool flipped = false;
     // When bp is -1, we don't care if it is different as we assume it is
     // missing
-    ASSERT_TRUE(snp.matching(chr, loc + 10, ref, alt, flipped));
+    ASSERT_TRUE(snp.matching(chr, loc + 10, ref, alt, flipped, allele_table));
     // the flipped boolean should remain the same
     ASSERT_FALSE(flipped);
     flipped = false;
@@ -437,6 +466,8 @@ TEST(SNP_MATCHING, NO_BP_MATCHING)
 // situation
 TEST(SNP_CLUMP, SET_CLUMP)
 {
+    StringArena id_arena;
+    AlleleTable allele_table;
     std::string rs = "Test";
     std::string ref = "G";
     std::string alt = "";
@@ -445,7 +476,8 @@ TEST(SNP_CLUMP, SET_CLUMP)
     double p_threshold = 1;
     unsigned long long category = 1;
     size_t chr = 1, loc = ~size_t(0);
-    SNP snp(rs, chr, loc, ref, alt, stat, p, category, p_threshold);
+    SNP snp(rs, chr, loc, ref, alt, stat, p, category, p_threshold, id_arena,
+            allele_table);
     // default of clump should be false
     ASSERT_FALSE(snp.clumped());
     snp.set_clumped();
@@ -456,6 +488,8 @@ TEST(SNP_CLUMP, SET_CLUMP)
 
 TEST(SNP_BOUND, SET_LOW_BOUND)
 {
+    StringArena id_arena;
+    AlleleTable allele_table;
     std::string rs = "Test";
     std::string ref = "G";
     std::string alt = "";
@@ -464,7 +498,8 @@ TEST(SNP_BOUND, SET_LOW_BOUND)
     double p_threshold = 1;
     unsigned long long category = 1;
     size_t chr = 1, loc = ~size_t(0);
-    SNP snp(rs, chr, loc, ref, alt, stat, p, category, p_threshold);
+    SNP snp(rs, chr, loc, ref, alt, stat, p, category, p_threshold, id_arena,
+            allele_table);
     ASSERT_EQ(snp.low_bound(), ~size_t(0));
     ASSERT_EQ(snp.up_bound(), ~size_t(0));
     snp.set_low_bound(10);
@@ -473,6 +508,8 @@ TEST(SNP_BOUND, SET_LOW_BOUND)
 }
 TEST(SNP_BOUND, SET_UP_BOUND)
 {
+    StringArena id_arena;
+    AlleleTable allele_table;
     std::string rs = "Test";
     std::string ref = "G";
     std::string alt = "";
@@ -481,7 +518,8 @@ TEST(SNP_BOUND, SET_UP_BOUND)
     double p_threshold = 1;
     unsigned long long category = 1;
     size_t chr = 1, loc = ~size_t(0);
-    SNP snp(rs, chr, loc, ref, alt, stat, p, category, p_threshold);
+    SNP snp(rs, chr, loc, ref, alt, stat, p, category, p_threshold, id_arena,
+            allele_table);
     ASSERT_EQ(snp.low_bound(), ~size_t(0));
     ASSERT_EQ(snp.low_bound(), ~size_t(0));
     snp.set_up_bound(10);
@@ -491,6 +529,8 @@ TEST(SNP_BOUND, SET_UP_BOUND)
 
 TEST(SNP_TEST, SORT_BY_P_CHR)
 {
+    StringArena id_arena;
+    AlleleTable allele_table;
     std::vector<SNP> snps;
     // first generate SNPs for sorting
     // we need to test the following
@@ -505,11 +545,16 @@ TEST(SNP_TEST, SORT_BY_P_CHR)
 
     // by definition, we don't allow multiple SNPs with the same name. Using SNP
     // name as the last comparison condition should allow us to avoid troubles
-    snps.emplace_back(SNP("SNP_A", 1, 10, "A", "", 1, 0.05, 1, 0.05));
-    snps.emplace_back(SNP("SNP_B", 2, 10, "A", "", 1, 0.05, 1, 0.05));
-    snps.emplace_back(SNP("SNP_C", 1, 10, "A", "", 1, 0.01, 1, 0.05));
-    snps.emplace_back(SNP("SNP_D", 2, 11, "A", "", 1, 0.05, 1, 0.05));
-    snps.emplace_back(SNP("SNP_E", 1, 10, "A", "", 1, 0.01, 1, 0.05));
+    snps.emplace_back(SNP("SNP_A", 1, 10, "A", "", 1, 0.05, 1, 0.05, id_arena,
+                          allele_table));
+    snps.emplace_back(SNP("SNP_B", 2, 10, "A", "", 1, 0.05, 1, 0.05, id_arena,
+                          allele_table));
+    snps.emplace_back(SNP("SNP_C", 1, 10, "A", "", 1, 0.01, 1, 0.05, id_arena,
+                          allele_table));
+    snps.emplace_back(SNP("SNP_D", 2, 11, "A", "", 1, 0.05, 1, 0.05, id_arena,
+                          allele_table));
+    snps.emplace_back(SNP("SNP_E", 1, 10, "A", "", 1, 0.01, 1, 0.05, id_arena,
+                          allele_table));
 
     // our desired order for the above input should be
     // 2,4,0,1,3
@@ -539,6 +584,8 @@ protected:
     // make sure genome_wide_background is true, or each set will
     // have a different not_found bit
     bool genome_wide_background = true;
+    StringArena id_arena;
+    AlleleTable allele_table;
     void SetUp() override
     {
         std::string gtf_name = path + "Test.gtf";
@@ -629,8 +676,10 @@ protected:
 
 TEST_F(SNP_REGION, BASE_SET1_STANDARD)
 {
-    SNP base_snp("Base_SNP", 1, 1, "A", "C", 1, 0.05, 1, 0.05);
-    SNP set_snp("Set_SNP", 1, 11869, "A", "C", 1, 0.05, 1, 0.05);
+    SNP base_snp("Base_SNP", 1, 1, "A", "C", 1, 0.05, 1, 0.05, id_arena,
+                 allele_table);
+    SNP set_snp("Set_SNP", 1, 11869, "A", "C", 1, 0.05, 1, 0.05, id_arena,
+                allele_table);
     std::vector<uintptr_t> index(required_size, 0);
     Genotype::construct_flag("Base_SNP", gene_sets, snp_in_sets, index,
                              required_size, 1, 1, genome_wide_background);
@@ -685,8 +734,10 @@ TEST_F(SNP_REGION, BASE_SET1_STANDARD)
 
 TEST_F(SNP_REGION, CHECK_IDX)
 {
-    SNP base_snp("Base_SNP", 1, 1, "A", "C", 1, 0.05, 1, 0.05);
-    SNP set_snp("Set_SNP", 1, 11869, "A", "C", 1, 0.05, 1, 0.05);
+    SNP base_snp("Base_SNP", 1, 1, "A", "C", 1, 0.05, 1, 0.05, id_arena,
+                 allele_table);
+    SNP set_snp("Set_SNP", 1, 11869, "A", "C", 1, 0.05, 1, 0.05, id_arena,
+                allele_table);
     std::vector<uintptr_t> index(required_size, 0);
     Genotype::construct_flag("Base_SNP", gene_sets, snp_in_sets, index,
                              required_size, 1, 1, genome_wide_background);
@@ -721,8 +772,10 @@ TEST_F(SNP_REGION, CHECK_IDX)
 TEST_F(SNP_REGION, BASE_SET1_PROXY_NO_GO)
 {
     // use proxy clumping, but LD not high enough to consider for proxy clump
-    SNP base_snp("Base_SNP", 1, 1, "A", "C", 1, 0.05, 1, 0.05);
-    SNP set_snp("Set_SNP", 1, 11869, "A", "C", 1, 0.05, 1, 0.05);
+    SNP base_snp("Base_SNP", 1, 1, "A", "C", 1, 0.05, 1, 0.05, id_arena,
+                 allele_table);
+    SNP set_snp("Set_SNP", 1, 11869, "A", "C", 1, 0.05, 1, 0.05, id_arena,
+                allele_table);
     std::vector<uintptr_t> index(required_size, 0);
     Genotype::construct_flag("Base_SNP", gene_sets, snp_in_sets, index,
                              required_size, 1, 1, genome_wide_background);
@@ -776,8 +829,10 @@ TEST_F(SNP_REGION, BASE_SET1_PROXY_NO_GO)
 TEST_F(SNP_REGION, BASE_SET1_PROXY_GO)
 {
     // use proxy clumping and LD is high enough
-    SNP base_snp("Base_SNP", 1, 1, "A", "C", 1, 0.05, 1, 0.05);
-    SNP set_snp("Set_SNP", 1, 11869, "A", "C", 1, 0.05, 1, 0.05);
+    SNP base_snp("Base_SNP", 1, 1, "A", "C", 1, 0.05, 1, 0.05, id_arena,
+                 allele_table);
+    SNP set_snp("Set_SNP", 1, 11869, "A", "C", 1, 0.05, 1, 0.05, id_arena,
+                allele_table);
     std::vector<uintptr_t> index(required_size, 0);
     Genotype::construct_flag("Base_SNP", gene_sets, snp_in_sets, index,
                              required_size, 1, 1, genome_wide_background);
@@ -826,8 +881,10 @@ TEST_F(SNP_REGION, BASE_SET1_PROXY_GO)
 TEST_F(SNP_REGION, OUT_OF_RANGE_ERROR)
 {
     // Test we correctly stop IN feature when out of range is reached
-    SNP base_snp("Base_SNP", 1, 1, "A", "C", 1, 0.05, 1, 0.05);
-    SNP set_snp("Set_SNP", 1, 11869, "A", "C", 1, 0.05, 1, 0.05);
+    SNP base_snp("Base_SNP", 1, 1, "A", "C", 1, 0.05, 1, 0.05, id_arena,
+                 allele_table);
+    SNP set_snp("Set_SNP", 1, 11869, "A", "C", 1, 0.05, 1, 0.05, id_arena,
+                allele_table);
     std::vector<uintptr_t> index(required_size, 0);
     Genotype::construct_flag("Base_SNP", gene_sets, snp_in_sets, index,
                              required_size, 1, 1, genome_wide_background);
@@ -854,8 +911,10 @@ TEST_F(SNP_REGION, OUT_OF_RANGE_ERROR)
 TEST_F(SNP_REGION, BASE_BASE_STANDARD)
 {
     // both base and set SNPs were not found in any regions
-    SNP base_snp("Base_SNP", 1, 1, "A", "C", 1, 0.05, 1, 0.05);
-    SNP set_snp("Set_SNP", 1, 2, "A", "C", 1, 0.05, 1, 0.05);
+    SNP base_snp("Base_SNP", 1, 1, "A", "C", 1, 0.05, 1, 0.05, id_arena,
+                 allele_table);
+    SNP set_snp("Set_SNP", 1, 2, "A", "C", 1, 0.05, 1, 0.05, id_arena,
+                allele_table);
     std::vector<uintptr_t> index(required_size, 0);
     Genotype::construct_flag("Base_SNP", gene_sets, snp_in_sets, index,
                              required_size, 1, 1, genome_wide_background);
@@ -895,7 +954,10 @@ TEST_F(SNP_REGION, BASE_BASE_STANDARD)
 
 TEST(SNP_COUNTS, SET_COUNTS)
 {
-    SNP base_snp("Base_SNP", 1, 1, "A", "C", 1, 0.05, 1, 0.05);
+    StringArena id_arena;
+    AlleleTable allele_table;
+    SNP base_snp("Base_SNP", 1, 1, "A", "C", 1, 0.05, 1, 0.05, id_arena,
+                 allele_table);
     size_t a, b, c, d;
     bool is_ref = true;
     base_snp.get_counts(a, b, c, d, !is_ref);
@@ -922,7 +984,10 @@ TEST(SNP_COUNTS, SET_COUNTS)
 }
 TEST(SNP_COUNTS, SET_REF_COUNTS)
 {
-    SNP base_snp("Base_SNP", 1, 1, "A", "C", 1, 0.05, 1, 0.05);
+    StringArena id_arena;
+    AlleleTable allele_table;
+    SNP base_snp("Base_SNP", 1, 1, "A", "C", 1, 0.05, 1, 0.05, id_arena,
+                 allele_table);
     size_t a, b, c, d;
     bool is_ref = true;
     bool flipped = true;
@@ -947,7 +1012,7 @@ TEST(SNP_COUNTS, SET_REF_COUNTS)
     ASSERT_EQ(b, 0);
     ASSERT_EQ(c, 0);
     ASSERT_EQ(d, 0);
-    base_snp.add_snp_info(0, 1, 1, 1, "", "", flipped, is_ref);
+    base_snp.add_snp_info(0, 1, 1, 1, "", "", flipped, is_ref, allele_table);
     base_snp.set_counts(10, 20, 30, 40, is_ref);
     // now flipped
     base_snp.get_counts(a, b, c, d, is_ref);
@@ -959,7 +1024,10 @@ TEST(SNP_COUNTS, SET_REF_COUNTS)
 
 TEST(SNP_BASIC, SET_EXPECTED)
 {
-    SNP snp("Base_SNP", 1, 1, "A", "C", 1, 0.05, 1, 0.05);
+    StringArena id_arena;
+    AlleleTable allele_table;
+    SNP snp("Base_SNP", 1, 1, "A", "C", 1, 0.05, 1, 0.05, id_arena,
+            allele_table);
     double maf = 0.123, ref_maf = 0.7548;
     ASSERT_DOUBLE_EQ(snp.get_expected(false), 0.0);
     ASSERT_DOUBLE_EQ(snp.get_expected(true), 0.0);
@@ -974,6 +1042,8 @@ TEST(SNP_BASIC, SET_EXPECTED)
 // test the post-hoc category assignment for ridiculously small interval size
 TEST(SNP_CATEGORY, BASIC_CALCULATION)
 {
+    StringArena id_arena;
+    AlleleTable allele_table;
     // we assume the calculation is sorted.
     std::string rs = "SNP";
     std::string a1 = "A", a2 = "C";
@@ -983,7 +1053,8 @@ TEST(SNP_CATEGORY, BASIC_CALCULATION)
     double p_value = 1e-50;
     unsigned long long category = 1;
     double p_threshold = 1e-50;
-    SNP snp(rs, chr, loc, a1, a2, stat, p_value, category, p_threshold);
+    SNP snp(rs, chr, loc, a1, a2, stat, p_value, category, p_threshold,
+            id_arena, allele_table);
     double inter = 1e-41, upper = 0.5, lower = 1e-40;
     unsigned long long cur_category = 0;
     unsigned long long before = cur_category;
@@ -1017,7 +1088,8 @@ TEST(SNP_CATEGORY, BASIC_CALCULATION)
     ASSERT_EQ(snp.category(), before + 1);
     ASSERT_EQ(before + 1, cur_category);
     p_value = 0.1;
-    SNP snp2(rs, chr, loc, a1, a2, stat, p_value, category, p_threshold);
+    SNP snp2(rs, chr, loc, a1, a2, stat, p_value, category, p_threshold,
+             id_arena, allele_table);
     inter = 0.03;
     lower = 0.001;
     cur_category = 10;
@@ -1030,6 +1102,8 @@ TEST(SNP_CATEGORY, BASIC_CALCULATION)
 
 TEST(SNP_CLUMP, EXTENSIVE_CLUMP)
 {
+    StringArena id_arena;
+    AlleleTable allele_table;
     // use proxy clumping and LD is high enough
     const size_t num_regions = 999;
     const size_t flag_size = BITCT_TO_WORDCT(num_regions);
@@ -1047,8 +1121,10 @@ TEST(SNP_CLUMP, EXTENSIVE_CLUMP)
         std::vector<uintptr_t> clumped(flag_size, 0);
         size_t bit_a, bit_b;
         bool clump_completed = true;
-        SNP base_snp("Base_SNP", 1, 1, "A", "C", 1, 0.05, 1, 0.05);
-        SNP set_snp("Set_SNP", 1, 11869, "A", "C", 1, 0.05, 1, 0.05);
+        SNP base_snp("Base_SNP", 1, 1, "A", "C", 1, 0.05, 1, 0.05, id_arena,
+                     allele_table);
+        SNP set_snp("Set_SNP", 1, 11869, "A", "C", 1, 0.05, 1, 0.05, id_arena,
+                    allele_table);
         for (size_t i = 0; i < flag_size; ++i)
         {
             bit_a = bit_generator(mt);
@@ -1096,4 +1172,86 @@ TEST(SNP_CLUMP, EXTENSIVE_CLUMP)
     }
 }
 
+TEST(SNP_STORAGE, ALLELE_TABLE)
+{
+    AlleleTable table;
+    ASSERT_EQ(table.encode(""), 0);
+    const uint32_t a = table.encode("A");
+    const uint32_t t = table.encode("T");
+    const uint32_t indel = table.encode("AT");
+    // each allele is only stored once
+    ASSERT_EQ(table.encode("A"), a);
+    ASSERT_EQ(table.size(), 4);
+    ASSERT_EQ(table.allele(t), "T");
+    ASSERT_EQ(table.complement(a), t);
+    ASSERT_EQ(table.complement(t), a);
+    ASSERT_EQ(table.complement(indel), indel);
+    ASSERT_EQ(table.complement(table.encode("G")), table.encode("C"));
+}
+
+TEST(SNP_STORAGE, STRING_ARENA)
+{
+    StringArena arena;
+    const char* first = arena.store("rs1");
+    // strings longer than a chunk should also be stored
+    std::string long_id(ARENA_CHUNK_SIZE + 10, 'x');
+    const char* second = arena.store(long_id);
+    const char* third = arena.store("rs3");
+    ASSERT_STREQ(first, "rs1");
+    ASSERT_EQ(std::string(second), long_id);
+    ASSERT_STREQ(third, "rs3");
+    ASSERT_EQ(arena.used(), long_id.size() + 9);
+}
+
+TEST(SNP_STORAGE, SET_FLAGS_COPY)
+{
+    // flags with more than one word are stored on the heap and should be
+    // deep copied
+    for (size_t num_word : {1, 3})
+    {
+        SetFlags flags;
+        std::vector<uintptr_t> input(num_word, 5);
+        flags.assign(input, num_word);
+        SetFlags copy = flags;
+        copy[0] = 0;
+        ASSERT_EQ(flags[0], 5);
+        ASSERT_EQ(copy.size(), num_word);
+        SetFlags moved = std::move(copy);
+        ASSERT_EQ(moved[0], 0);
+        ASSERT_EQ(moved[num_word - 1], (num_word == 1) ? 0 : 5);
+        ASSERT_EQ(copy.size(), 0);
+    }
+}
+
+TEST(SNP_STORAGE, STRING_INDEX)
+{
+    StringIndex index;
+    ASSERT_EQ(index.find("rs1"), ~size_t(0));
+    ASSERT_FALSE(index.contains("rs1"));
+    // insert enough keys to trigger a few rehash
+    const size_t num_key = 1000;
+    for (size_t i = 0; i < num_key; ++i)
+    { ASSERT_TRUE(index.insert("rs" + std::to_string(i), i)); }
+    // existing keys are not modified by insert
+    ASSERT_FALSE(index.insert("rs10", 0));
+    ASSERT_EQ(index.size(), num_key);
+    for (size_t i = 0; i < num_key; ++i)
+    { ASSERT_EQ(index.find("rs" + std::to_string(i)), i); }
+    // look up on a view, which is a prefix of a longer key
+    const std::string line = "rs12 1 100";
+    ASSERT_EQ(index.find(line.data(), 4), 12);
+    ASSERT_EQ(index.find(line.data(), 3), 1);
+    ASSERT_EQ(index.find("rs1000"), ~size_t(0));
+    // keys without value are only visible to contains
+    ASSERT_TRUE(index.insert("rs_filtered", ~size_t(0)));
+    ASSERT_TRUE(index.contains("rs_filtered"));
+    ASSERT_EQ(index.find("rs_filtered"), ~size_t(0));
+    ASSERT_TRUE(index.assign("rs_filtered", 5));
+    ASSERT_EQ(index.find("rs_filtered"), 5);
+    ASSERT_FALSE(index.assign("rs_missing", 5));
+    index.clear();
+    ASSERT_EQ(index.size(), 0);
+    ASSERT_FALSE(index.contains("rs1"));
+}
+
 #endif // SNP_TEST_HPP
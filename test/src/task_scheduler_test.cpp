@@ -0,0 +1,76 @@
+#ifndef TASK_SCHEDULER_TEST_HPP
+#define TASK_SCHEDULER_TEST_HPP
+#include "gtest/gtest.h"
+#include "task_scheduler.hpp"
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+TEST(TASK_DEQUE, TAKE_AND_STEAL)
+{
+    Task_Deque deque(3);
+    size_t task;
+    ASSERT_FALSE(deque.take(task));
+    ASSERT_FALSE(deque.steal(task));
+    deque.push(0);
+    deque.push(1);
+    deque.push(2);
+    // owner takes the newest task, thieves the oldest
+    ASSERT_TRUE(deque.take(task));
+    ASSERT_EQ(task, 2);
+    ASSERT_TRUE(deque.steal(task));
+    ASSERT_EQ(task, 0);
+    ASSERT_TRUE(deque.take(task));
+    ASSERT_EQ(task, 1);
+    ASSERT_FALSE(deque.take(task));
+    ASSERT_FALSE(deque.steal(task));
+}
+
+TEST(TASK_SCHEDULER, RUN_ALL_TASKS_ONCE)
+{
+    const size_t num_task = 1000;
+    for (size_t num_thread : {1, 2, 4, 7})
+    {
+        Task_Scheduler scheduler(num_thread);
+        std::vector<std::atomic<size_t>> count(num_task);
+        for (auto&& c : count) c = 0;
+        std::vector<std::atomic<int>> busy(num_thread);
+        for (auto&& b : busy) b = 0;
+        std::atomic<bool> overlap {false};
+        scheduler.run(num_task, [&](size_t task, size_t worker) {
+            ASSERT_LT(worker, num_thread);
+            // a worker only runs one task at a time
+            if (busy[worker]++ != 0) overlap = true;
+            // make the first tasks slow such that the others are stolen
+            if (task < 4)
+            { std::this_thread::sleep_for(std::chrono::milliseconds(20)); }
+            ++count[task];
+            --busy[worker];
+        });
+        ASSERT_FALSE(overlap);
+        for (auto&& c : count) ASSERT_EQ(c, 1);
+        // the scheduler can be reused
+        std::atomic<size_t> total {0};
+        scheduler.run(10, [&](size_t task, size_t) { total += task; });
+        ASSERT_EQ(total, 45);
+    }
+}
+
+TEST(TASK_SCHEDULER, RETHROW)
+{
+    Task_Scheduler scheduler(3);
+    try
+    {
+        scheduler.run(100, [](size_t task, size_t) {
+            if (task == 42) throw std::runtime_error("Error: Task failed");
+        });
+        FAIL();
+    }
+    catch (const std::runtime_error&)
+    {
+        SUCCEED();
+    }
+}
+#endif // TASK_SCHEDULER_TEST_HPP